@@ -0,0 +1,415 @@
+/*
+ * CachedParametrizedFunction.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef CACHED_PARAMETRIZED_FUNCTION_HPP
+#define CACHED_PARAMETRIZED_FUNCTION_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "Globals.hpp"
+#include "Exceptions.hpp"
+#include "ParametrizedFunction.hpp"
+
+BEGIN_NAMESPACE(LQCDA)
+
+/******************************************************************************
+ *                             EvaluationCache                                *
+ ******************************************************************************/
+
+// Bounded LRU map (x, p) -> f(x, p). Arguments are compared and hashed
+// bitwise. The cache is split into shards, each with its own mutex and LRU
+// list, so that concurrent lookups seldom contend. Lookups do not allocate.
+template<typename T>
+class EvaluationCache
+{
+private:
+    // Structs
+    struct Entry
+    {
+        std::uint64_t hash;
+        std::vector<T> args;
+        T value;
+    };
+    typedef std::list<Entry> lru_list;
+    struct Shard
+    {
+        std::mutex mutex;
+        // most recently used first
+        lru_list lru;
+        std::unordered_multimap<std::uint64_t, typename lru_list::iterator> map;
+    };
+
+    // Data
+    std::vector<std::unique_ptr<Shard>> _Shards;
+    std::size_t _ShardCapacity;
+    std::atomic<unsigned long> _nHits;
+    std::atomic<unsigned long> _nMisses;
+
+public:
+    // Constructors/Destructor
+    explicit EvaluationCache(std::size_t capacity = 100000, unsigned int nShards = 16);
+    ~EvaluationCache() = default;
+
+    // Cache
+    // looks up the arguments (x, p), of sizes nx and np
+    bool find(std::uint64_t h, const T *x, unsigned int nx, const T *p, unsigned int np, T &value);
+    void insert(std::uint64_t h, const T *x, unsigned int nx, const T *p, unsigned int np, T value);
+    void clear();
+    static std::uint64_t hash(const T *x, unsigned int nx, const T *p, unsigned int np);
+
+    // Statistics
+    unsigned long nHits() const
+    {
+        return _nHits.load(std::memory_order_relaxed);
+    }
+    unsigned long nMisses() const
+    {
+        return _nMisses.load(std::memory_order_relaxed);
+    }
+    double hitRate() const
+    {
+        unsigned long n = nHits() + nMisses();
+        return n ? double(nHits()) / n : 0.;
+    }
+    void resetStatistics()
+    {
+        _nHits = 0;
+        _nMisses = 0;
+    }
+    std::size_t capacity() const
+    {
+        return _ShardCapacity * _Shards.size();
+    }
+    std::size_t size() const;
+    void print(std::ostream &os) const;
+
+private:
+    Shard &shard(std::uint64_t h) const
+    {
+        return *_Shards[(h >> 32) % _Shards.size()];
+    }
+    static std::uint64_t mix(std::uint64_t h, const T *a, unsigned int n);
+};
+
+template<typename T>
+std::ostream &operator<<(std::ostream &os, const EvaluationCache<T> &c)
+{
+    c.print(os);
+    return os;
+}
+
+template<typename T>
+EvaluationCache<T>::EvaluationCache(std::size_t capacity, unsigned int nShards)
+    : _nHits {0}
+    , _nMisses {0}
+{
+    if (capacity == 0 || nShards == 0)
+    {
+        ERROR(SIZE, "evaluation cache needs a non-zero capacity and number of shards");
+    }
+    nShards = std::min<std::size_t>(nShards, capacity);
+    _ShardCapacity = (capacity + nShards - 1) / nShards;
+    for (unsigned int i = 0; i < nShards; ++i)
+    {
+        _Shards.emplace_back(new Shard);
+    }
+}
+
+template<typename T>
+bool EvaluationCache<T>::find(
+    std::uint64_t h,
+    const T *x, unsigned int nx,
+    const T *p, unsigned int np,
+    T &value)
+{
+    Shard &s = shard(h);
+    {
+        std::lock_guard<std::mutex> lock(s.mutex);
+        auto range = s.map.equal_range(h);
+        for (auto i = range.first; i != range.second; ++i)
+        {
+            const std::vector<T> &args = i->second->args;
+            if (args.size() == nx + np
+                    && std::memcmp(args.data(), x, nx * sizeof(T)) == 0
+                    && std::memcmp(args.data() + nx, p, np * sizeof(T)) == 0)
+            {
+                s.lru.splice(s.lru.begin(), s.lru, i->second);
+                value = i->second->value;
+                _nHits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+    }
+    _nMisses.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+template<typename T>
+void EvaluationCache<T>::insert(
+    std::uint64_t h,
+    const T *x, unsigned int nx,
+    const T *p, unsigned int np,
+    T value)
+{
+    Entry e;
+    e.hash = h;
+    e.args.reserve(nx + np);
+    e.args.insert(e.args.end(), x, x + nx);
+    e.args.insert(e.args.end(), p, p + np);
+    e.value = value;
+
+    Shard &s = shard(h);
+    std::lock_guard<std::mutex> lock(s.mutex);
+    // another thread may have inserted the same arguments
+    auto range = s.map.equal_range(h);
+    for (auto i = range.first; i != range.second; ++i)
+    {
+        if (i->second->args.size() == nx + np
+                && std::memcmp(i->second->args.data(), e.args.data(), (nx + np) * sizeof(T)) == 0)
+        {
+            return;
+        }
+    }
+    if (s.lru.size() >= _ShardCapacity)
+    {
+        // evict the least recently used entry
+        auto last = std::prev(s.lru.end());
+        auto lastRange = s.map.equal_range(last->hash);
+        for (auto i = lastRange.first; i != lastRange.second; ++i)
+        {
+            if (i->second == last)
+            {
+                s.map.erase(i);
+                break;
+            }
+        }
+        s.lru.pop_back();
+    }
+    s.lru.push_front(std::move(e));
+    s.map.insert({h, s.lru.begin()});
+}
+
+template<typename T>
+void EvaluationCache<T>::clear()
+{
+    for (auto &s : _Shards)
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        s->lru.clear();
+        s->map.clear();
+    }
+    resetStatistics();
+}
+
+template<typename T>
+std::size_t EvaluationCache<T>::size() const
+{
+    std::size_t n = 0;
+    for (auto &s : _Shards)
+    {
+        std::lock_guard<std::mutex> lock(s->mutex);
+        n += s->lru.size();
+    }
+    return n;
+}
+
+template<typename T>
+void EvaluationCache<T>::print(std::ostream &os) const
+{
+    os << "Evaluation cache: " << size() << " / " << capacity() << " entries, "
+       << nHits() << " hits, " << nMisses() << " misses (hit rate "
+       << hitRate() << ")" << std::endl;
+}
+
+// 64-bit hash of the bits of x and p
+template<typename T>
+std::uint64_t EvaluationCache<T>::hash(const T *x, unsigned int nx, const T *p, unsigned int np)
+{
+    std::uint64_t h = mix(0x9e3779b97f4a7c15ULL, x, nx);
+    h = mix(h, p, np);
+    // final avalanche (splitmix64)
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    h ^= h >> 31;
+    return h;
+}
+
+template<typename T>
+std::uint64_t EvaluationCache<T>::mix(std::uint64_t h, const T *a, unsigned int n)
+{
+    const unsigned char *bytes = reinterpret_cast<const unsigned char *>(a);
+    std::size_t size = n * sizeof(T);
+    std::size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        std::uint64_t w;
+        std::memcpy(&w, bytes + i, 8);
+        h = (h ^ w) * 0x100000001b3ULL;
+        h ^= h >> 29;
+    }
+    for (; i < size; ++i)
+    {
+        h = (h ^ bytes[i]) * 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/******************************************************************************
+ *                        CachedParametrizedFunction                          *
+ ******************************************************************************/
+
+// Memoizes the evaluations of an expensive model in an EvaluationCache.
+// The cache can be shared between several wrappers of the same model (e.g.
+// fits of different samples or threads): the model values do not depend on
+// the data, so with exact x the points already visited by one fit are hits
+// for the others. It must not be shared between different models.
+// Cached evaluations are thread-safe if the model is.
+template<typename T>
+class CachedParametrizedFunction
+    : public ParametrizedScalarFunction<T>
+{
+public:
+    // Typedefs
+    typedef EvaluationCache<T> CacheType;
+
+private:
+    const ParametrizedScalarFunction<T> &_F;
+    std::shared_ptr<CacheType> _Cache;
+
+public:
+    // Constructors/Destructor
+    explicit CachedParametrizedFunction(
+        const ParametrizedScalarFunction<T> &f,
+        std::size_t capacity = 100000)
+        : ParametrizedScalarFunction<T>(f.xDim(), f.nPar())
+        , _F(f)
+        , _Cache(std::make_shared<CacheType>(capacity))
+    {}
+    CachedParametrizedFunction(
+        const ParametrizedScalarFunction<T> &f,
+        const std::shared_ptr<CacheType> &cache)
+        : ParametrizedScalarFunction<T>(f.xDim(), f.nPar())
+        , _F(f)
+        , _Cache(cache)
+    {
+        if (!cache)
+        {
+            ERROR(NULLPTR, "null evaluation cache");
+        }
+    }
+    virtual ~CachedParametrizedFunction() = default;
+
+public: // Queries
+    using ParametrizedScalarFunction<T>::xDim;
+    using ParametrizedScalarFunction<T>::yDim;
+    using ParametrizedScalarFunction<T>::nPar;
+    const std::shared_ptr<CacheType> &cache() const
+    {
+        return _Cache;
+    }
+    const ParametrizedScalarFunction<T> &function() const
+    {
+        return _F;
+    }
+
+public: // Evaluators
+    virtual T operator()(const T *x, const T *p) const override;
+    using ParametrizedScalarFunction<T>::operator();
+    // Only the points missing from the cache are passed to the model, in a
+    // single evaluateMany() call
+    virtual void evaluateMany(const T *X, unsigned int nPoints, const T *p, T *out) const override;
+
+public: // Linearity
+    virtual bool isLinear() const override
+    {
+        return _F.isLinear();
+    }
+    virtual void designRow(const T *x, T *row) const override
+    {
+        _F.designRow(x, row);
+    }
+    virtual bool isLinearParameter(unsigned int k) const override
+    {
+        return _F.isLinearParameter(k);
+    }
+
+public: // Derivatives
+    virtual bool hasParameterGradient() const override
+    {
+        return _F.hasParameterGradient();
+    }
+    virtual void parameterGradient(const T *x, const T *p, T *g) const override
+    {
+        _F.parameterGradient(x, p, g);
+    }
+};
+
+template<typename T>
+T CachedParametrizedFunction<T>::operator()(const T *x, const T *p) const
+{
+    const unsigned int nx = xDim(), np = nPar();
+    std::uint64_t h = CacheType::hash(x, nx, p, np);
+    T value;
+    if (!_Cache->find(h, x, nx, p, np, value))
+    {
+        value = _F(x, p);
+        _Cache->insert(h, x, nx, p, np, value);
+    }
+    return value;
+}
+
+template<typename T>
+void CachedParametrizedFunction<T>::evaluateMany(
+    const T *X,
+    unsigned int nPoints,
+    const T *p,
+    T *out) const
+{
+    const unsigned int nx = xDim(), np = nPar();
+    std::vector<unsigned int> miss;
+    std::vector<std::uint64_t> missHash;
+    for (unsigned int k = 0; k < nPoints; ++k)
+    {
+        std::uint64_t h = CacheType::hash(X + k * nx, nx, p, np);
+        if (!_Cache->find(h, X + k * nx, nx, p, np, out[k]))
+        {
+            miss.push_back(k);
+            missHash.push_back(h);
+        }
+    }
+    if (miss.empty())
+    {
+        return;
+    }
+
+    std::vector<T> Xm(miss.size() * nx), fm(miss.size());
+    for (unsigned int i = 0; i < miss.size(); ++i)
+    {
+        std::copy(X + miss[i] * nx, X + (miss[i] + 1) * nx, Xm.data() + i * nx);
+    }
+    _F.evaluateMany(Xm.data(), miss.size(), p, fm.data());
+    for (unsigned int i = 0; i < miss.size(); ++i)
+    {
+        out[miss[i]] = fm[i];
+        _Cache->insert(missHash[i], Xm.data() + i * nx, nx, p, np, fm[i]);
+    }
+}
+
+END_NAMESPACE // LQCDA
+
+#endif // CACHED_PARAMETRIZED_FUNCTION_HPP
@@ -9,12 +9,26 @@
 #define COST_FCN_HPP
 
 #include <memory>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <mutex>
+#include <unordered_map>
 
 #include "Globals.hpp"
 #include "XYDataInterface.hpp"
 #include "FitInterface.hpp"
 #include "Function.hpp"
 #include "ParametrizedFunction.hpp"
+#include "ScalarConstraint.hpp"
+#include "GaussianPrior.hpp"
+#include "LinalgUtils.hpp"
+
+#include <Eigen/Cholesky>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 BEGIN_NAMESPACE(LQCDA)
 
@@ -29,11 +43,14 @@ class CostFunction
 protected:
     // Typedefs
     typedef ParametrizedScalarFunction<T> ScalarModel;
+    typedef ParametrizedVectorFunction<T> VectorModel;
 
     // Data
     const XYDataInterface<T> &_Data;
     const FitInterface &_Fit;
+    // either one scalar model per y-dimension or a vector model
     std::vector<const ScalarModel *> _Model;
+    const VectorModel *_VectorModel;
     unsigned int _nPar;
 
 public:
@@ -45,18 +62,24 @@ public:
         const XYDataInterface<T> &data,
         const FitInterface &fit,
         const std::vector<const ParametrizedScalarFunction<T> *> &model);
+    CostFunction(
+        const XYDataInterface<T> &data,
+        const FitInterface &fit,
+        const ParametrizedVectorFunction<T> &model);
     // Destructor
     virtual ~CostFunction() noexcept = default;
 
     // Accessors
     void setModel(const ScalarModel *model, unsigned int i);
     void setModel(const std::vector<const ScalarModel *> &model);
+    void setModel(const VectorModel &model);
 
     unsigned int nPar() const
     {
         return _nPar;
     }
     unsigned int nDOF() const;
+    bool isLinear() const;
 
 private:
     void checkModel(const ScalarModel *model);
@@ -71,6 +94,7 @@ CostFunction<T>::CostFunction(
     , _Data(data)
     , _Fit(fit)
     , _Model(data.yDim(), nullptr)
+    , _VectorModel {nullptr}
     , _nPar {0}
 {}
 
@@ -83,6 +107,22 @@ CostFunction<T>::CostFunction(
     , _Data(data)
     , _Fit(fit)
     , _Model(data.yDim(), nullptr)
+    , _VectorModel {nullptr}
+    , _nPar {0}
+{
+    setModel(model);
+}
+
+template<typename T>
+CostFunction<T>::CostFunction(
+    const XYDataInterface<T> &data,
+    const FitInterface &fit,
+    const ParametrizedVectorFunction<T> &model)
+    : ScalarFunction<T>(0)
+    , _Data(data)
+    , _Fit(fit)
+    , _Model(data.yDim(), nullptr)
+    , _VectorModel {nullptr}
     , _nPar {0}
 {
     setModel(model);
@@ -94,6 +134,7 @@ void CostFunction<T>::setModel(const ScalarModel *model, unsigned int i)
     assert(i < _Data->yDim());
     checkModel(model);
     _Model[i] = model;
+    _VectorModel = nullptr;
     this->setXDim(_nPar + _Data.nFitXDim() * _Data.nFitPoints());
 }
 
@@ -117,6 +158,24 @@ void CostFunction<T>::setModel(const std::vector<const ScalarModel *> &model)
         checkModel(model[i]);
         _Model[i] = model[i];
     }
+    _VectorModel = nullptr;
+    this->setXDim(_nPar + _Fit.nFitXDim() * _Fit.nFitPoints());
+}
+
+template<typename T>
+void CostFunction<T>::setModel(const VectorModel &model)
+{
+    if (model.xDim() != _Data.xDim())
+    {
+        ERROR(SIZE, "model/data x-dimension mismatch");
+    }
+    if (model.yDim() != _Data.yDim())
+    {
+        ERROR(SIZE, "model/data y-dimension mismatch");
+    }
+    std::fill(_Model.begin(), _Model.end(), nullptr);
+    _VectorModel = &model;
+    _nPar = model.nPar();
     this->setXDim(_nPar + _Fit.nFitXDim() * _Fit.nFitPoints());
 }
 
@@ -130,6 +189,28 @@ unsigned int CostFunction<T>::nDOF() const
     return _Data.yDim() * _Fit.nFitPoints() - _nPar;
 }
 
+template<typename T>
+bool CostFunction<T>::isLinear() const
+{
+    // fitted x make the cost function nonlinear
+    if (_Fit.nFitXDim() != 0)
+    {
+        return false;
+    }
+    if (_VectorModel)
+    {
+        return _VectorModel->isLinear();
+    }
+    for (auto m : _Model)
+    {
+        if (!m || !m->isLinear())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
 template<typename T>
 void CostFunction<T>::checkModel(const ScalarModel *model)
 {
@@ -154,6 +235,27 @@ void CostFunction<T>::checkModel(const ScalarModel *model)
  *                             Chi2 CostFunction                              *
  ******************************************************************************/
 
+// The covariance of the fitted data is factorized once (Cholesky, C = L L^T)
+// into an immutable state shared by all evaluations, and the chi2 is computed
+// as the squared norm of the whitened residuals L^{-1} r. Residual buffers
+// live in a Workspace owned by the caller (one per thread and per cost
+// function for operator() and evaluateMany(), kept across calls), so that
+// concurrent evaluations of the same cost function are safe, lock-free and
+// allocation-free once the state is built, and a model may itself evaluate
+// another cost function.
+// Gaussian priors on the parameters are appended to the whitened residuals.
+// requestUpdate(), setModel() and setPrior() must not be called concurrently
+// with an evaluation.
+// Models are evaluated through evaluateMany() on contiguous chunks of fitted
+// points, so that batched models (e.g. ParametrizedFormulaFunction) are used
+// at full speed. A vector model evaluates all y-dimensions of a chunk at once.
+// For large fits, the residual loop and the whitening triangular solve can be
+// split across OpenMP threads (see Options); evaluation stays serial below
+// options.parallel_threshold residuals and inside an enclosing parallel region.
+// When all the models are scalar models with an analytic parameter gradient
+// and no x is fitted, the chi2 has the analytic gradient -2 J^T C^{-1} r
+// (plus the prior part), with J the Jacobian of the models at the fitted
+// points.
 template<typename T>
 class Chi2CostFunction
     : public CostFunction<T>
@@ -162,34 +264,77 @@ class Chi2CostFunction
 public:
     // Typedefs
     typedef typename CostFunction<T>::ScalarModel ScalarModel;
+    typedef typename CostFunction<T>::VectorModel VectorModel;
+
+    // Options
+    struct Options
+    {
+        // split evaluation across threads
+        bool parallel;
+        // minimal number of residuals for a parallel evaluation
+        index_t parallel_threshold;
+        // block size of the parallel triangular solve
+        index_t block_size;
+
+        Options()
+            : parallel {true}
+            , parallel_threshold {1024}
+            , block_size {128}
+        {}
+    };
+
+    // Structs
+    struct Workspace
+    {
+        // vector of residuals
+        Vector<T> r;
+        // x of the fitted points
+        Vector<T> x_buf;
+        // model parameter gradient at one point
+        Vector<T> g_buf;
+    };
+    struct LinearSolution
+    {
+        // parameters
+        Vector<T> p;
+        // parameters covariance matrix
+        Matrix<T> cov;
+        // chi2 at the solution
+        T chi2;
+    };
 
 protected:
     using CostFunction<T>::_Data;
     using CostFunction<T>::_Fit;
     using CostFunction<T>::_Model;
+    using CostFunction<T>::_VectorModel;
     using CostFunction<T>::_nPar;
 
-private:
     // Structs
-    struct Helper
+    struct State
     {
-        // is updated
-        bool is_updated {false};
-        // vector of residuals
-        Vector<T> r;
         // fitted points indices
         Vector<index_t> d_ind;
         // fitted x indices
         Vector<index_t> x_ind;
-        // inverse covariance matrix
-        Matrix<T> c_inv;
-        // x buffer
-        Vector<T> x_buf;
+        // lower Cholesky factor of the covariance matrix
+        Matrix<T> c_chol;
     };
 
+private:
     // Data
-    std::unique_ptr<Helper> _helper;
+    // copy of the priors, empty if none
+    GaussianPrior<T> _Prior;
+    mutable std::shared_ptr<const State> _State;
+    mutable std::atomic<bool> _isUpdated;
+    mutable std::mutex _UpdateMutex;
+    // identifies this instance in the per-thread workspaces, which are
+    // dropped when it expires
+    std::shared_ptr<char> _WorkspaceToken;
 
+public:
+    // Options
+    Options options;
 
 public:
     // Constructors
@@ -197,118 +342,586 @@ public:
         const XYDataInterface<T> &data,
         const FitInterface &fit)
         : CostFunction<T>(data, fit)
-        , _helper(new Helper)
+        , _isUpdated {false}
+        , _WorkspaceToken {std::make_shared<char>()}
     {}
     Chi2CostFunction(
         const XYDataInterface<T> &data,
         const FitInterface &fit,
         const std::vector<const ParametrizedScalarFunction<T> *> &model)
         : CostFunction<T>(data, fit, model)
-        , _helper(new Helper)
+        , _isUpdated {false}
+        , _WorkspaceToken {std::make_shared<char>()}
+    {}
+    Chi2CostFunction(
+        const XYDataInterface<T> &data,
+        const FitInterface &fit,
+        const ParametrizedVectorFunction<T> &model)
+        : CostFunction<T>(data, fit, model)
+        , _isUpdated {false}
+        , _WorkspaceToken {std::make_shared<char>()}
     {}
     // Destructor
     virtual ~Chi2CostFunction() noexcept = default;
 
     // Accessors
     void requestUpdate() const;
+    void setPrior(const GaussianPrior<T> &prior);
+    unsigned int nDOF() const;
+    unsigned int nResiduals() const;
 
 public:
+    virtual bool isThreadSafe() const override
+    {
+        return true;
+    }
     virtual T operator()(const T *args) const override;
+    virtual void evaluateMany(const T *X, unsigned int nPoints, T *out) const override;
+    T evaluate(const T *args, Workspace &ws) const;
+    // Whitened residuals (data then priors) in ws.r
+    void whitenedResiduals(const T *args, Workspace &ws) const;
+
+    // Analytic gradient
+    virtual bool hasGradient() const override;
+    virtual void gradient(const T *args, T *g) const override;
+
+    // Generalized least-squares solution for linear models
+    bool solveLinear(const std::vector<ScalarConstraint<T>> &c, LinearSolution &sol) const;
+
+protected:
+    const State &state() const;
+    void residuals(const T *args, const State &s, Workspace &ws) const;
+    bool isParallel(index_t size) const;
+    // Workspace of the calling thread for this cost function, its buffers
+    // are only reallocated when the number of residuals changes
+    Workspace &threadWorkspace() const;
 
 private:
-    void setCov(index_t j1, index_t j2, ConstRef<Matrix<T>> cov) const;
-    void update_helper() const;
+    void setCov(const State &s, Matrix<T> &c, index_t k1, index_t k2, ConstRef<Matrix<T>> cov) const;
+    std::shared_ptr<const State> buildState() const;
 
 };
 
 template<typename T>
 void Chi2CostFunction<T>::requestUpdate() const
 {
-    _helper->is_updated = false;
+    _isUpdated.store(false, std::memory_order_release);
 }
 
 template<typename T>
 T Chi2CostFunction<T>::operator()(const T *args) const
+{
+    return evaluate(args, threadWorkspace());
+}
+
+// Points are split across threads, each one reusing its workspace
+template<typename T>
+void Chi2CostFunction<T>::evaluateMany(const T *X, unsigned int nPoints, T *out) const
+{
+    const unsigned int xdim = this->xDim();
+    state();
+#ifdef _OPENMP
+    bool par = options.parallel && nPoints > 1 && !omp_in_parallel();
+#endif
+    std::exception_ptr error;
+    #pragma omp parallel if(par)
+    {
+        Workspace &ws = threadWorkspace();
+        #pragma omp for schedule(dynamic)
+        for (int k = 0; k < static_cast<int>(nPoints); ++k)
+        {
+            try
+            {
+                out[k] = evaluate(X + k * xdim, ws);
+            }
+            catch (...)
+            {
+                #pragma omp critical
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+template<typename T>
+void Chi2CostFunction<T>::setPrior(const GaussianPrior<T> &prior)
+{
+    if (!prior.empty() && prior.nPar() != _nPar)
+    {
+        ERROR(SIZE, "wrong number of parameters in provided prior (expected "
+              + utils::strFrom(_nPar) + ", got " + utils::strFrom(prior.nPar()) + ")");
+    }
+    _Prior = prior;
+}
+
+template<typename T>
+unsigned int Chi2CostFunction<T>::nDOF() const
+{
+    // priors count as additional data points
+    return CostFunction<T>::nDOF() + _Prior.nResiduals();
+}
+
+template<typename T>
+unsigned int Chi2CostFunction<T>::nResiduals() const
+{
+    return (_Data.yDim() + _Fit.nFitXDim()) * _Fit.nFitPoints()
+           + _Prior.nResiduals();
+}
+
+template<typename T>
+T Chi2CostFunction<T>::evaluate(const T *args, Workspace &ws) const
+{
+    whitenedResiduals(args, ws);
+    T chi2 = ws.r.squaredNorm();
+    // std::cout << "chi2 = " << chi2 << '\n';
+    return chi2;
+}
+
+template<typename T>
+void Chi2CostFunction<T>::whitenedResiduals(const T *args, Workspace &ws) const
+{
+    const State &s = state();
+    index_t size = s.c_chol.rows();
+
+    // set vector of residuals
+    residuals(args, s, ws);
+
+    // whiten data residuals
+    if (isParallel(size))
+    {
+        ParallelLowerSolveInPlace<T>(s.c_chol, ws.r.head(size), options.block_size);
+    }
+    else
+    {
+        s.c_chol.template triangularView<Eigen::Lower>().solveInPlace(ws.r.head(size));
+    }
+
+    // append priors
+    if (!_Prior.empty())
+    {
+        _Prior.residuals(args, ws.r.data() + size);
+    }
+}
+
+template<typename T>
+bool Chi2CostFunction<T>::hasGradient() const
+{
+    if (_VectorModel || _Fit.nFitXDim() != 0)
+    {
+        return false;
+    }
+    for (auto m : _Model)
+    {
+        if (!m || !m->hasParameterGradient())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+// With w = L^{-T} L^{-1} r = C^{-1} r, dchi2/dp = -2 sum_i w_i df(x_i)/dp,
+// and the priors add 2 P^T r_P
+template<typename T>
+void Chi2CostFunction<T>::gradient(const T *args, T *g) const
+{
+    if (!hasGradient())
+    {
+        ERROR(IMPLEMENTATION, "chi2 has no analytic gradient (vector model, "
+              "fitted x or model without parameter gradient)");
+    }
+    Workspace &ws = threadWorkspace();
+    whitenedResiduals(args, ws);
+    const State &s = state();
+    index_t size = s.c_chol.rows();
+    index_t nFitPoints = _Fit.nFitPoints();
+    index_t xDim = _Data.xDim();
+
+    s.c_chol.transpose().template triangularView<Eigen::Upper>().solveInPlace(ws.r.head(size));
+    ws.g_buf.resize(_nPar);
+    std::fill(g, g + _nPar, T {0});
+    for (index_t yk = 0; yk < static_cast<index_t>(_Model.size()); ++yk)
+    {
+        for (index_t i = 0; i < nFitPoints; ++i)
+        {
+            _Model[yk]->parameterGradient(ws.x_buf.data() + i * xDim, args, ws.g_buf.data());
+            T w = ws.r(yk * nFitPoints + i);
+            for (index_t k = 0; k < _nPar; ++k)
+            {
+                g[k] -= 2 * w * ws.g_buf(k);
+            }
+        }
+    }
+    if (!_Prior.empty())
+    {
+        ws.g_buf.setZero();
+        _Prior.addTransposed(ws.r.data() + size, ws.g_buf.data());
+        for (index_t k = 0; k < _nPar; ++k)
+        {
+            g[k] += 2 * ws.g_buf(k);
+        }
+    }
+}
+
+// Solves the correlated normal equations (A^T C^{-1} A) p = A^T C^{-1} y
+// through the cached covariance factor, with A the design matrix of the
+// (linear) models, augmented with the whitened prior rows. Fixed parameters
+// are moved to the right-hand side.
+// Returns false if the problem can not be solved in closed form (nonlinear
+// model, bounded parameters or degenerate design), in which case sol is
+// left untouched.
+template<typename T>
+bool Chi2CostFunction<T>::solveLinear(
+    const std::vector<ScalarConstraint<T>> &c,
+    LinearSolution &sol) const
+{
+    if (!this->isLinear())
+    {
+        return false;
+    }
+    for (auto &ci : c)
+    {
+        if (ci.hasBounds() && !ci.hasFixedValue())
+        {
+            return false;
+        }
+    }
+
+    const State &s = state();
+    index_t nFitPoints = _Fit.nFitPoints();
+    index_t xDim = _Data.xDim();
+    index_t yDim = _Data.yDim();
+    index_t size = yDim * nFitPoints;
+
+    // Design matrix and data
+    Matrix<T> A(size, _nPar);
+    Vector<T> y(size);
+    Vector<T> x_buf(xDim);
+    if (_VectorModel)
+    {
+        // row-major yDim x nPar design rows of each point
+        Vector<T> rows(yDim * _nPar);
+        FOR_VEC(s.d_ind, i)
+        {
+            for (index_t xk = 0; xk < xDim; ++xk)
+            {
+                x_buf(xk) = _Data.x(s.d_ind(i), xk);
+            }
+            _VectorModel->designRows(x_buf.data(), rows.data());
+            for (index_t yk = 0; yk < yDim; ++yk)
+            {
+                A.row(yk * nFitPoints + i) = rows.segment(yk * _nPar, _nPar).transpose();
+                y(yk * nFitPoints + i) = _Data.y(s.d_ind(i), yk);
+            }
+        }
+    }
+    else
+    {
+        RowVector<T> row(_nPar);
+        for (index_t yk = 0; yk < yDim; ++yk)
+        {
+            FOR_VEC(s.d_ind, i)
+            {
+                for (index_t xk = 0; xk < xDim; ++xk)
+                {
+                    x_buf(xk) = _Data.x(s.d_ind(i), xk);
+                }
+                _Model[yk]->designRow(x_buf.data(), row.data());
+                A.row(yk * nFitPoints + i) = row;
+                y(yk * nFitPoints + i) = _Data.y(s.d_ind(i), yk);
+            }
+        }
+    }
+
+    // Fixed parameters
+    std::vector<index_t> free;
+    Vector<T> p = Vector<T>::Zero(_nPar);
+    for (index_t k = 0; k < _nPar; ++k)
+    {
+        if (k < (index_t)c.size() && c[k].hasFixedValue())
+        {
+            p(k) = c[k].fixedValue();
+            y -= p(k) * A.col(k);
+        }
+        else
+        {
+            free.push_back(k);
+        }
+    }
+    index_t nFree = free.size();
+    Matrix<T> Aw(size, nFree);
+    for (index_t k = 0; k < nFree; ++k)
+    {
+        Aw.col(k) = A.col(free[k]);
+    }
+
+    // Whiten
+    s.c_chol.template triangularView<Eigen::Lower>().solveInPlace(Aw);
+    s.c_chol.template triangularView<Eigen::Lower>().solveInPlace(y);
+
+    // Priors
+    if (!_Prior.empty())
+    {
+        Matrix<T> P;
+        Vector<T> yP;
+        _Prior.linearSystem(P, yP);
+        index_t nRes = yP.size();
+        for (index_t k = 0; k < _nPar; ++k)
+        {
+            if (k < (index_t)c.size() && c[k].hasFixedValue())
+            {
+                yP -= p(k) * P.col(k);
+            }
+        }
+        Aw.conservativeResize(size + nRes, Eigen::NoChange);
+        y.conservativeResize(size + nRes);
+        for (index_t k = 0; k < nFree; ++k)
+        {
+            Aw.col(k).tail(nRes) = P.col(free[k]);
+        }
+        y.tail(nRes) = yP;
+    }
+
+    // Normal equations
+    Matrix<T> N = Matrix<T>::Zero(nFree, nFree);
+    N.template selfadjointView<Eigen::Lower>().rankUpdate(Aw.transpose());
+    Eigen::LLT<Matrix<T>> llt(N);
+    if (llt.info() != Eigen::Success)
+    {
+        return false;
+    }
+    Vector<T> pFree = llt.solve(Aw.transpose() * y);
+    Matrix<T> covFree = llt.solve(Matrix<T>::Identity(nFree, nFree));
+
+    sol.cov.setZero(_nPar, _nPar);
+    for (index_t k1 = 0; k1 < nFree; ++k1)
+    {
+        p(free[k1]) = pFree(k1);
+        for (index_t k2 = 0; k2 < nFree; ++k2)
+        {
+            sol.cov(free[k1], free[k2]) = covFree(k1, k2);
+        }
+    }
+    sol.p = p;
+    sol.chi2 = (y - Aw * pFree).squaredNorm();
+
+    return true;
+}
+
+template<typename T>
+const typename Chi2CostFunction<T>::State &Chi2CostFunction<T>::state() const
+{
+    // double-checked update, lock-free once the state is built
+    if (!_isUpdated.load(std::memory_order_acquire))
+    {
+        std::lock_guard<std::mutex> lock(_UpdateMutex);
+        if (!_isUpdated.load(std::memory_order_relaxed))
+        {
+            _State = buildState();
+            _isUpdated.store(true, std::memory_order_release);
+        }
+    }
+    return *_State;
+}
+
+template<typename T>
+void Chi2CostFunction<T>::residuals(const T *args, const State &s, Workspace &ws) const
 {
     // init sizes
     index_t nFitPoints = _Fit.nFitPoints();
     index_t xDim = _Data.xDim();
     index_t yDim = _Data.yDim();
     index_t ysize = yDim * nFitPoints;
+    index_t size = s.c_chol.rows();
+
+    ws.r.resize(size + _Prior.nResiduals());
+    ws.x_buf.resize(xDim * nFitPoints);
 
     // get x "dummy" params
     ConstMap<Vector<T>> x_par(args + _nPar, this->xDim() - _nPar, 1);
 
-    // update helper if necessary
-    if (!_helper->is_updated)
+    // check models
+    for (index_t yk = 0; yk < yDim && !_VectorModel; ++yk)
     {
-        update_helper();
+        if (!_Model[yk])
+        {
+            ERROR(MEMORY, "null model pointer encountered (at y index = "
+                  + utils::strFrom(yk) + ")");
+        }
     }
 
-    // set vector of residuals
-    // y part
-    index_t xpar_ind;
-    for (index_t yk = 0; yk < yDim; ++yk)
+    // x of the fitted points, contiguous
+    FOR_VEC(s.d_ind, i)
     {
-        FOR_VEC(_helper->d_ind, i)
+        index_t xpar_ind = 0;
+        for (index_t xk = 0; xk < xDim; ++xk)
         {
-            const ScalarModel *f = _Model[yk];
-            if (!f)
+            if (_Fit.isXExact(xk))
             {
-                ERROR(MEMORY, "null model pointer encountered (at y index = "
-                      + utils::strFrom(yk) + ")");
+                ws.x_buf(i * xDim + xk) = _Data.x(s.d_ind(i), xk);
             }
-            xpar_ind = 0;
-            for (index_t xk = 0; xk < xDim; ++xk)
+            else
             {
-                if (_Fit.isXExact(xk))
+                ws.x_buf(i * xDim + xk) = x_par(xpar_ind * nFitPoints + i);
+                xpar_ind++;
+            }
+        }
+    }
+
+    // y part: models are evaluated on chunks of points, at most 256 long,
+    // and short enough in parallel to give each thread a few chunks
+    // ryi_k = yi_k - f(xi)
+    bool par = isParallel(size);
+    index_t chunk = 256;
+#ifdef _OPENMP
+    if (par)
+    {
+        index_t nRows = _VectorModel ? 1 : yDim;
+        index_t nChunksPerRow = (4 * omp_get_max_threads() + nRows - 1) / nRows;
+        chunk = std::max(index_t(16), std::min(chunk, (nFitPoints + nChunksPerRow - 1) / nChunksPerRow));
+    }
+#endif
+    const index_t nChunks = (nFitPoints + chunk - 1) / chunk;
+    std::exception_ptr error;
+    if (_VectorModel)
+    {
+        par = par && nChunks > 1;
+        #pragma omp parallel for if(par)
+        for (index_t c = 0; c < nChunks; ++c)
+        {
+            try
+            {
+                index_t i0 = c * chunk;
+                index_t n = std::min(chunk, nFitPoints - i0);
+                _VectorModel->evaluateMany(ws.x_buf.data() + i0 * xDim, n, args,
+                                           ws.r.data() + i0, nFitPoints);
+                for (index_t yk = 0; yk < yDim; ++yk)
                 {
-                    _helper->x_buf(xk) = _Data.x(_helper->d_ind(i), xk);
+                    T *r = ws.r.data() + yk * nFitPoints + i0;
+                    for (index_t i = 0; i < n; ++i)
+                    {
+                        r[i] = _Data.y(s.d_ind(i0 + i), yk) - r[i];
+                    }
                 }
-                else
+            }
+            catch (...)
+            {
+                #pragma omp critical
+                if (!error)
                 {
-                    _helper->x_buf(xk) = x_par(xpar_ind * nFitPoints + i);
-                    xpar_ind++;
+                    error = std::current_exception();
                 }
             }
-            // ryi_k = yi_k - f(xi)
-            _helper->r(yk * nFitPoints + i) =
-                _Data.y(_helper->d_ind(i), yk) - (*f)(_helper->x_buf.data(), args);
         }
     }
+    else
+    {
+        par = par && nChunks * yDim > 1;
+        #pragma omp parallel for collapse(2) if(par)
+        for (index_t yk = 0; yk < yDim; ++yk)
+        {
+            for (index_t c = 0; c < nChunks; ++c)
+            {
+                try
+                {
+                    index_t i0 = c * chunk;
+                    index_t n = std::min(chunk, nFitPoints - i0);
+                    T *r = ws.r.data() + yk * nFitPoints + i0;
+                    _Model[yk]->evaluateMany(ws.x_buf.data() + i0 * xDim, n, args, r);
+                    for (index_t i = 0; i < n; ++i)
+                    {
+                        r[i] = _Data.y(s.d_ind(i0 + i), yk) - r[i];
+                    }
+                }
+                catch (...)
+                {
+                    #pragma omp critical
+                    if (!error)
+                    {
+                        error = std::current_exception();
+                    }
+                }
+            }
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
     // x part
-    FOR_VEC(_helper->x_ind, xk)
-    FOR_VEC(_helper->d_ind, i)
+    FOR_VEC(s.x_ind, xk)
+    FOR_VEC(s.d_ind, i)
     {
         // rxi_k = xi_k - x_par i_k
-        _helper->r(ysize + xk * nFitPoints + i) =
-            _Data.x(_helper->d_ind(i), _helper->x_ind(xk)) - x_par(xk * nFitPoints + i);
+        ws.r(ysize + xk * nFitPoints + i) =
+            _Data.x(s.d_ind(i), s.x_ind(xk)) - x_par(xk * nFitPoints + i);
     }
+}
 
-    // compute chi2
-    T chi2 = _helper->r.dot(_helper->c_inv * _helper->r);
-    // std::cout << "chi2 = " << chi2 << '\n';
-    return chi2;
+template<typename T>
+bool Chi2CostFunction<T>::isParallel(index_t size) const
+{
+#ifdef _OPENMP
+    return options.parallel && size >= options.parallel_threshold && !omp_in_parallel();
+#else
+    return false;
+#endif
+}
+
+// The workspaces of a thread are keyed by instance. The workspace of an
+// expired instance is dropped when a new one is created, so that the map only
+// grows with the number of live cost functions evaluated by the thread.
+template<typename T>
+typename Chi2CostFunction<T>::Workspace &Chi2CostFunction<T>::threadWorkspace() const
+{
+    struct OwnedWorkspace
+    {
+        std::weak_ptr<char> owner;
+        Workspace ws;
+    };
+    static thread_local std::unordered_map<const Chi2CostFunction<T> *, OwnedWorkspace> workspaces;
+
+    auto it = workspaces.find(this);
+    if (it != workspaces.end() && !it->second.owner.expired())
+    {
+        return it->second.ws;
+    }
+    for (it = workspaces.begin(); it != workspaces.end();)
+    {
+        it = it->second.owner.expired() ? workspaces.erase(it) : std::next(it);
+    }
+    OwnedWorkspace &w = workspaces[this];
+    w.owner = _WorkspaceToken;
+    return w.ws;
 }
 
 template<typename T>
-void Chi2CostFunction<T>::setCov(index_t k1, index_t k2, ConstRef<Matrix<T>> cov) const
+void Chi2CostFunction<T>::setCov(const State &s, Matrix<T> &c, index_t k1, index_t k2, ConstRef<Matrix<T>> cov) const
 {
     index_t nFitPoints = _Fit.nFitPoints();
-    FOR_VEC(_helper->d_ind, i1)
-    FOR_VEC(_helper->d_ind, i2)
+    FOR_VEC(s.d_ind, i1)
+    FOR_VEC(s.d_ind, i2)
     {
-        if (_Fit.isDataCorrelated(_helper->d_ind(i1), _helper->d_ind(i2)))
+        if (_Fit.isDataCorrelated(s.d_ind(i1), s.d_ind(i2)))
         {
-            _helper->c_inv(k1 * nFitPoints + i1, k2 * nFitPoints + i2) =
-                cov(_helper->d_ind(i1), _helper->d_ind(i2));
+            c(k1 * nFitPoints + i1, k2 * nFitPoints + i2) =
+                cov(s.d_ind(i1), s.d_ind(i2));
         }
     }
 }
 
 template<typename T>
-void Chi2CostFunction<T>::update_helper() const
+std::shared_ptr<const typename Chi2CostFunction<T>::State> Chi2CostFunction<T>::buildState() const
 {
+    std::shared_ptr<State> s = std::make_shared<State>();
+
     // Resize
     index_t nPoints = _Data.nPoints();
     index_t nFitPoints = _Fit.nFitPoints();
@@ -316,11 +929,9 @@ void Chi2CostFunction<T>::update_helper() const
     index_t nFitXDim = _Fit.nFitXDim();
     index_t yDim = _Data.yDim();
     index_t size = (yDim + nFitXDim) * nFitPoints;
-    _helper->r.setConstant(size, T {0});
-    _helper->d_ind.setZero(nFitPoints);
-    _helper->x_ind.setZero(nFitXDim);
-    _helper->c_inv.setConstant(size, size, T {0});
-    _helper->x_buf.setConstant(xDim, T {0});
+    s->d_ind.setZero(nFitPoints);
+    s->x_ind.setZero(nFitXDim);
+    Matrix<T> c = Matrix<T>::Zero(size, size);
 
     // Build index tables
     index_t di = 0;
@@ -328,7 +939,7 @@ void Chi2CostFunction<T>::update_helper() const
     {
         if (_Fit.isFitPoint(i))
         {
-            _helper->d_ind(di) = i;
+            s->d_ind(di) = i;
             di++;
         }
     }
@@ -337,12 +948,12 @@ void Chi2CostFunction<T>::update_helper() const
     {
         if (!_Fit.isXExact(k))
         {
-            _helper->x_ind(xk) = k;
+            s->x_ind(xk) = k;
             xk++;
         }
     }
 
-    // Set inverse covariance matrix
+    // Set covariance matrix
     // set yy cov
     for (index_t yk1 = 0; yk1 < yDim; ++yk1)
     {
@@ -350,43 +961,48 @@ void Chi2CostFunction<T>::update_helper() const
         {
             if (_Fit.isYYCorrelated(yk1, yk2))
             {
-                setCov(yk1, yk2, _Data.yyCov(yk1, yk2));
+                setCov(*s, c, yk1, yk2, _Data.yyCov(yk1, yk2));
             }
         }
     }
     // set xx cov
-    FOR_VEC(_helper->x_ind, xk1)
-    FOR_VEC(_helper->x_ind, xk2)
+    FOR_VEC(s->x_ind, xk1)
+    FOR_VEC(s->x_ind, xk2)
     {
-        if (_Fit.isXXCorrelated(_helper->x_ind(xk1), _helper->x_ind(xk2)))
+        if (_Fit.isXXCorrelated(s->x_ind(xk1), s->x_ind(xk2)))
         {
-            setCov(xk1 + yDim, xk2 + yDim, _Data.xxCov(_helper->x_ind(xk1), _helper->x_ind(xk2)));
+            setCov(*s, c, xk1 + yDim, xk2 + yDim, _Data.xxCov(s->x_ind(xk1), s->x_ind(xk2)));
         }
     }
 
     // set xy cov
-    FOR_VEC(_helper->x_ind, xk)
+    FOR_VEC(s->x_ind, xk)
     {
         for (index_t yk = 0; yk < yDim; ++yk)
         {
-            if (_Fit.isXYCorrelated(_helper->x_ind(xk), yk))
+            if (_Fit.isXYCorrelated(s->x_ind(xk), yk))
             {
-                setCov(xk + yDim, yk, _Data.xyCov(_helper->x_ind(xk), yk));
+                setCov(*s, c, xk + yDim, yk, _Data.xyCov(s->x_ind(xk), yk));
             }
         }
     }
 
     // symmetrize
-    auto YX = _helper->c_inv.block(0, nFitPoints * yDim, nFitPoints * yDim, nFitPoints * nFitXDim);
-    auto XY = _helper->c_inv.block(nFitPoints * yDim, 0, nFitPoints * nFitXDim, nFitPoints * yDim);
+    auto YX = c.block(0, nFitPoints * yDim, nFitPoints * yDim, nFitPoints * nFitXDim);
+    auto XY = c.block(nFitPoints * yDim, 0, nFitPoints * nFitXDim, nFitPoints * yDim);
     YX = XY.transpose().eval();
 
-    // invert
-    _helper->c_inv = _helper->c_inv.inverse().eval();
+    // factorize
+    Eigen::LLT<Matrix<T>> llt(c);
+    if (llt.info() != Eigen::Success)
+    {
+        ERROR(RUNTIME, "covariance matrix of the fitted data is not positive definite");
+    }
+    s->c_chol = llt.matrixL();
 
-    _helper->is_updated = true;
+    return s;
 }
 
 END_NAMESPACE // LQCDA
 
-#endif // COST_FCN_HPP
\ No newline at end of file
+#endif // COST_FCN_HPP
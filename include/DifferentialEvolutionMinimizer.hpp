@@ -0,0 +1,407 @@
+/*
+ * DifferentialEvolutionMinimizer.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef DIFFERENTIAL_EVOLUTION_MINIMIZER_HPP
+#define DIFFERENTIAL_EVOLUTION_MINIMIZER_HPP
+
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <limits>
+
+#include "Minimizer.hpp"
+#include "Minuit2Minimizer.hpp"
+#include "MultiStartMinimizer.hpp"
+#include "Random.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+BEGIN_NAMESPACE(LQCDA)
+BEGIN_NAMESPACE(MIN)
+
+class DifferentialEvolutionMinimizerOptions
+    : public MinimizerOptions
+{
+public:
+    // population size
+    unsigned int population;
+    // maximum number of generations
+    unsigned int max_generations;
+    // differential weight and crossover probability (rand/1/bin)
+    double weight;
+    double crossover;
+    // half-width of the initial population around x0 for parameters without
+    // both bounds, in units of max(|x0|, e0)
+    double spread;
+    // convergence when std(cost) < abs_tolerance + tolerance * |mean(cost)|
+    double tolerance;
+    double abs_tolerance;
+    // random generator seed
+    int seed;
+    // evaluate the population concurrently
+    bool parallel;
+    // polish the best member with MIGRAD
+    bool polish;
+    MnMigradMinimizerOptions polish_options;
+
+public:
+    DifferentialEvolutionMinimizerOptions()
+        : MinimizerOptions()
+    {
+        init();
+    }
+    DifferentialEvolutionMinimizerOptions(const MinimizerOptions &opts)
+        : MinimizerOptions(opts)
+    {
+        init();
+    }
+
+    virtual ~DifferentialEvolutionMinimizerOptions() noexcept = default;
+
+    virtual void print(std::ostream &os) const override
+    {
+        os << "Differential evolution options:\n"
+           << "\tpopulation = " << population << std::endl
+           << "\tmax_generations = " << max_generations << std::endl
+           << "\tweight = " << weight << std::endl
+           << "\tcrossover = " << crossover << std::endl
+           << "\tspread = " << spread << std::endl
+           << "\ttolerance = " << tolerance << std::endl
+           << "\tabs_tolerance = " << abs_tolerance << std::endl
+           << "\tseed = " << seed << std::endl
+           << "\tparallel = " << parallel << std::endl
+           << "\tpolish = " << polish << std::endl;
+        if (polish)
+            polish_options.print(os);
+    }
+
+private:
+    void init()
+    {
+        population = 40;
+        max_generations = 1000;
+        weight = 0.7;
+        crossover = 0.9;
+        spread = 1.;
+        tolerance = 1.e-3;
+        abs_tolerance = 1.e-2;
+        seed = 1;
+        parallel = true;
+        polish = true;
+        polish_options.pre_minimize = false;
+    }
+};
+
+/******************************************************************************
+ *                      DifferentialEvolutionMinimizer                        *
+ ******************************************************************************/
+
+// Differential evolution (rand/1/bin) on the variable parameters, for rough
+// bounded landscapes. The initial population is a Latin hypercube (see
+// MultiStartMinimizer) containing x0, each generation is evaluated
+// concurrently with one evaluateMany() call per thread (the minimized function
+// must be thread-safe), and trial
+// components leaving the bounds are pulled back between the parent and the
+// bound. The best member then seeds a MIGRAD polish, which provides the errors.
+// If the polish does not improve the best member, the best member is returned
+// without errors, and is valid if the population converged.
+template<typename T>
+class DifferentialEvolutionMinimizer
+    : public Minimizer<T>
+{
+public:
+    // Typedefs
+    typedef DifferentialEvolutionMinimizerOptions OptionsType;
+    typedef DE_ID ID;
+    typedef typename Minimizer<T>::Result Result;
+
+private:
+    OptionsType _Opts;
+
+public:
+    // Constructor
+    DifferentialEvolutionMinimizer(const OptionsType &opts = OptionsType())
+        : _Opts(opts)
+    {}
+    // Destructor
+    virtual ~DifferentialEvolutionMinimizer() noexcept = default;
+
+    // Options
+    virtual OptionsType &options() override
+    {
+        return _Opts;
+    }
+
+    // Minimize
+    using Minimizer<T>::minimize;
+    virtual Result minimize(
+        const ScalarFunction<T> &F,
+        const std::vector<T> &x0,
+        const std::vector<T> &e0,
+        const std::vector<ScalarConstraint<T>> &c) override;
+    Result minimize(
+        const ScalarFunction<T> &F,
+        const std::vector<T> &x0,
+        const std::vector<ScalarConstraint<T>> &c);
+
+private:
+    void evaluatePopulation(
+        const ScalarFunction<T> &F,
+        const std::vector<std::vector<T>> &X,
+        std::vector<T> &buf,
+        std::vector<T> &f) const;
+};
+
+template<typename T>
+using DE = DifferentialEvolutionMinimizer<T>;
+
+template<typename T>
+typename DifferentialEvolutionMinimizer<T>::Result DifferentialEvolutionMinimizer<T>::minimize(
+    const ScalarFunction<T> &F,
+    const std::vector<T> &x0,
+    const std::vector<T> &e0,
+    const std::vector<ScalarConstraint<T>> &c)
+{
+    utils::vostream vout(std::cout, _Opts.verbosity);
+    vout(NORMAL) << "Minimizing with differential evolution minimizer\n";
+    vout(NORMAL) << _Opts << std::endl;
+
+    const unsigned int npar = x0.size();
+    if (e0.size() != npar)
+    {
+        ERROR(SIZE, "initial errors size mismatch (expected "
+              + utils::strFrom(npar) + ", got " + utils::strFrom(e0.size()) + ")");
+    }
+    const unsigned int np = _Opts.population;
+    if (np < 4)
+    {
+        ERROR(LOGIC, "differential evolution needs a population of at least 4 (got "
+              + utils::strFrom(np) + ")");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    InstrumentedFunction<T> IF(F, _Opts.time_evaluations);
+
+    // variable parameters and their bounds
+    std::vector<unsigned int> var;
+    std::vector<T> lo(npar, -std::numeric_limits<T>::infinity());
+    std::vector<T> hi(npar, std::numeric_limits<T>::infinity());
+    for (unsigned int i = 0; i < npar; i++)
+    {
+        if (i < c.size() && c[i].hasFixedValue())
+            continue;
+        var.push_back(i);
+        if (i < c.size() && c[i].hasLowerBound())
+            lo[i] = c[i].lowerBound();
+        if (i < c.size() && c[i].hasUpperBound())
+            hi[i] = c[i].upperBound();
+    }
+    if (var.empty())
+    {
+        ERROR(LOGIC, "no variable parameter to minimize");
+    }
+
+    // initial population
+    RandGen rg(_Opts.seed);
+    std::vector<std::vector<T>> X(1, x0);
+    for (unsigned int i = 0; i < npar; i++)
+    {
+        if (i < c.size() && c[i].hasFixedValue())
+            X[0][i] = c[i].fixedValue();
+        X[0][i] = std::min(std::max(X[0][i], lo[i]), hi[i]);
+    }
+    std::vector<std::vector<T>> lhs = internal::LatinHypercube(X[0], e0, c, np - 1, _Opts.spread, rg);
+    X.insert(X.end(), lhs.begin(), lhs.end());
+    std::vector<T> f(np), ft(np), buf;
+    evaluatePopulation(IF, X, buf, f);
+
+    // generations
+    std::vector<std::vector<T>> Xt(np, X[0]);
+    unsigned int gen = 0;
+    unsigned int ibest = std::min_element(f.begin(), f.end()) - f.begin();
+    bool converged = false;
+    while (gen < _Opts.max_generations)
+    {
+        for (unsigned int k = 0; k < np; k++)
+        {
+            unsigned int r1, r2, r3;
+            do r1 = rg.getUniformInt(np); while (r1 == k);
+            do r2 = rg.getUniformInt(np); while (r2 == k || r2 == r1);
+            do r3 = rg.getUniformInt(np); while (r3 == k || r3 == r2 || r3 == r1);
+            unsigned int jr = var[rg.getUniformInt(var.size())];
+            Xt[k] = X[k];
+            for (auto j : var)
+            {
+                if (j != jr && rg.getUniform(0., 1.) >= _Opts.crossover)
+                    continue;
+                T y = X[r1][j] + _Opts.weight * (X[r2][j] - X[r3][j]);
+                if (y < lo[j])
+                    y = lo[j] + rg.getUniform(0., 1.) * (X[k][j] - lo[j]);
+                else if (y > hi[j])
+                    y = hi[j] - rg.getUniform(0., 1.) * (hi[j] - X[k][j]);
+                Xt[k][j] = y;
+            }
+        }
+        evaluatePopulation(IF, Xt, buf, ft);
+        for (unsigned int k = 0; k < np; k++)
+        {
+            if (ft[k] <= f[k])
+            {
+                std::swap(X[k], Xt[k]);
+                f[k] = ft[k];
+            }
+        }
+        gen++;
+
+        T mean {0}, sq {0};
+        ibest = 0;
+        for (unsigned int k = 0; k < np; k++)
+        {
+            mean += f[k];
+            sq += f[k] * f[k];
+            if (f[k] < f[ibest])
+                ibest = k;
+        }
+        mean /= np;
+        T sd = std::sqrt(std::max(sq / np - mean * mean, T {0}));
+        vout(DEBUG) << "(DE) generation " << gen << ": best cost = " << f[ibest]
+                    << ", std = " << sd << std::endl;
+        if (std::isfinite(mean) && sd <= _Opts.abs_tolerance + _Opts.tolerance * std::abs(mean))
+        {
+            converged = true;
+            break;
+        }
+    }
+    vout(NORMAL) << "(DE) " << gen << " generations, best cost = " << f[ibest]
+                 << (converged ? "" : " (not converged)") << std::endl;
+
+    Result result;
+    if (_Opts.polish)
+    {
+        // population spread as initial steps
+        std::vector<T> ep(e0);
+        for (auto j : var)
+        {
+            T m {0}, s {0};
+            for (unsigned int k = 0; k < np; k++)
+            {
+                m += X[k][j];
+                s += X[k][j] * X[k][j];
+            }
+            m /= np;
+            s = std::sqrt(std::max(s / np - m * m, T {0}));
+            if (s > 0)
+                ep[j] = s;
+        }
+        MnMigradMinimizer<T> migrad(_Opts.polish_options);
+        migrad.options().verbosity = _Opts.verbosity;
+        result = migrad.minimize(F, X[ibest], ep, c);
+        if (!(result.final_cost <= f[ibest]))
+        {
+            // keep the best member, the MIGRAD errors do not apply to it
+            vout(NORMAL) << "(DE) MIGRAD polish did not improve the best member, keeping it\n";
+            result.minimum.assign(X[ibest].begin(), X[ibest].end());
+            result.errors.assign(npar, 0.);
+            result.covariance.resize(0, 0);
+            result.lower_errors.clear();
+            result.upper_errors.clear();
+            result.lower_valid.clear();
+            result.upper_valid.clear();
+            result.final_cost = f[ibest];
+            result.is_valid = converged;
+        }
+    }
+    else
+    {
+        result.minimum.assign(X[ibest].begin(), X[ibest].end());
+        result.errors.assign(npar, 0.);
+        result.final_cost = f[ibest];
+        result.is_valid = converged;
+    }
+
+    // the population evaluations are regular calls, the pre-minimization
+    // calls are the ones of the polish
+    Telemetry &tel = result.telemetry;
+    tel.n_calls += IF.nCalls();
+    tel.eval_time += IF.evalTime();
+    tel.total_time = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start).count();
+    vout(DEBUG) << tel;
+
+    return result;
+}
+
+template<typename T>
+typename DifferentialEvolutionMinimizer<T>::Result DifferentialEvolutionMinimizer<T>::minimize(
+    const ScalarFunction<T> &F,
+    const std::vector<T> &x0,
+    const std::vector<ScalarConstraint<T>> &c)
+{
+    std::vector<T> e0(x0.size(), 0.1);
+    return minimize(F, x0, e0, c);
+}
+
+// The population is packed into buf and split in one contiguous chunk per
+// thread, so that a batched cost function (e.g. Chi2CostFunction) reuses its
+// buffers across the members of a chunk. Non finite costs are replaced by
+// +inf so that they never get selected.
+template<typename T>
+void DifferentialEvolutionMinimizer<T>::evaluatePopulation(
+    const ScalarFunction<T> &F,
+    const std::vector<std::vector<T>> &X,
+    std::vector<T> &buf,
+    std::vector<T> &f) const
+{
+    const int np = X.size();
+    const int npar = X[0].size();
+    buf.clear();
+    for (auto &x : X)
+    {
+        buf.insert(buf.end(), x.begin(), x.end());
+    }
+    std::exception_ptr error;
+    #pragma omp parallel if(_Opts.parallel)
+    {
+        int nt = 1, it = 0;
+#ifdef _OPENMP
+        nt = omp_get_num_threads();
+        it = omp_get_thread_num();
+#endif
+        const int k0 = np * it / nt, k1 = np * (it + 1) / nt;
+        try
+        {
+            if (k1 > k0)
+            {
+                F.evaluateMany(buf.data() + k0 * npar, k1 - k0, f.data() + k0);
+            }
+        }
+        catch (...)
+        {
+            #pragma omp critical
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    for (auto &v : f)
+    {
+        if (std::isnan(v))
+            v = std::numeric_limits<T>::infinity();
+    }
+}
+
+END_NAMESPACE
+END_NAMESPACE
+
+#endif // DIFFERENTIAL_EVOLUTION_MINIMIZER_HPP
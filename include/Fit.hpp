@@ -12,6 +12,7 @@
 #include "FitInterface.hpp"
 #include "FitResult.hpp"
 #include "CostFunction.hpp"
+#include "GaussianPrior.hpp"
 #include "Minimizer.hpp"
 #include "IO.hpp"
 
@@ -38,10 +39,18 @@ public:
     {
         Verbosity verbosity;
         bool update_cost_fcn;
+        // solve linear models in closed form instead of minimizing
+        bool linear_solve;
+        // seed the minimizer with the previous valid fit result of the same
+        // model on the same data, x0 is then ignored
+        bool warm_start;
+        typename COST<T>::Options cost;
 
         Options()
             : verbosity {SILENT}
         	, update_cost_fcn {true}
+            , linear_solve {true}
+            , warm_start {false}
         {}
     };
 
@@ -58,6 +67,11 @@ private:
     std::unique_ptr<COST<T>> _CostFcn;
     // Minimizer
     std::unique_ptr<MINIMIZER<T>> _Minimizer;
+    // Last valid minimization result, its model and its fixed parameters,
+    // for warm starts
+    std::unique_ptr<typename MIN::Minimizer<T>::Result> _LastMin;
+    std::vector<const void *> _LastModel;
+    std::vector<bool> _LastFixed;
 
 public:
     // Constructors
@@ -75,6 +89,16 @@ public:
     void setOptions(const Options &opts);
 
     // Fit methods
+    FitResult<T> fit(
+        const std::vector<const ParametrizedScalarFunction<T> *> &model,
+        const std::vector<T> &x0,
+        const std::vector<ScalarConstraint<T>> &c,
+        const GaussianPrior<T> &prior);
+    FitResult<T> fit(
+        const ParametrizedScalarFunction<T> &model,
+        const std::vector<T> &x0,
+        const std::vector<ScalarConstraint<T>> &c,
+        const GaussianPrior<T> &prior);
     FitResult<T> fit(
         const std::vector<const ParametrizedScalarFunction<T> *> &model,
         const std::vector<T> &x0,
@@ -89,6 +113,30 @@ public:
     FitResult<T> fit(
         const ParametrizedScalarFunction<T> &model,
         const std::vector<T> &x0);
+    // Vector model, all y-dimensions evaluated jointly
+    FitResult<T> fit(
+        const ParametrizedVectorFunction<T> &model,
+        const std::vector<T> &x0,
+        const std::vector<ScalarConstraint<T>> &c,
+        const GaussianPrior<T> &prior);
+    FitResult<T> fit(
+        const ParametrizedVectorFunction<T> &model,
+        const std::vector<T> &x0,
+        const std::vector<ScalarConstraint<T>> &c);
+    FitResult<T> fit(
+        const ParametrizedVectorFunction<T> &model,
+        const std::vector<T> &x0);
+
+private:
+    // MODEL is either a vector of scalar models or a vector model
+    template<typename MODEL>
+    FitResult<T> fitModel(
+        const MODEL &model,
+        const std::vector<T> &x0,
+        const std::vector<ScalarConstraint<T>> &c,
+        const GaussianPrior<T> &prior);
+    static std::vector<const void *> modelKey(const std::vector<const ScalarModel *> &model);
+    static std::vector<const void *> modelKey(const ParametrizedVectorFunction<T> &model);
 };
 
 template <
@@ -135,6 +183,7 @@ void FitImpl<T, COST, MINIMIZER>::setData(const XYDataInterface<T> &data)
     FitInterface::resize(data.nPoints(), data.xDim(), data.yDim());
     _Data = &data;
     _CostFcn.reset(new COST<T>(*_Data, *this));
+    _LastMin.reset();
 }
 
 template <
@@ -155,7 +204,62 @@ template <
 FitResult<T> FitImpl<T, COST, MINIMIZER>::fit(
     const std::vector<const ParametrizedScalarFunction<T> *> &model,
     const std::vector<T> &x0,
+    const std::vector<ScalarConstraint<T>> &c,
+    const GaussianPrior<T> &prior)
+{
+    return fitModel(model, x0, c, prior);
+}
+
+template <
+    typename T,
+    template<typename> class COST,
+    template<typename> class MINIMIZER
+    >
+FitResult<T> FitImpl<T, COST, MINIMIZER>::fit(
+    const ParametrizedVectorFunction<T> &model,
+    const std::vector<T> &x0,
+    const std::vector<ScalarConstraint<T>> &c,
+    const GaussianPrior<T> &prior)
+{
+    return fitModel(model, x0, c, prior);
+}
+
+template <
+    typename T,
+    template<typename> class COST,
+    template<typename> class MINIMIZER
+    >
+FitResult<T> FitImpl<T, COST, MINIMIZER>::fit(
+    const ParametrizedVectorFunction<T> &model,
+    const std::vector<T> &x0,
     const std::vector<ScalarConstraint<T>> &c)
+{
+    return fitModel(model, x0, c, GaussianPrior<T>());
+}
+
+template <
+    typename T,
+    template<typename> class COST,
+    template<typename> class MINIMIZER
+    >
+FitResult<T> FitImpl<T, COST, MINIMIZER>::fit(
+    const ParametrizedVectorFunction<T> &model,
+    const std::vector<T> &x0)
+{
+    return fit(model, x0, std::vector<ScalarConstraint<T>>(x0.size()));
+}
+
+template <
+    typename T,
+    template<typename> class COST,
+    template<typename> class MINIMIZER
+    >
+template<typename MODEL>
+FitResult<T> FitImpl<T, COST, MINIMIZER>::fitModel(
+    const MODEL &model,
+    const std::vector<T> &x0,
+    const std::vector<ScalarConstraint<T>> &c,
+    const GaussianPrior<T> &prior)
 {
     utils::vostream vout(std::cout, options.verbosity);
     // Initialize
@@ -177,10 +281,34 @@ FitResult<T> FitImpl<T, COST, MINIMIZER>::fit(
             _CostFcn->requestUpdate();
         }
     }
+    _CostFcn->options = options.cost;
+    _CostFcn->setPrior(prior);
+
+    // Linear models
+    typename COST<T>::LinearSolution lin;
+    if (options.linear_solve && _CostFcn->solveLinear(c, lin))
+    {
+        vout(DEBUG) << "Solving linear model in closed form...\n";
+        FitResult<T> result;
+        result._nDOF = _CostFcn->nDOF();
+        result._Params.assign(lin.p.data(), lin.p.data() + lin.p.size());
+        result._Errors.resize(lin.p.size());
+        FOR_VEC(lin.p, k)
+        {
+            result._Errors[k] = std::sqrt(lin.cov(k, k));
+        }
+        result._Cov = lin.cov;
+        result._Cost = lin.chi2;
+        result._isValid = true;
+        return result;
+    }
 
     // Minimizer
-    vout(DEBUG) << "Creating minimizer...\n";
-    _Minimizer = std::unique_ptr<MINIMIZER<T>>(new MINIMIZER<T>);
+    if (!_Minimizer)
+    {
+        vout(DEBUG) << "Creating minimizer...\n";
+        _Minimizer = std::unique_ptr<MINIMIZER<T>>(new MINIMIZER<T>);
+    }
     _Minimizer->options().verbosity = options.verbosity;
 
     // Initial parameters and constraints
@@ -208,16 +336,104 @@ FitResult<T> FitImpl<T, COST, MINIMIZER>::fit(
 // std::cout << "_CostFcn->nDOF() = " << _CostFcn->nDOF() << std::endl;
     result._nDOF = _CostFcn->nDOF();
 
-    auto min = _Minimizer->minimize(*_CostFcn, xinit, constraints);
+    // a previous result of another model, or with other fixed parameters
+    // (whose covariance rows are missing), is never reused
+    std::vector<const void *> key = modelKey(model);
+    std::vector<bool> fixed(constraints.size());
+    for (unsigned int i = 0; i < constraints.size(); ++i)
+    {
+        fixed[i] = constraints[i].hasFixedValue();
+    }
+    if (key != _LastModel || fixed != _LastFixed)
+    {
+        _LastMin.reset();
+        _LastModel = key;
+        _LastFixed = fixed;
+    }
+    bool warm = options.warm_start && _LastMin
+                && _LastMin->minimum.size() == xinit.size();
+    if (warm)
+    {
+        vout(DEBUG) << "Warm-starting from previous fit...\n";
+        std::copy(_LastMin->minimum.begin(), _LastMin->minimum.begin() + _CostFcn->nPar(),
+                  xinit.begin());
+    }
+    auto min = warm
+               ? _Minimizer->minimize(*_CostFcn, xinit, constraints, *_LastMin)
+               : _Minimizer->minimize(*_CostFcn, xinit, constraints);
+    if (min.is_valid)
+    {
+        _LastMin.reset(new typename MIN::Minimizer<T>::Result(min));
+    }
 
     result._Params = min.minimum;
     result._Errors = min.errors;
+    result._LowerErrors.assign(min.lower_errors.begin(), min.lower_errors.end());
+    result._UpperErrors.assign(min.upper_errors.begin(), min.upper_errors.end());
+    result._LowerValid = min.lower_valid;
+    result._UpperValid = min.upper_valid;
+    if (min.covariance.rows() >= _CostFcn->nPar())
+    {
+        result._Cov = min.covariance.topLeftCorner(_CostFcn->nPar(), _CostFcn->nPar()).template cast<T>();
+    }
     result._Cost = min.final_cost;
     result._isValid = min.is_valid;
+    result._Telemetry = min.telemetry;
 
     return result;
 }
 
+template <
+    typename T,
+    template<typename> class COST,
+    template<typename> class MINIMIZER
+    >
+std::vector<const void *> FitImpl<T, COST, MINIMIZER>::modelKey(
+    const std::vector<const ScalarModel *> &model)
+{
+    return std::vector<const void *>(model.begin(), model.end());
+}
+
+template <
+    typename T,
+    template<typename> class COST,
+    template<typename> class MINIMIZER
+    >
+std::vector<const void *> FitImpl<T, COST, MINIMIZER>::modelKey(
+    const ParametrizedVectorFunction<T> &model)
+{
+    return std::vector<const void *>(1, &model);
+}
+
+template <
+    typename T,
+    template<typename> class COST,
+    template<typename> class MINIMIZER
+    >
+FitResult<T> FitImpl<T, COST, MINIMIZER>::fit(
+    const ParametrizedScalarFunction<T> &model,
+    const std::vector<T> &x0,
+    const std::vector<ScalarConstraint<T>> &c,
+    const GaussianPrior<T> &prior)
+{
+    std::vector<const ParametrizedScalarFunction<T> *> vmodel(1);
+    vmodel[0] = &model;
+    return fit(vmodel, x0, c, prior);
+}
+
+template <
+    typename T,
+    template<typename> class COST,
+    template<typename> class MINIMIZER
+    >
+FitResult<T> FitImpl<T, COST, MINIMIZER>::fit(
+    const std::vector<const ParametrizedScalarFunction<T> *> &model,
+    const std::vector<T> &x0,
+    const std::vector<ScalarConstraint<T>> &c)
+{
+    return fit(model, x0, c, GaussianPrior<T>());
+}
+
 template <
     typename T,
     template<typename> class COST,
@@ -11,6 +11,7 @@
  #include "Globals.hpp"
  #include "XYData.hpp"
  #include "ParametrizedFunction.hpp"
+ #include "MinimizerTelemetry.hpp"
 
  namespace LQCDA {
  	// namespace internal {
@@ -47,6 +48,12 @@
  		const std::vector<T>& parameters() const { return _Params; }
  		const T& err(unsigned int i) const { return _Errors[i]; }
  		const std::vector<T>& errors() const { return _Errors; }
+ 		const std::vector<T>& lowerErrors() const { return _LowerErrors; }
+ 		const std::vector<T>& upperErrors() const { return _UpperErrors; }
+ 		const std::vector<bool>& lowerValid() const { return _LowerValid; }
+ 		const std::vector<bool>& upperValid() const { return _UpperValid; }
+ 		const Matrix<T>& covariance() const { return _Cov; }
+ 		const MIN::Telemetry& telemetry() const { return _Telemetry; }
 
  		// const std::vector<const ParametrizedScalarFunction<T>*>& model() const { return _Model; }
  		// const ParametrizedScalarFunction<T>& model(const unsigned int k) const { return _Model[k]; }
@@ -60,6 +67,14 @@
  		std::vector<T> _Params;
  		// Errors
  		std::vector<T> _Errors;
+ 		// Asymmetric errors (empty if not computed)
+ 		std::vector<T> _LowerErrors;
+ 		std::vector<T> _UpperErrors;
+ 		// Whether each asymmetric error bound was found
+ 		std::vector<bool> _LowerValid;
+ 		std::vector<bool> _UpperValid;
+ 		// Parameters covariance matrix (empty if not provided)
+ 		Matrix<T> _Cov;
  		// Model
  		// std::vector<const ParametrizedScalarFunction<T>*> _Model;
  		// Cost function value
@@ -68,6 +83,8 @@
  		unsigned int _nDOF;
  		// Validity
  		bool _isValid;
+ 		// Minimizer telemetry (empty for linear solves)
+ 		MIN::Telemetry _Telemetry;
  	};
 
 
@@ -0,0 +1,411 @@
+/*
+ * Formula.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef FORMULA_HPP
+#define FORMULA_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Globals.hpp"
+#include "Exceptions.hpp"
+#include "ParametrizedFunction.hpp"
+
+BEGIN_NAMESPACE(LQCDA)
+
+/******************************************************************************
+ *                                  Formula                                   *
+ ******************************************************************************/
+
+// Arithmetic expression of variables x0, x1, ... (x stands for x0) and
+// parameters p0, p1, ..., e.g. "p0*exp(-p1*x0) + p2*exp(-p3*x0)".
+// Grammar (usual precedences, ^ is right associative and binds tighter than
+// unary minus):
+//     expr    := term (('+' | '-') term)*
+//     term    := unary (('*' | '/') unary)*
+//     unary   := ('+' | '-') unary | power
+//     power   := primary ('^' unary)?
+//     primary := number | pi | x[k] | p[k] | function '(' expr [',' expr] ')'
+//              | '(' expr ')'
+// with functions exp, log, sqrt, sin, cos, tan, asin, acos, atan, sinh,
+// cosh, tanh, abs (one argument) and pow (two arguments).
+// The expression is parsed into an AST, constant-folded and compiled to a
+// register-based bytecode in two parts: the uniform code only depends on the
+// parameters and is run once per evaluation, the varying code depends on x
+// and is run on batches of points (see ParametrizedFormulaFunction).
+class Formula
+{
+public:
+    // Opcodes
+    enum class OpCode: unsigned char
+    {
+        Const, LoadX, LoadP,
+        Neg, Add, Sub, Mul, Div, Pow,
+        Exp, Log, Sqrt, Sin, Cos, Tan, Asin, Acos, Atan, Sinh, Cosh, Tanh, Abs
+    };
+
+    // dst = op(a, b). Registers [0, nUniformRegisters()) hold values of the
+    // uniform code, the following ones values of the varying code. For LoadX
+    // and LoadP, a is the variable or parameter index, for Const the value is
+    // stored in value.
+    struct Instruction
+    {
+        OpCode op;
+        unsigned int dst;
+        unsigned int a;
+        unsigned int b;
+        double value;
+    };
+
+public:
+    // Constructors/Destructor
+    Formula() = default;
+    explicit Formula(const std::string &expr);
+    ~Formula() = default;
+
+    // Compilation
+    void compile(const std::string &expr);
+
+    // Queries
+    const std::string &expression() const
+    {
+        return _Expr;
+    }
+    // number of variables and parameters used (highest index + 1)
+    unsigned int xDim() const
+    {
+        return _xDim;
+    }
+    unsigned int nPar() const
+    {
+        return _nPar;
+    }
+    unsigned int nUniformRegisters() const
+    {
+        return _nUniform;
+    }
+    unsigned int nRegisters() const
+    {
+        return _nRegisters;
+    }
+    unsigned int result() const
+    {
+        return _Result;
+    }
+    // true if the expression does not depend on x
+    bool isUniform() const
+    {
+        return _Result < _nUniform;
+    }
+    const std::vector<Instruction> &uniformCode() const
+    {
+        return _UniformCode;
+    }
+    const std::vector<Instruction> &varyingCode() const
+    {
+        return _VaryingCode;
+    }
+
+    // Scalar semantics of the arithmetic opcodes
+    template<typename T>
+    static T apply(OpCode op, T a, T b);
+
+private:
+    std::string _Expr;
+    unsigned int _xDim {0};
+    unsigned int _nPar {0};
+    unsigned int _nUniform {0};
+    unsigned int _nRegisters {0};
+    unsigned int _Result {0};
+    std::vector<Instruction> _UniformCode;
+    std::vector<Instruction> _VaryingCode;
+};
+
+std::ostream &operator<<(std::ostream &os, const Formula &f);
+
+template<typename T>
+T Formula::apply(OpCode op, T a, T b)
+{
+    switch (op)
+    {
+    case OpCode::Neg:
+        return -a;
+    case OpCode::Add:
+        return a + b;
+    case OpCode::Sub:
+        return a - b;
+    case OpCode::Mul:
+        return a * b;
+    case OpCode::Div:
+        return a / b;
+    case OpCode::Pow:
+        return std::pow(a, b);
+    case OpCode::Exp:
+        return std::exp(a);
+    case OpCode::Log:
+        return std::log(a);
+    case OpCode::Sqrt:
+        return std::sqrt(a);
+    case OpCode::Sin:
+        return std::sin(a);
+    case OpCode::Cos:
+        return std::cos(a);
+    case OpCode::Tan:
+        return std::tan(a);
+    case OpCode::Asin:
+        return std::asin(a);
+    case OpCode::Acos:
+        return std::acos(a);
+    case OpCode::Atan:
+        return std::atan(a);
+    case OpCode::Sinh:
+        return std::sinh(a);
+    case OpCode::Cosh:
+        return std::cosh(a);
+    case OpCode::Tanh:
+        return std::tanh(a);
+    case OpCode::Abs:
+        return std::abs(a);
+    default:
+        ERROR(LOGIC, "not an arithmetic formula opcode");
+    }
+}
+
+/******************************************************************************
+ *                        ParametrizedFormulaFunction                         *
+ ******************************************************************************/
+
+// Parametrized function defined by a runtime Formula. Points are evaluated
+// in batches of BatchSize: each varying instruction is a simple loop over the
+// batch, which the compiler vectorizes, and the uniform code (parameters and
+// constants only) is run once per evaluateMany() call.
+template<typename T>
+class ParametrizedFormulaFunction
+    : public ParametrizedScalarFunction<T>
+{
+public:
+    // Batch size of the evaluator
+    static constexpr unsigned int BatchSize = 64;
+
+private:
+    // Register buffers, grown on demand and never shrunk
+    struct Workspace
+    {
+        std::vector<T> u;
+        std::vector<T> reg;
+    };
+
+    Formula _Formula;
+
+public:
+    // Constructors/Destructor
+    // The dimensions default to the ones used in the expression, they can be
+    // larger (e.g. a model independent of some variable)
+    explicit ParametrizedFormulaFunction(
+        const std::string &expr,
+        const unsigned int xdim = 0,
+        const unsigned int npar = 0);
+    virtual ~ParametrizedFormulaFunction() = default;
+
+public: // Queries
+    using ParametrizedScalarFunction<T>::xDim;
+    using ParametrizedScalarFunction<T>::yDim;
+    using ParametrizedScalarFunction<T>::nPar;
+    const Formula &formula() const
+    {
+        return _Formula;
+    }
+
+public: // Evaluators
+    virtual T operator()(const T *x, const T *p) const override;
+    using ParametrizedScalarFunction<T>::operator();
+    virtual void evaluateMany(const T *X, unsigned int nPoints, const T *p, T *out) const override;
+
+private:
+    // Workspace of the calling thread, so that evaluations (in particular
+    // single point ones) do not allocate
+    static Workspace &threadWorkspace();
+    void runUniform(const T *p, T *u) const;
+    void runVarying(const T *X, unsigned int n, unsigned int stride, T *reg) const;
+    template<typename F>
+    static void map(T *d, const T *a, unsigned int n, F f)
+    {
+        for (unsigned int i = 0; i < n; ++i)
+        {
+            d[i] = f(a[i]);
+        }
+    }
+    template<typename F>
+    static void map(T *d, const T *a, const T *b, unsigned int n, F f)
+    {
+        for (unsigned int i = 0; i < n; ++i)
+        {
+            d[i] = f(a[i], b[i]);
+        }
+    }
+};
+
+template<typename T>
+ParametrizedFormulaFunction<T>::ParametrizedFormulaFunction(
+    const std::string &expr,
+    const unsigned int xdim,
+    const unsigned int npar)
+    : _Formula(expr)
+{
+    if ((xdim && xdim < _Formula.xDim()) || (npar && npar < _Formula.nPar()))
+    {
+        ERROR(SIZE, "formula \"" + expr + "\" uses " + utils::strFrom(_Formula.xDim())
+              + " variables and " + utils::strFrom(_Formula.nPar()) + " parameters");
+    }
+    this->setSize(xdim ? xdim : _Formula.xDim(), npar ? npar : _Formula.nPar());
+}
+
+template<typename T>
+T ParametrizedFormulaFunction<T>::operator()(const T *x, const T *p) const
+{
+    T res;
+    evaluateMany(x, 1, p, &res);
+    return res;
+}
+
+// Registers hold BatchSize values, uniform ones are broadcast once
+template<typename T>
+void ParametrizedFormulaFunction<T>::evaluateMany(
+    const T *X,
+    unsigned int nPoints,
+    const T *p,
+    T *out) const
+{
+    const unsigned int nu = _Formula.nUniformRegisters();
+    const unsigned int batch = std::min(nPoints, BatchSize);
+    Workspace &ws = threadWorkspace();
+    if (ws.u.size() < nu)
+    {
+        ws.u.resize(nu);
+    }
+    if (ws.reg.size() < _Formula.nRegisters() * batch)
+    {
+        ws.reg.resize(_Formula.nRegisters() * batch);
+    }
+    T *u = ws.u.data(), *reg = ws.reg.data();
+    runUniform(p, u);
+    if (_Formula.isUniform())
+    {
+        std::fill(out, out + nPoints, u[_Formula.result()]);
+        return;
+    }
+    for (unsigned int r = 0; r < nu; ++r)
+    {
+        std::fill(reg + r * batch, reg + (r + 1) * batch, u[r]);
+    }
+    const T *res = reg + _Formula.result() * batch;
+    for (unsigned int k = 0; k < nPoints; k += batch)
+    {
+        unsigned int n = std::min(batch, nPoints - k);
+        runVarying(X + k * xDim(), n, batch, reg);
+        std::copy(res, res + n, out + k);
+    }
+}
+
+template<typename T>
+typename ParametrizedFormulaFunction<T>::Workspace &ParametrizedFormulaFunction<T>::threadWorkspace()
+{
+    static thread_local Workspace ws;
+    return ws;
+}
+
+template<typename T>
+void ParametrizedFormulaFunction<T>::runUniform(const T *p, T *u) const
+{
+    for (auto &ins : _Formula.uniformCode())
+    {
+        switch (ins.op)
+        {
+        case Formula::OpCode::Const:
+            u[ins.dst] = static_cast<T>(ins.value);
+            break;
+        case Formula::OpCode::LoadP:
+            u[ins.dst] = p[ins.a];
+            break;
+        default:
+            u[ins.dst] = Formula::apply(ins.op, u[ins.a], u[ins.b]);
+            break;
+        }
+    }
+}
+
+template<typename T>
+void ParametrizedFormulaFunction<T>::runVarying(
+    const T *X,
+    unsigned int n,
+    unsigned int stride,
+    T *reg) const
+{
+    typedef Formula::OpCode Op;
+    const unsigned int xdim = xDim();
+    for (auto &ins : _Formula.varyingCode())
+    {
+        T *d = reg + ins.dst * stride;
+        const T *a = reg + ins.a * stride;
+        const T *b = reg + ins.b * stride;
+        switch (ins.op)
+        {
+        case Op::LoadX:
+            for (unsigned int i = 0; i < n; ++i)
+            {
+                d[i] = X[i * xdim + ins.a];
+            }
+            break;
+        case Op::Neg:
+            map(d, a, n, [](T v) { return -v; });
+            break;
+        case Op::Add:
+            map(d, a, b, n, [](T v, T w) { return v + w; });
+            break;
+        case Op::Sub:
+            map(d, a, b, n, [](T v, T w) { return v - w; });
+            break;
+        case Op::Mul:
+            map(d, a, b, n, [](T v, T w) { return v * w; });
+            break;
+        case Op::Div:
+            map(d, a, b, n, [](T v, T w) { return v / w; });
+            break;
+        case Op::Pow:
+            map(d, a, b, n, [](T v, T w) { return std::pow(v, w); });
+            break;
+        case Op::Exp:
+            map(d, a, n, [](T v) { return std::exp(v); });
+            break;
+        case Op::Log:
+            map(d, a, n, [](T v) { return std::log(v); });
+            break;
+        case Op::Sqrt:
+            map(d, a, n, [](T v) { return std::sqrt(v); });
+            break;
+        case Op::Cosh:
+            map(d, a, n, [](T v) { return std::cosh(v); });
+            break;
+        case Op::Sinh:
+            map(d, a, n, [](T v) { return std::sinh(v); });
+            break;
+        default:
+            for (unsigned int i = 0; i < n; ++i)
+            {
+                d[i] = Formula::apply(ins.op, a[i], b[i]);
+            }
+            break;
+        }
+    }
+}
+
+END_NAMESPACE // LQCDA
+
+#endif // FORMULA_HPP
@@ -9,6 +9,8 @@
 #define FUNCTION_HPP
 
 #include <functional>
+#include <type_traits>
+#include <utility>
 
 #include "Globals.hpp"
 #include "TypeTraits.hpp"
@@ -39,6 +41,12 @@ public: // Queries
     {
         return 1;
     }
+    // A function which can be evaluated concurrently from several threads
+    // declares it, callers only evaluate it in parallel if it does
+    virtual bool isThreadSafe() const
+    {
+        return false;
+    }
 
 public: // Evaluators
     virtual T operator()(const T *x) const = 0;
@@ -46,6 +54,18 @@ public: // Evaluators
     T operator()(const Vector<T> &x) const;
     template<typename... Ts, typename = typename std::enable_if<are_assignable<T &, Ts...>::value>::type>
     T operator()(const Ts...x) const;
+    // Evaluates nPoints points stored contiguously in X (xDim() values each)
+    virtual void evaluateMany(const T *X, unsigned int nPoints, T *out) const;
+
+public: // Derivatives
+    // A function with an analytic gradient, g_i = df/dx_i (x), declares it by
+    // overriding hasGradient() and gradient(). Minimizers use it instead of
+    // finite differences.
+    virtual bool hasGradient() const
+    {
+        return false;
+    }
+    virtual void gradient(const T *x, T *g) const;
 
 protected: // Assignment
     void setXDim(const unsigned int xdim);
@@ -125,6 +145,206 @@ private: // Data
     function_type m_f;
 };
 
+// Scalar function storing its callable F (T(const T *)) by value. Unlike
+// SFunction, the callable is not type-erased: evaluateMany() calls it
+// directly, so it can be inlined into the loop over points.
+template<typename T, typename F>
+class LambdaFunction
+    : public ScalarFunction<T>
+{
+public: // Typedefs
+    typedef F function_type;
+
+public: // Constructors/Destructor
+    LambdaFunction(const unsigned int xdim, const F &f)
+        : ScalarFunction<T>(xdim)
+        , m_f(f)
+    {}
+    LambdaFunction(const unsigned int xdim, F &&f)
+        : ScalarFunction<T>(xdim)
+        , m_f(std::move(f))
+    {}
+    virtual ~LambdaFunction() = default;
+
+public: // Queries
+    using ScalarFunction<T>::xDim;
+    using ScalarFunction<T>::yDim;
+    const F &function() const
+    {
+        return m_f;
+    }
+
+public: // Evaluators
+    virtual T operator()(const T *x) const override
+    {
+        return m_f(x);
+    }
+    using ScalarFunction<T>::operator();
+    virtual void evaluateMany(const T *X, unsigned int nPoints, T *out) const override
+    {
+        const unsigned int xdim = xDim();
+        for (unsigned int k = 0; k < nPoints; ++k)
+        {
+            out[k] = m_f(X + k * xdim);
+        }
+    }
+
+private: // Data
+    F m_f;
+};
+
+template<typename T, typename F>
+LambdaFunction<T, typename std::decay<F>::type> MakeLambdaFunction(const unsigned int xdim, F &&f)
+{
+    return LambdaFunction<T, typename std::decay<F>::type>(xdim, std::forward<F>(f));
+}
+
+/******************************************************************************
+ *                                Composition                                 *
+ ******************************************************************************/
+
+BEGIN_NAMESPACE(internal)
+
+// Scalar type T of a ScalarFunction<T> (or derived) type F, no type otherwise
+template<typename T>
+T scalarFunctionScalar(const ScalarFunction<T> *);
+template<typename F, typename = void>
+struct ScalarFunctionOf
+{};
+template<typename F>
+struct ScalarFunctionOf<F, decltype(void(scalarFunctionScalar(std::declval<typename std::decay<F>::type *>())))>
+{
+    typedef decltype(scalarFunctionScalar(std::declval<typename std::decay<F>::type *>())) type;
+};
+
+// Function argument F (as deduced by a forwarding reference) held by
+// reference if it is an lvalue, and stored by value if it is a temporary,
+// which would otherwise dangle
+template<typename T, typename F>
+using HeldFunction = typename std::conditional <
+                     std::is_lvalue_reference<F>::value,
+                     const ScalarFunction<T> &,
+                     typename std::decay<F>::type >::type;
+
+END_NAMESPACE // internal
+
+// h(x) = g(f(x)), with g a callable T(T) stored by value and f a
+// ScalarFunction held as F: by reference by default, or by value (F the
+// function type). Evaluations do not allocate: evaluateMany() runs
+// f.evaluateMany() into the output and applies g in place.
+template<typename T, typename G, typename F = const ScalarFunction<T> &>
+class ComposedFunction
+    : public ScalarFunction<T>
+{
+public: // Constructors/Destructor
+    template<typename GG, typename FF>
+    ComposedFunction(GG &&g, FF &&f)
+        : ScalarFunction<T>(f.xDim())
+        , m_g(std::forward<GG>(g))
+        , m_f(std::forward<FF>(f))
+    {}
+    virtual ~ComposedFunction() = default;
+
+public: // Queries
+    using ScalarFunction<T>::xDim;
+    using ScalarFunction<T>::yDim;
+    const G &outer() const
+    {
+        return m_g;
+    }
+    const ScalarFunction<T> &inner() const
+    {
+        return m_f;
+    }
+
+public: // Evaluators
+    virtual T operator()(const T *x) const override
+    {
+        return m_g(inner()(x));
+    }
+    using ScalarFunction<T>::operator();
+    virtual void evaluateMany(const T *X, unsigned int nPoints, T *out) const override
+    {
+        inner().evaluateMany(X, nPoints, out);
+        for (unsigned int k = 0; k < nPoints; ++k)
+        {
+            out[k] = m_g(out[k]);
+        }
+    }
+
+private: // Data
+    G m_g;
+    F m_f;
+};
+
+BEGIN_NAMESPACE(internal)
+
+// One-dimensional ScalarFunction as a callable T(T), held as F (see
+// HeldFunction)
+template<typename T, typename F>
+struct ScalarFunctionCall
+{
+    F f;
+
+    template<typename FF>
+    explicit ScalarFunctionCall(FF &&g)
+        : f(std::forward<FF>(g))
+    {}
+    T operator()(T x) const
+    {
+        return static_cast<const ScalarFunction<T> &>(f)(&x);
+    }
+};
+
+template<typename T>
+struct Shift
+{
+    T c;
+    T operator()(T y) const
+    {
+        return y - c;
+    }
+};
+
+END_NAMESPACE // internal
+
+// Functions passed as temporaries are stored by value in the result, the
+// other ones are held by reference and must outlive it
+template < typename G, typename F, typename T = typename internal::ScalarFunctionOf<F>::type,
+           typename = typename std::enable_if <
+               !std::is_base_of<ScalarFunction<T>, typename std::decay<G>::type>::value >::type >
+ComposedFunction<T, typename std::decay<G>::type, internal::HeldFunction<T, F>> compose(G &&g, F &&f)
+{
+    return ComposedFunction<T, typename std::decay<G>::type, internal::HeldFunction<T, F>>(
+               std::forward<G>(g), std::forward<F>(f));
+}
+template < typename G, typename F, typename T = typename internal::ScalarFunctionOf<F>::type,
+           typename = typename std::enable_if <
+               std::is_base_of<ScalarFunction<T>, typename std::decay<G>::type>::value >::type,
+           typename = void >
+ComposedFunction<T, internal::ScalarFunctionCall<T, internal::HeldFunction<T, G>>, internal::HeldFunction<T, F>>
+        compose(G &&g, F &&f)
+{
+    if (g.xDim() != 1)
+    {
+        ERROR(SIZE, "outer function of a composition must have xDim=1");
+    }
+    return ComposedFunction<T, internal::ScalarFunctionCall<T, internal::HeldFunction<T, G>>, internal::HeldFunction<T, F>>(
+               internal::ScalarFunctionCall<T, internal::HeldFunction<T, G>>(std::forward<G>(g)),
+               std::forward<F>(f));
+}
+
+// f(x) - c, e.g. to solve f(x) = c with a Roots::RootFinder
+template<typename F, typename T = typename internal::ScalarFunctionOf<F>::type>
+ComposedFunction<T, internal::Shift<T>, internal::HeldFunction<T, F>> shift(
+    F &&f,
+    typename internal::ScalarFunctionOf<F>::type c)
+{
+    return ComposedFunction<T, internal::Shift<T>, internal::HeldFunction<T, F>>(
+               internal::Shift<T> {c}, std::forward<F>(f));
+}
+
+
 
 /******************************************************************************
  *                        ScalarFunction<T> definition                        *
@@ -159,6 +379,22 @@ T ScalarFunction<T>::operator()(const Ts... xs) const
     return (*this)(x);
 }
 
+template<typename T>
+void ScalarFunction<T>::evaluateMany(const T *X, unsigned int nPoints, T *out) const
+{
+    const unsigned int xdim = xDim();
+    for (unsigned int k = 0; k < nPoints; ++k)
+    {
+        out[k] = (*this)(X + k * xdim);
+    }
+}
+
+template<typename T>
+void ScalarFunction<T>::gradient(const T *x, T *g) const
+{
+    ERROR(IMPLEMENTATION, "function does not provide its gradient");
+}
+
 template<typename T>
 void ScalarFunction<T>::setXDim(const unsigned int xdim)
 {
@@ -0,0 +1,430 @@
+/*
+ * GSLMultiRootFinder.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef GSL_MULTI_ROOT_FINDER_HPP
+#define GSL_MULTI_ROOT_FINDER_HPP
+
+#include <cmath>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_matrix.h>
+#include <gsl/gsl_multiroots.h>
+#include <gsl/gsl_vector.h>
+
+#include "Globals.hpp"
+#include "Exceptions.hpp"
+#include "Function.hpp"
+#include "RootFinder.hpp"
+#include "GSLUtils.hpp"
+
+BEGIN_NAMESPACE(LQCDA)
+BEGIN_NAMESPACE(Roots)
+
+/******************************************************************************
+ *                             GSLMultiRootFinder                             *
+ ******************************************************************************/
+
+// Solves the n conditions f_k(x) = 0 for the n unknowns x, e.g. the tuning of
+// several bare parameters at once, iterating from an initial guess x0 with a
+// gsl_multiroot solver. The Jacobian is computed by finite differences
+// (Hybrids, Hybrid, DNewton), approximated by rank-1 updates (Broyden), or
+// given by the caller (HybridsJ, HybridJ, Newton, GNewton, see the Jacobian
+// overloads of solve()). The error of each unknown is the size of its last
+// step, and the roots reached on options.max_iter have converged() false.
+// An exception thrown by the conditions or the Jacobian is rethrown by
+// solve() once GSL returns.
+template<typename T>
+class GSLMultiRootFinder
+{
+public:
+    // Algorithms
+    enum class Algorithm
+    {
+        Hybrids, Hybrid, DNewton, Broyden,
+        // with an analytic Jacobian
+        HybridsJ, HybridJ, Newton, GNewton
+    };
+
+    // Jacobian of the conditions at x, jac[k * n + j] = df_k / dx_j
+    typedef std::function<void(const T *x, T *jac)> Jacobian;
+
+    // Options
+    struct Options
+    {
+        // maximum number of iterations of a solve
+        unsigned int max_iter;
+        // absolute tolerance on sum_k |f_k(x)| at the roots
+        double residual;
+
+        Options()
+            : max_iter {1000}
+            , residual {1.e-8}
+        {}
+    };
+
+    Options options;
+
+private:
+    // exactly one of the two is set, depending on the algorithm
+    const gsl_multiroot_fsolver_type *_Type {nullptr};
+    const gsl_multiroot_fdfsolver_type *_FdfType {nullptr};
+
+public:
+    // Constructors/Destructor
+    explicit GSLMultiRootFinder(Algorithm algorithm = Algorithm::Hybrids);
+    ~GSLMultiRootFinder() = default;
+
+    // Queries
+    bool needsJacobian() const
+    {
+        return _FdfType != nullptr;
+    }
+
+    // Solve
+    std::vector<Root<T>> solve(
+        const std::vector<const ScalarFunction<T> *> &f,
+        const std::vector<T> &x0,
+        double epsrel = 1.e-4);
+    std::vector<Root<T>> solve(
+        const std::vector<const ScalarFunction<T> *> &f,
+        const Vector<T> &x0,
+        double epsrel = 1.e-4);
+    // with the Jacobian df of the conditions
+    std::vector<Root<T>> solve(
+        const std::vector<const ScalarFunction<T> *> &f,
+        const Jacobian &df,
+        const std::vector<T> &x0,
+        double epsrel = 1.e-4);
+    std::vector<Root<T>> solve(
+        const std::vector<const ScalarFunction<T> *> &f,
+        const Jacobian &df,
+        const Vector<T> &x0,
+        double epsrel = 1.e-4);
+
+private:
+    // Conditions, Jacobian and buffers, passed to GSL. An exception thrown
+    // by the conditions or the Jacobian cannot cross GSL, it is stored in
+    // error and the callback fails.
+    struct Params
+    {
+        const std::vector<const ScalarFunction<T> *> *f;
+        const Jacobian *df;
+        std::vector<T> x;
+        std::vector<T> jac;
+        std::exception_ptr error;
+    };
+    void checkConditions(const std::vector<const ScalarFunction<T> *> &f,
+                         const std::vector<T> &x0) const;
+    template<typename Solver>
+    std::vector<Root<T>> iterate(Solver *solver, int (*step)(Solver *), const Params &params,
+                                 double epsrel) const;
+    static void setX(Params &params, const gsl_vector *x);
+    static int conditions(const gsl_vector *x, void *p, gsl_vector *y);
+    static int jacobian(const gsl_vector *x, void *p, gsl_matrix *jac);
+    static int conditionsAndJacobian(const gsl_vector *x, void *p, gsl_vector *y, gsl_matrix *jac);
+};
+
+template<typename T>
+GSLMultiRootFinder<T>::GSLMultiRootFinder(Algorithm algorithm)
+{
+    switch (algorithm)
+    {
+    case Algorithm::Hybrids:
+        _Type = gsl_multiroot_fsolver_hybrids;
+        break;
+    case Algorithm::Hybrid:
+        _Type = gsl_multiroot_fsolver_hybrid;
+        break;
+    case Algorithm::DNewton:
+        _Type = gsl_multiroot_fsolver_dnewton;
+        break;
+    case Algorithm::Broyden:
+        _Type = gsl_multiroot_fsolver_broyden;
+        break;
+    case Algorithm::HybridsJ:
+        _FdfType = gsl_multiroot_fdfsolver_hybridsj;
+        break;
+    case Algorithm::HybridJ:
+        _FdfType = gsl_multiroot_fdfsolver_hybridj;
+        break;
+    case Algorithm::Newton:
+        _FdfType = gsl_multiroot_fdfsolver_newton;
+        break;
+    case Algorithm::GNewton:
+        _FdfType = gsl_multiroot_fdfsolver_gnewton;
+        break;
+    }
+}
+
+template<typename T>
+std::vector<Root<T>> GSLMultiRootFinder<T>::solve(
+    const std::vector<const ScalarFunction<T> *> &f,
+    const std::vector<T> &x0,
+    double epsrel)
+{
+    if (needsJacobian())
+    {
+        ERROR(LOGIC, "this multiroot algorithm needs the Jacobian of the conditions");
+    }
+    checkConditions(f, x0);
+    const unsigned int n = f.size();
+
+    std::unique_ptr<gsl_multiroot_fsolver, decltype(&gsl_multiroot_fsolver_free)> solver(
+        gsl_multiroot_fsolver_alloc(_Type, n), gsl_multiroot_fsolver_free);
+    std::unique_ptr<gsl_vector, decltype(&gsl_vector_free)> x(
+        gsl_vector_alloc(n), gsl_vector_free);
+    if (!solver || !x)
+    {
+        ERROR(MEMORY, "GSL multiroot solver allocation failed");
+    }
+    for (unsigned int k = 0; k < n; ++k)
+    {
+        gsl_vector_set(x.get(), k, x0[k]);
+    }
+
+    Params params {&f, nullptr, std::vector<T>(n), std::vector<T>(), nullptr};
+    gsl_multiroot_function fun;
+    fun.f = &GSLMultiRootFinder<T>::conditions;
+    fun.n = n;
+    fun.params = &params;
+
+    // GSL errors are returned as statuses rather than aborting
+    GSLErrorGuard guard;
+    int status = gsl_multiroot_fsolver_set(solver.get(), &fun, x.get());
+    if (params.error)
+    {
+        std::rethrow_exception(params.error);
+    }
+    if (status != GSL_SUCCESS)
+    {
+        ERROR(RUNTIME, std::string("multiroot solver initialization failed: ") + gsl_strerror(status));
+    }
+    return iterate(solver.get(), &gsl_multiroot_fsolver_iterate, params, epsrel);
+}
+
+template<typename T>
+std::vector<Root<T>> GSLMultiRootFinder<T>::solve(
+    const std::vector<const ScalarFunction<T> *> &f,
+    const Vector<T> &x0,
+    double epsrel)
+{
+    return solve(f, std::vector<T>(x0.data(), x0.data() + x0.size()), epsrel);
+}
+
+template<typename T>
+std::vector<Root<T>> GSLMultiRootFinder<T>::solve(
+    const std::vector<const ScalarFunction<T> *> &f,
+    const Jacobian &df,
+    const std::vector<T> &x0,
+    double epsrel)
+{
+    if (!needsJacobian())
+    {
+        ERROR(LOGIC, "this multiroot algorithm does not use the Jacobian of the conditions");
+    }
+    if (!df)
+    {
+        ERROR(NULLPTR, "empty Jacobian in multidimensional root finding");
+    }
+    checkConditions(f, x0);
+    const unsigned int n = f.size();
+
+    std::unique_ptr<gsl_multiroot_fdfsolver, decltype(&gsl_multiroot_fdfsolver_free)> solver(
+        gsl_multiroot_fdfsolver_alloc(_FdfType, n), gsl_multiroot_fdfsolver_free);
+    std::unique_ptr<gsl_vector, decltype(&gsl_vector_free)> x(
+        gsl_vector_alloc(n), gsl_vector_free);
+    if (!solver || !x)
+    {
+        ERROR(MEMORY, "GSL multiroot solver allocation failed");
+    }
+    for (unsigned int k = 0; k < n; ++k)
+    {
+        gsl_vector_set(x.get(), k, x0[k]);
+    }
+
+    Params params {&f, &df, std::vector<T>(n), std::vector<T>(n * n), nullptr};
+    gsl_multiroot_function_fdf fun;
+    fun.f = &GSLMultiRootFinder<T>::conditions;
+    fun.df = &GSLMultiRootFinder<T>::jacobian;
+    fun.fdf = &GSLMultiRootFinder<T>::conditionsAndJacobian;
+    fun.n = n;
+    fun.params = &params;
+
+    // GSL errors are returned as statuses rather than aborting
+    GSLErrorGuard guard;
+    int status = gsl_multiroot_fdfsolver_set(solver.get(), &fun, x.get());
+    if (params.error)
+    {
+        std::rethrow_exception(params.error);
+    }
+    if (status != GSL_SUCCESS)
+    {
+        ERROR(RUNTIME, std::string("multiroot solver initialization failed: ") + gsl_strerror(status));
+    }
+    return iterate(solver.get(), &gsl_multiroot_fdfsolver_iterate, params, epsrel);
+}
+
+template<typename T>
+std::vector<Root<T>> GSLMultiRootFinder<T>::solve(
+    const std::vector<const ScalarFunction<T> *> &f,
+    const Jacobian &df,
+    const Vector<T> &x0,
+    double epsrel)
+{
+    return solve(f, df, std::vector<T>(x0.data(), x0.data() + x0.size()), epsrel);
+}
+
+template<typename T>
+void GSLMultiRootFinder<T>::checkConditions(
+    const std::vector<const ScalarFunction<T> *> &f,
+    const std::vector<T> &x0) const
+{
+    const unsigned int n = f.size();
+    if (n == 0 || x0.size() != n)
+    {
+        ERROR(SIZE, "multidimensional root finding needs as many conditions as unknowns (got "
+              + utils::strFrom(n) + " conditions and " + utils::strFrom(x0.size()) + " unknowns)");
+    }
+    for (auto fk : f)
+    {
+        if (!fk)
+        {
+            ERROR(NULLPTR, "null condition in multidimensional root finding");
+        }
+        if (fk->xDim() != n)
+        {
+            ERROR(SIZE, "condition x-dimension does not match the number of unknowns");
+        }
+    }
+}
+
+// Iterates until the steps are below epsrel relative to x and the residuals
+// below options.residual, or options.max_iter is reached
+template<typename T>
+template<typename Solver>
+std::vector<Root<T>> GSLMultiRootFinder<T>::iterate(Solver *solver, int (*step)(Solver *), const Params &params,
+                                                    double epsrel) const
+{
+    int status;
+    unsigned int iter = 0;
+    do
+    {
+        iter++;
+        status = step(solver);
+        if (params.error)
+        {
+            std::rethrow_exception(params.error);
+        }
+        if (status != GSL_SUCCESS)
+        {
+            ERROR(RUNTIME, std::string("multiroot solver failed: ") + gsl_strerror(status));
+        }
+        status = gsl_multiroot_test_delta(solver->dx, solver->x, 0., epsrel);
+        if (status == GSL_SUCCESS)
+        {
+            status = gsl_multiroot_test_residual(solver->f, options.residual);
+        }
+        if (status != GSL_SUCCESS && status != GSL_CONTINUE)
+        {
+            ERROR(RUNTIME, std::string("multiroot solver failed: ") + gsl_strerror(status));
+        }
+    }
+    while (status == GSL_CONTINUE && iter < options.max_iter);
+
+    const unsigned int n = solver->x->size;
+    std::vector<Root<T>> roots;
+    roots.reserve(n);
+    for (unsigned int k = 0; k < n; ++k)
+    {
+        roots.emplace_back(gsl_vector_get(solver->x, k), std::abs(gsl_vector_get(solver->dx, k)),
+                           status == GSL_SUCCESS);
+    }
+    return roots;
+}
+
+template<typename T>
+void GSLMultiRootFinder<T>::setX(Params &params, const gsl_vector *x)
+{
+    const unsigned int n = params.x.size();
+    for (unsigned int k = 0; k < n; ++k)
+    {
+        params.x[k] = gsl_vector_get(x, k);
+    }
+}
+
+template<typename T>
+int GSLMultiRootFinder<T>::conditions(const gsl_vector *x, void *p, gsl_vector *y)
+{
+    Params &params = *static_cast<Params *>(p);
+    const unsigned int n = params.x.size();
+    setX(params, x);
+    try
+    {
+        for (unsigned int k = 0; k < n; ++k)
+        {
+            T fk = (*(*params.f)[k])(params.x.data());
+            if (!std::isfinite(fk))
+            {
+                return GSL_EDOM;
+            }
+            gsl_vector_set(y, k, fk);
+        }
+    }
+    catch (...)
+    {
+        params.error = std::current_exception();
+        return GSL_EFAILED;
+    }
+    return GSL_SUCCESS;
+}
+
+template<typename T>
+int GSLMultiRootFinder<T>::jacobian(const gsl_vector *x, void *p, gsl_matrix *jac)
+{
+    Params &params = *static_cast<Params *>(p);
+    const unsigned int n = params.x.size();
+    setX(params, x);
+    try
+    {
+        (*params.df)(params.x.data(), params.jac.data());
+    }
+    catch (...)
+    {
+        params.error = std::current_exception();
+        return GSL_EFAILED;
+    }
+    for (unsigned int k = 0; k < n; ++k)
+    {
+        for (unsigned int j = 0; j < n; ++j)
+        {
+            T jkj = params.jac[k * n + j];
+            if (!std::isfinite(jkj))
+            {
+                return GSL_EDOM;
+            }
+            gsl_matrix_set(jac, k, j, jkj);
+        }
+    }
+    return GSL_SUCCESS;
+}
+
+template<typename T>
+int GSLMultiRootFinder<T>::conditionsAndJacobian(const gsl_vector *x, void *p, gsl_vector *y, gsl_matrix *jac)
+{
+    int status = conditions(x, p, y);
+    return status == GSL_SUCCESS ? jacobian(x, p, jac) : status;
+}
+
+END_NAMESPACE // Roots
+END_NAMESPACE // LQCDA
+
+#endif // GSL_MULTI_ROOT_FINDER_HPP
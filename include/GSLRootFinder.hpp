@@ -8,7 +8,13 @@
 #ifndef GSL_ROOT_FINDER_HPP
 #define GSL_ROOT_FINDER_HPP
 
+ #include <cmath>
+ #include <exception>
+ #include <limits>
+
  #include "RootFinder.hpp"
+ #include "NumericalDerivatives.hpp"
+ #include "GSLUtils.hpp"
 
  #include <gsl/gsl_errno.h>
  #include <gsl/gsl_roots.h>
@@ -21,10 +27,13 @@
  : public RootFinder<T>
  {
  protected:
+ 	const gsl_root_fsolver_type* _Type;
  	std::unique_ptr<gsl_root_fsolver, decltype(&gsl_root_fsolver_free)> _Solver{nullptr, nullptr};
 
- 	//Constructor
- 	GSLRootFinder(gsl_root_fsolver* solver);
+ 	// Constructors
+ 	GSLRootFinder(const gsl_root_fsolver_type* type);
+ 	// allocates a new solver of the same type
+ 	GSLRootFinder(const GSLRootFinder& other);
 
  public:
  	// Pure virtual destructor
@@ -35,9 +44,27 @@
  };
 
  template<typename T>
- GSLRootFinder<T>::GSLRootFinder(gsl_root_fsolver* solver)
- : _Solver(solver, gsl_root_fsolver_free)
- {}
+ GSLRootFinder<T>::GSLRootFinder(const gsl_root_fsolver_type* type)
+ : _Type(type)
+ , _Solver(gsl_root_fsolver_alloc(type), gsl_root_fsolver_free)
+ {
+ 	if(!_Solver)
+ 	{
+ 		ERROR(MEMORY, "GSL root solver allocation failed");
+ 	}
+ }
+
+ template<typename T>
+ GSLRootFinder<T>::GSLRootFinder(const GSLRootFinder& other)
+ : RootFinder<T>(other)
+ , _Type(other._Type)
+ , _Solver(gsl_root_fsolver_alloc(other._Type), gsl_root_fsolver_free)
+ {
+ 	if(!_Solver)
+ 	{
+ 		ERROR(MEMORY, "GSL root solver allocation failed");
+ 	}
+ }
 
  template<typename T>
  GSLRootFinder<T>::~GSLRootFinder<T>() {}
@@ -47,32 +74,71 @@
  {
  	double r = 0.;
  	int status;
- 	int iter = 0, max_iter = 100;
+ 	unsigned int iter = 0, max_iter = this->options.max_iter;
  	double x_lo = xmin;
  	double x_hi = xmax;
 
+ 	// An exception thrown by f cannot cross GSL: it is stored, GSL gets a NaN
+ 	// (and fails), and the exception is rethrown once GSL returns
+ 	struct Params
+ 	{
+ 		const ScalarFunction<T>* f;
+ 		std::exception_ptr error;
+ 	} params{&f, nullptr};
  	gsl_function fun;
  	fun.function = [](double x, void * p)->double
  		{
- 			return (*static_cast<const ScalarFunction<T>*>(p))(&x);
+ 			Params* params = static_cast<Params*>(p);
+ 			try
+ 			{
+ 				return (*params->f)(&x);
+ 			}
+ 			catch(...)
+ 			{
+ 				params->error = std::current_exception();
+ 				return std::numeric_limits<double>::quiet_NaN();
+ 			}
  		};
- 	fun.params = const_cast<ScalarFunction<T>*>(&f);
+ 	fun.params = &params;
 
- 	gsl_root_fsolver_set(_Solver.get(), &fun, x_lo, x_hi);
+ 	// GSL errors are returned as statuses rather than aborting
+ 	GSLErrorGuard guard;
+ 	status = gsl_root_fsolver_set(_Solver.get(), &fun, x_lo, x_hi);
+ 	if(params.error)
+ 	{
+ 		std::rethrow_exception(params.error);
+ 	}
+ 	if(status != GSL_SUCCESS)
+ 	{
+ 		ERROR(RUNTIME, "root solver initialization on [" + utils::strFrom(xmin) + ", "
+ 			+ utils::strFrom(xmax) + "] failed: " + gsl_strerror(status));
+ 	}
 
  	do {
  		iter++;
  		status = gsl_root_fsolver_iterate(_Solver.get());
+ 		if(params.error)
+ 		{
+ 			std::rethrow_exception(params.error);
+ 		}
+ 		if(status != GSL_SUCCESS)
+ 		{
+ 			ERROR(RUNTIME, std::string("root solver failed: ") + gsl_strerror(status));
+ 		}
  		r = gsl_root_fsolver_root(_Solver.get());
 
  		x_lo = gsl_root_fsolver_x_lower(_Solver.get());
  		x_hi = gsl_root_fsolver_x_upper(_Solver.get());
  		
  		status = gsl_root_test_interval(x_lo, x_hi, 0., epsrel);
+ 		if(status != GSL_SUCCESS && status != GSL_CONTINUE)
+ 		{
+ 			ERROR(RUNTIME, std::string("root solver failed: ") + gsl_strerror(status));
+ 		}
 
  	} while(status == GSL_CONTINUE && iter < max_iter);
 
- 	return Root<T>(r, x_hi-x_lo);
+ 	return Root<T>(r, x_hi-x_lo, status == GSL_SUCCESS);
  }
 
  template<typename T>
@@ -82,12 +148,293 @@
  public:
  	// Constructor/Destructor
  	BrentRootFinder();
+ 	BrentRootFinder(const BrentRootFinder&) = default;
  	virtual ~BrentRootFinder() = default;
+
+ 	virtual std::unique_ptr<RootFinder<T>> clone() const override
+ 	{
+ 		return std::unique_ptr<RootFinder<T>>(new BrentRootFinder<T>(*this));
+ 	}
  };
 
  template<typename T> 
  BrentRootFinder<T>::BrentRootFinder()
- : GSLRootFinder<T>(gsl_root_fsolver_alloc(gsl_root_fsolver_brent))
+ : GSLRootFinder<T>(gsl_root_fsolver_brent)
+ {}
+
+ // Derivative-based (polishing) solvers, iterating from an initial guess x0
+ // with the derivative df of f, or with a finite difference derivative (see
+ // polish()). They converge much faster than bracketing solvers near the
+ // root, but may diverge from a poor guess. Through the bracketing interface
+ // (solve(f, xmin, xmax), solveMany()), the guess is the middle of the
+ // bracket, and a root outside of the bracket is an error.
+ template<typename T>
+ class GSLFdfRootFinder
+ : public RootFinder<T>
+ {
+ protected:
+ 	const gsl_root_fdfsolver_type* _Type;
+ 	std::unique_ptr<gsl_root_fdfsolver, decltype(&gsl_root_fdfsolver_free)> _Solver{nullptr, nullptr};
+
+ 	// Constructors
+ 	GSLFdfRootFinder(const gsl_root_fdfsolver_type* type);
+ 	// allocates a new solver of the same type
+ 	GSLFdfRootFinder(const GSLFdfRootFinder& other);
+
+ public:
+ 	// Pure virtual destructor
+ 	virtual ~GSLFdfRootFinder() =0;
+
+ 	// Iterates from x0, with the derivative df or a finite difference one
+ 	Root<T> polish(const ScalarFunction<T>& f, const ScalarFunction<T>& df, T x0, double epsrel =1.e-4);
+ 	Root<T> polish(const ScalarFunction<T>& f, T x0, double epsrel =1.e-4);
+
+ private:
+ 	// Function and derivative, passed to GSL. An exception thrown by them
+ 	// cannot cross GSL: it is stored, GSL gets a NaN (and fails), and the
+ 	// exception is rethrown once GSL returns.
+ 	struct Params
+ 	{
+ 		const ScalarFunction<T>* f;
+ 		const ScalarFunction<T>* df;
+ 		const NumericalDerivatives<T>* nd;
+ 		mutable std::exception_ptr error;
+
+ 		double derivative(double x) const
+ 		{
+ 			T g;
+ 			if(df)
+ 			{
+ 				g = (*df)(&x);
+ 			}
+ 			else
+ 			{
+ 				T xt = x;
+ 				nd->gradient(&xt, &g);
+ 			}
+ 			return g;
+ 		}
+ 	};
+
+ 	virtual Root<T> solve_h(const ScalarFunction<T>& f, T xmin, T xmax, double epsrel) override;
+ 	Root<T> iterate(const Params& params, T x0, double epsrel);
+ };
+
+ template<typename T>
+ GSLFdfRootFinder<T>::GSLFdfRootFinder(const gsl_root_fdfsolver_type* type)
+ : _Type(type)
+ , _Solver(gsl_root_fdfsolver_alloc(type), gsl_root_fdfsolver_free)
+ {
+ 	if(!_Solver)
+ 	{
+ 		ERROR(MEMORY, "GSL root solver allocation failed");
+ 	}
+ }
+
+ template<typename T>
+ GSLFdfRootFinder<T>::GSLFdfRootFinder(const GSLFdfRootFinder& other)
+ : RootFinder<T>(other)
+ , _Type(other._Type)
+ , _Solver(gsl_root_fdfsolver_alloc(other._Type), gsl_root_fdfsolver_free)
+ {
+ 	if(!_Solver)
+ 	{
+ 		ERROR(MEMORY, "GSL root solver allocation failed");
+ 	}
+ }
+
+ template<typename T>
+ GSLFdfRootFinder<T>::~GSLFdfRootFinder<T>() {}
+
+ template<typename T>
+ Root<T> GSLFdfRootFinder<T>::polish(const ScalarFunction<T>& f, const ScalarFunction<T>& df, T x0, double epsrel)
+ {
+ 	if(f.xDim() != 1 || df.xDim() != 1)
+ 	{
+ 		ERROR(SIZE, "root finding only accepts xDim=1 functions");
+ 	}
+ 	return iterate(Params{&f, &df, nullptr, nullptr}, x0, epsrel);
+ }
+
+ template<typename T>
+ Root<T> GSLFdfRootFinder<T>::polish(const ScalarFunction<T>& f, T x0, double epsrel)
+ {
+ 	if(f.xDim() != 1)
+ 	{
+ 		ERROR(SIZE, "root finding only accepts xDim=1 functions");
+ 	}
+ 	NumericalDerivatives<T> nd(f, Vector<T>::Ones(1));
+ 	return iterate(Params{&f, nullptr, &nd, nullptr}, x0, epsrel);
+ }
+
+ template<typename T>
+ Root<T> GSLFdfRootFinder<T>::solve_h(const ScalarFunction<T>& f, T xmin, T xmax, double epsrel)
+ {
+ 	Root<T> r = polish(f, (xmin + xmax) / 2, epsrel);
+ 	if(r.value() < xmin || r.value() > xmax)
+ 	{
+ 		ERROR(RUNTIME, "root " + utils::strFrom(r.value()) + " found outside of ["
+ 			+ utils::strFrom(xmin) + ", " + utils::strFrom(xmax) + "]");
+ 	}
+ 	return r;
+ }
+
+ template<typename T>
+ Root<T> GSLFdfRootFinder<T>::iterate(const Params& params, T x0, double epsrel)
+ {
+ 	int status;
+ 	unsigned int iter = 0, max_iter = this->options.max_iter;
+ 	double x = x0, x_prev = x0;
+
+ 	gsl_function_fdf fun;
+ 	fun.f = [](double x, void * p)->double
+ 		{
+ 			const Params* params = static_cast<const Params*>(p);
+ 			try
+ 			{
+ 				return (*params->f)(&x);
+ 			}
+ 			catch(...)
+ 			{
+ 				params->error = std::current_exception();
+ 				return std::numeric_limits<double>::quiet_NaN();
+ 			}
+ 		};
+ 	fun.df = [](double x, void * p)->double
+ 		{
+ 			const Params* params = static_cast<const Params*>(p);
+ 			try
+ 			{
+ 				return params->derivative(x);
+ 			}
+ 			catch(...)
+ 			{
+ 				params->error = std::current_exception();
+ 				return std::numeric_limits<double>::quiet_NaN();
+ 			}
+ 		};
+ 	fun.fdf = [](double x, void * p, double * y, double * dy)
+ 		{
+ 			const Params* params = static_cast<const Params*>(p);
+ 			try
+ 			{
+ 				*y = (*params->f)(&x);
+ 				*dy = params->derivative(x);
+ 			}
+ 			catch(...)
+ 			{
+ 				params->error = std::current_exception();
+ 				*y = *dy = std::numeric_limits<double>::quiet_NaN();
+ 			}
+ 		};
+ 	fun.params = const_cast<Params*>(&params);
+
+ 	// GSL errors are returned as statuses rather than aborting
+ 	GSLErrorGuard guard;
+ 	status = gsl_root_fdfsolver_set(_Solver.get(), &fun, x);
+ 	if(params.error)
+ 	{
+ 		std::rethrow_exception(params.error);
+ 	}
+ 	if(status != GSL_SUCCESS)
+ 	{
+ 		ERROR(RUNTIME, "root solver initialization at " + utils::strFrom(x0) + " failed: "
+ 			+ gsl_strerror(status));
+ 	}
+
+ 	do {
+ 		iter++;
+ 		status = gsl_root_fdfsolver_iterate(_Solver.get());
+ 		if(params.error)
+ 		{
+ 			std::rethrow_exception(params.error);
+ 		}
+ 		if(status != GSL_SUCCESS)
+ 		{
+ 			ERROR(RUNTIME, std::string("root solver failed: ") + gsl_strerror(status));
+ 		}
+ 		x_prev = x;
+ 		x = gsl_root_fdfsolver_root(_Solver.get());
+ 		if(!std::isfinite(x))
+ 		{
+ 			ERROR(RUNTIME, "root solver diverged");
+ 		}
+
+ 		status = gsl_root_test_delta(x, x_prev, 0., epsrel);
+ 		if(status != GSL_SUCCESS && status != GSL_CONTINUE)
+ 		{
+ 			ERROR(RUNTIME, std::string("root solver failed: ") + gsl_strerror(status));
+ 		}
+
+ 	} while(status == GSL_CONTINUE && iter < max_iter);
+
+ 	return Root<T>(x, std::abs(x - x_prev), status == GSL_SUCCESS);
+ }
+
+ // Newton's method, x <- x - f(x) / f'(x)
+ template<typename T>
+ class NewtonRootFinder
+ : public GSLFdfRootFinder<T>
+ {
+ public:
+ 	// Constructor/Destructor
+ 	NewtonRootFinder();
+ 	NewtonRootFinder(const NewtonRootFinder&) = default;
+ 	virtual ~NewtonRootFinder() = default;
+
+ 	virtual std::unique_ptr<RootFinder<T>> clone() const override
+ 	{
+ 		return std::unique_ptr<RootFinder<T>>(new NewtonRootFinder<T>(*this));
+ 	}
+ };
+
+ template<typename T>
+ NewtonRootFinder<T>::NewtonRootFinder()
+ : GSLFdfRootFinder<T>(gsl_root_fdfsolver_newton)
+ {}
+
+ // Secant method, the derivative is only evaluated at the first step
+ template<typename T>
+ class SecantRootFinder
+ : public GSLFdfRootFinder<T>
+ {
+ public:
+ 	// Constructor/Destructor
+ 	SecantRootFinder();
+ 	SecantRootFinder(const SecantRootFinder&) = default;
+ 	virtual ~SecantRootFinder() = default;
+
+ 	virtual std::unique_ptr<RootFinder<T>> clone() const override
+ 	{
+ 		return std::unique_ptr<RootFinder<T>>(new SecantRootFinder<T>(*this));
+ 	}
+ };
+
+ template<typename T>
+ SecantRootFinder<T>::SecantRootFinder()
+ : GSLFdfRootFinder<T>(gsl_root_fdfsolver_secant)
+ {}
+
+ // Newton's method with Steffensen's acceleration
+ template<typename T>
+ class SteffensenRootFinder
+ : public GSLFdfRootFinder<T>
+ {
+ public:
+ 	// Constructor/Destructor
+ 	SteffensenRootFinder();
+ 	SteffensenRootFinder(const SteffensenRootFinder&) = default;
+ 	virtual ~SteffensenRootFinder() = default;
+
+ 	virtual std::unique_ptr<RootFinder<T>> clone() const override
+ 	{
+ 		return std::unique_ptr<RootFinder<T>>(new SteffensenRootFinder<T>(*this));
+ 	}
+ };
+
+ template<typename T>
+ SteffensenRootFinder<T>::SteffensenRootFinder()
+ : GSLFdfRootFinder<T>(gsl_root_fdfsolver_steffenson)
  {}
 
 
@@ -0,0 +1,73 @@
+/*
+ * GSLUtils.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef GSL_UTILS_HPP
+#define GSL_UTILS_HPP
+
+#include <mutex>
+
+#include <gsl/gsl_errno.h>
+
+#include "Globals.hpp"
+
+BEGIN_NAMESPACE(LQCDA)
+
+/******************************************************************************
+ *                              GSLErrorGuard                                 *
+ ******************************************************************************/
+
+// Turns the GSL error handler off while at least one guard is alive, so that
+// GSL errors are only reported through the returned status codes, which the
+// callers check and turn into exceptions, instead of the default handler,
+// which aborts the process. The handler is global in GSL: guards are counted
+// under a mutex, the first one turns the handler off and the last one
+// restores the previous handler, so guards can be used from several threads
+// at once.
+class GSLErrorGuard
+{
+public:
+    // Constructors/Destructor
+    GSLErrorGuard()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        if (count()++ == 0)
+        {
+            previous() = gsl_set_error_handler_off();
+        }
+    }
+    GSLErrorGuard(const GSLErrorGuard &) = delete;
+    GSLErrorGuard &operator=(const GSLErrorGuard &) = delete;
+    ~GSLErrorGuard()
+    {
+        std::lock_guard<std::mutex> lock(mutex());
+        if (--count() == 0)
+        {
+            gsl_set_error_handler(previous());
+        }
+    }
+
+private:
+    static std::mutex &mutex()
+    {
+        static std::mutex m;
+        return m;
+    }
+    static unsigned int &count()
+    {
+        static unsigned int n = 0;
+        return n;
+    }
+    static gsl_error_handler_t *&previous()
+    {
+        static gsl_error_handler_t *h = nullptr;
+        return h;
+    }
+};
+
+END_NAMESPACE // LQCDA
+
+#endif // GSL_UTILS_HPP
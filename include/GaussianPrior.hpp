@@ -0,0 +1,221 @@
+/*
+ * GaussianPrior.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef GAUSSIAN_PRIOR_HPP
+#define GAUSSIAN_PRIOR_HPP
+
+#include "Globals.hpp"
+#include "Exceptions.hpp"
+
+#include <Eigen/Cholesky>
+
+BEGIN_NAMESPACE(LQCDA)
+
+/******************************************************************************
+ *                               GaussianPrior                                *
+ ******************************************************************************/
+
+// Gaussian priors on (a subset of) the parameters of a fit, given either
+// parameter by parameter or as correlated blocks. Each block is stored with
+// its whitening matrix W = L^{-1} (cov = L L^T), so that the prior enters the
+// chi2 as the additional whitened residuals W (p - mean).
+template<typename T>
+class GaussianPrior
+{
+public:
+    // Typedefs
+    typedef T Scalar;
+
+private:
+    // Structs
+    struct Block
+    {
+        // parameters indices
+        std::vector<index_t> ind;
+        // prior mean
+        Vector<T> mean;
+        // whitening matrix
+        Matrix<T> w;
+    };
+
+public:
+    // Constructors / Destructor
+    explicit GaussianPrior(unsigned int npar = 0);
+    ~GaussianPrior() = default;
+
+    // Prior modifiers
+    void setPrior(index_t i, T mean, T sigma);
+    void setCorrelatedPrior(
+        const std::vector<index_t> &ind,
+        const Vector<T> &mean,
+        const Matrix<T> &cov);
+    void clear();
+
+    // Prior access
+    unsigned int nPar() const { return m_nPar; }
+    bool hasPrior(index_t i) const;
+    unsigned int nResiduals() const { return m_nRes; }
+    bool empty() const { return m_nRes == 0; }
+
+    // Whitened residuals W (p - mean), r must hold nResiduals() values
+    void residuals(const T *p, T *r) const;
+    // Whitened linear system, residuals = P p - y
+    void linearSystem(Matrix<T> &P, Vector<T> &y) const;
+    // Adds P^T r to g (half the gradient of |r|^2 for r = residuals(p))
+    void addTransposed(const T *r, T *g) const;
+
+private:
+    void checkIndex(index_t i) const;
+
+private:
+    unsigned int m_nPar;
+    unsigned int m_nRes {0};
+    std::vector<Block> m_Blocks;
+};
+
+template<typename T>
+GaussianPrior<T>::GaussianPrior(unsigned int npar)
+    : m_nPar(npar)
+{}
+
+template<typename T>
+void GaussianPrior<T>::setPrior(index_t i, T mean, T sigma)
+{
+    checkIndex(i);
+    if (!(sigma > T {0}))
+    {
+        ERROR(LOGIC, "prior width must be positive (parameter "
+              + utils::strFrom(i) + ")");
+    }
+    Block b;
+    b.ind.push_back(i);
+    b.mean.setConstant(1, mean);
+    b.w.setConstant(1, 1, T {1} / sigma);
+    m_Blocks.push_back(b);
+    m_nRes += 1;
+}
+
+template<typename T>
+void GaussianPrior<T>::setCorrelatedPrior(
+    const std::vector<index_t> &ind,
+    const Vector<T> &mean,
+    const Matrix<T> &cov)
+{
+    index_t n = ind.size();
+    if (mean.size() != n || cov.rows() != n || cov.cols() != n)
+    {
+        ERROR(SIZE, "correlated prior size mismatch (expected "
+              + utils::strFrom(n) + " parameters)");
+    }
+    for (auto i : ind)
+    {
+        checkIndex(i);
+    }
+    Eigen::LLT<Matrix<T>> llt(cov);
+    if (llt.info() != Eigen::Success)
+    {
+        ERROR(RUNTIME, "prior covariance matrix is not positive definite");
+    }
+    Block b;
+    b.ind = ind;
+    b.mean = mean;
+    b.w = llt.matrixL().solve(Matrix<T>::Identity(n, n));
+    m_Blocks.push_back(b);
+    m_nRes += n;
+}
+
+template<typename T>
+void GaussianPrior<T>::clear()
+{
+    m_Blocks.clear();
+    m_nRes = 0;
+}
+
+template<typename T>
+bool GaussianPrior<T>::hasPrior(index_t i) const
+{
+    for (auto &b : m_Blocks)
+    {
+        if (std::find(b.ind.begin(), b.ind.end(), i) != b.ind.end())
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+template<typename T>
+void GaussianPrior<T>::residuals(const T *p, T *r) const
+{
+    for (auto &b : m_Blocks)
+    {
+        index_t n = b.ind.size();
+        for (index_t k = 0; k < n; ++k)
+        {
+            T rk {0};
+            for (index_t l = 0; l <= k; ++l)
+            {
+                rk += b.w(k, l) * (p[b.ind[l]] - b.mean(l));
+            }
+            r[k] = rk;
+        }
+        r += n;
+    }
+}
+
+template<typename T>
+void GaussianPrior<T>::linearSystem(Matrix<T> &P, Vector<T> &y) const
+{
+    P.setZero(m_nRes, m_nPar);
+    y.resize(m_nRes);
+    index_t row = 0;
+    for (auto &b : m_Blocks)
+    {
+        index_t n = b.ind.size();
+        for (index_t l = 0; l < n; ++l)
+        {
+            P.block(row, b.ind[l], n, 1) = b.w.col(l);
+        }
+        y.segment(row, n) = b.w * b.mean;
+        row += n;
+    }
+}
+
+template<typename T>
+void GaussianPrior<T>::addTransposed(const T *r, T *g) const
+{
+    for (auto &b : m_Blocks)
+    {
+        index_t n = b.ind.size();
+        for (index_t k = 0; k < n; ++k)
+        {
+            for (index_t l = 0; l <= k; ++l)
+            {
+                g[b.ind[l]] += b.w(k, l) * r[k];
+            }
+        }
+        r += n;
+    }
+}
+
+template<typename T>
+void GaussianPrior<T>::checkIndex(index_t i) const
+{
+    if (i < 0 || i >= m_nPar)
+    {
+        ERROR(SIZE, "out of limit prior parameter (requested "
+              + utils::strFrom(i) + " out of " + utils::strFrom(m_nPar) + ")");
+    }
+    if (hasPrior(i))
+    {
+        ERROR(LOGIC, "parameter " + utils::strFrom(i) + " already has a prior");
+    }
+}
+
+END_NAMESPACE
+
+#endif // GAUSSIAN_PRIOR_HPP
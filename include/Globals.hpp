@@ -164,6 +164,9 @@ struct MinimizerID
 namespace MIN {
 	typedef MinimizerID<0> DEFAULT_ID;
 	typedef MinimizerID<1> MIGRAD_ID;
+	typedef MinimizerID<2> LBFGS_ID;
+	typedef MinimizerID<3> MULTISTART_ID;
+	typedef MinimizerID<4> DE_ID;
 
 // static DEFAULT_ID DEFAULT;
 // static MIGRAD_ID MIGRAD;
@@ -0,0 +1,725 @@
+/*
+ * Interpolator.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef INTERPOLATOR_HPP
+#define INTERPOLATOR_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <fstream>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include "Globals.hpp"
+#include "Exceptions.hpp"
+#include "Function.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+BEGIN_NAMESPACE(LQCDA)
+
+/******************************************************************************
+ *                               Interpolator                                 *
+ ******************************************************************************/
+
+// Piecewise cubic interpolation of tabulated points (x_i, y_i), x strictly
+// increasing, with the schemes
+//     Linear   : piecewise linear,
+//     Cubic    : natural cubic spline (zero second derivatives at the ends),
+//     Akima    : Akima spline, robust to outliers (at least 3 points),
+//     Monotone : Fritsch-Carlson/PCHIP spline, monotonic between monotonic
+//                data and without overshoot.
+// Each interval stores the coefficients of its polynomial in (x - x_i). The
+// interpolator is immutable once built, and lookups are stateless (binary
+// search) or use a Cursor owned by the caller, so that it can be shared by
+// many threads. Batch evaluations walk the table alongside the queries when
+// they are sorted.
+template<typename T>
+class Interpolator
+    : public ScalarFunction<T>
+{
+public:
+    // Schemes
+    enum class Scheme
+    {
+        Linear, Cubic, Akima, Monotone
+    };
+
+    // Last interval found, to start the next lookup from (e.g. one per thread)
+    struct Cursor
+    {
+        index_t k {0};
+    };
+
+private:
+    // Structs
+    // y = a + b t + c t^2 + d t^3, t = x - x_i
+    struct Segment
+    {
+        T a, b, c, d;
+    };
+
+    // Data
+    Scheme _Scheme;
+    std::vector<T> _x;
+    std::vector<T> _y;
+    std::vector<Segment> _Segments;
+    bool _Extrapolate;
+
+public:
+    // Constructors/Destructor
+    Interpolator(const T *x, const T *y, unsigned int nPoints, Scheme scheme = Scheme::Cubic);
+    Interpolator(const std::vector<T> &x, const std::vector<T> &y, Scheme scheme = Scheme::Cubic);
+    // Tabulates f at nPoints evenly spaced points of [a, b]
+    Interpolator(const ScalarFunction<T> &f, T a, T b, unsigned int nPoints, Scheme scheme = Scheme::Cubic);
+    virtual ~Interpolator() = default;
+
+    // IO
+    // Only the scheme and the points are stored, the coefficients are
+    // recomputed on loading
+    void save(std::ostream &os) const;
+    void save(const std::string &fileName) const;
+    static Interpolator load(std::istream &is);
+    static Interpolator load(const std::string &fileName);
+
+    // Settings
+    // Evaluate outside of [lowerBound(), upperBound()] with the end
+    // polynomials instead of throwing
+    void setExtrapolate(bool extrapolate)
+    {
+        _Extrapolate = extrapolate;
+    }
+
+public: // Queries
+    using ScalarFunction<T>::xDim;
+    using ScalarFunction<T>::yDim;
+    Scheme scheme() const
+    {
+        return _Scheme;
+    }
+    unsigned int nPoints() const
+    {
+        return _x.size();
+    }
+    const std::vector<T> &x() const
+    {
+        return _x;
+    }
+    const std::vector<T> &y() const
+    {
+        return _y;
+    }
+    T lowerBound() const
+    {
+        return _x.front();
+    }
+    T upperBound() const
+    {
+        return _x.back();
+    }
+
+public: // Evaluators
+    virtual T operator()(const T *x) const override
+    {
+        return value(*x);
+    }
+    using ScalarFunction<T>::operator();
+    virtual void evaluateMany(const T *X, unsigned int nPoints, T *out) const override
+    {
+        evaluate(X, nPoints, out);
+    }
+    T value(T x) const
+    {
+        return eval<0>(x, find(x));
+    }
+    T value(T x, Cursor &c) const
+    {
+        return eval<0>(x, hunt(x, c));
+    }
+    T derivative(T x) const
+    {
+        return eval<1>(x, find(x));
+    }
+    T derivative(T x, Cursor &c) const
+    {
+        return eval<1>(x, hunt(x, c));
+    }
+    T secondDerivative(T x) const
+    {
+        return eval<2>(x, find(x));
+    }
+    T secondDerivative(T x, Cursor &c) const
+    {
+        return eval<2>(x, hunt(x, c));
+    }
+    // Batch evaluations, ys[i] = f(xs[i]) (resp. f', f'')
+    void evaluate(const T *xs, unsigned int n, T *ys) const
+    {
+        evaluateBatch<0>(xs, n, ys);
+    }
+    void evaluateDerivative(const T *xs, unsigned int n, T *ys) const
+    {
+        evaluateBatch<1>(xs, n, ys);
+    }
+    void evaluateSecondDerivative(const T *xs, unsigned int n, T *ys) const
+    {
+        evaluateBatch<2>(xs, n, ys);
+    }
+
+private:
+    void build(const T *x, const T *y, unsigned int nPoints);
+    void buildCubic();
+    void buildHermite(const std::vector<T> &s);
+    std::vector<T> akimaSlopes(const std::vector<T> &m) const;
+    std::vector<T> monotoneSlopes(const std::vector<T> &m) const;
+
+    void checkRange(T x) const
+    {
+        if (!_Extrapolate && (x < _x.front() || x > _x.back()))
+        {
+            ERROR(RUNTIME, "interpolation at " + utils::strFrom(x) + " outside of ["
+                  + utils::strFrom(_x.front()) + ", " + utils::strFrom(_x.back()) + "]");
+        }
+    }
+    // Interval k such that x_k <= x < x_k+1, clamped to the end intervals
+    index_t find(T x) const
+    {
+        checkRange(x);
+        index_t k = std::upper_bound(_x.begin() + 1, _x.end() - 1, x) - _x.begin() - 1;
+        return k;
+    }
+    // Same from the interval in the cursor, walking when the query is close
+    index_t hunt(T x, Cursor &c) const
+    {
+        checkRange(x);
+        const index_t last = _Segments.size() - 1;
+        index_t k = std::min(std::max(c.k, index_t(0)), last);
+        for (int step = 0; step < 4; ++step)
+        {
+            if (k < last && x >= _x[k + 1])
+            {
+                ++k;
+            }
+            else if (k > 0 && x < _x[k])
+            {
+                --k;
+            }
+            else
+            {
+                return c.k = k;
+            }
+        }
+        return c.k = find(x);
+    }
+    template<int D>
+    T eval(T x, index_t k) const
+    {
+        const Segment &s = _Segments[k];
+        T t = x - _x[k];
+        switch (D)
+        {
+        case 0:
+            return s.a + t * (s.b + t * (s.c + t * s.d));
+        case 1:
+            return s.b + t * (2 * s.c + t * 3 * s.d);
+        default:
+            return 2 * s.c + 6 * s.d * t;
+        }
+    }
+    template<int D>
+    void evaluateBatch(const T *xs, unsigned int n, T *ys) const;
+};
+
+template<typename T>
+Interpolator<T>::Interpolator(const T *x, const T *y, unsigned int nPoints, Scheme scheme)
+    : ScalarFunction<T>(1)
+    , _Scheme(scheme)
+    , _Extrapolate(false)
+{
+    build(x, y, nPoints);
+}
+
+template<typename T>
+Interpolator<T>::Interpolator(const std::vector<T> &x, const std::vector<T> &y, Scheme scheme)
+    : ScalarFunction<T>(1)
+    , _Scheme(scheme)
+    , _Extrapolate(false)
+{
+    if (x.size() != y.size())
+    {
+        ERROR(SIZE, "interpolation x and y have different sizes");
+    }
+    build(x.data(), y.data(), x.size());
+}
+
+template<typename T>
+Interpolator<T>::Interpolator(const ScalarFunction<T> &f, T a, T b, unsigned int nPoints, Scheme scheme)
+    : ScalarFunction<T>(1)
+    , _Scheme(scheme)
+    , _Extrapolate(false)
+{
+    if (f.xDim() != 1)
+    {
+        ERROR(SIZE, "only xDim=1 functions can be interpolated");
+    }
+    if (nPoints < 2)
+    {
+        ERROR(SIZE, "interpolation needs at least 2 points");
+    }
+    std::vector<T> x(nPoints), y(nPoints);
+    for (unsigned int i = 0; i < nPoints; ++i)
+    {
+        x[i] = a + (b - a) * i / (nPoints - 1);
+    }
+    f.evaluateMany(x.data(), nPoints, y.data());
+    build(x.data(), y.data(), nPoints);
+}
+
+template<typename T>
+void Interpolator<T>::build(const T *x, const T *y, unsigned int nPoints)
+{
+    unsigned int minPoints = _Scheme == Scheme::Akima ? 3 : 2;
+    if (nPoints < minPoints)
+    {
+        ERROR(SIZE, "interpolation needs at least " + utils::strFrom(minPoints)
+              + " points (got " + utils::strFrom(nPoints) + ")");
+    }
+    for (unsigned int i = 1; i < nPoints; ++i)
+    {
+        if (!(x[i] > x[i - 1]))
+        {
+            ERROR(LOGIC, "interpolation x must be strictly increasing");
+        }
+    }
+    _x.assign(x, x + nPoints);
+    _y.assign(y, y + nPoints);
+    _Segments.resize(nPoints - 1);
+
+    // secant slopes
+    std::vector<T> m(nPoints - 1);
+    for (unsigned int k = 0; k < nPoints - 1; ++k)
+    {
+        m[k] = (_y[k + 1] - _y[k]) / (_x[k + 1] - _x[k]);
+    }
+
+    switch (_Scheme)
+    {
+    case Scheme::Linear:
+        for (unsigned int k = 0; k < nPoints - 1; ++k)
+        {
+            _Segments[k] = {_y[k], m[k], 0, 0};
+        }
+        break;
+    case Scheme::Cubic:
+        buildCubic();
+        break;
+    case Scheme::Akima:
+        buildHermite(akimaSlopes(m));
+        break;
+    case Scheme::Monotone:
+        buildHermite(monotoneSlopes(m));
+        break;
+    }
+}
+
+// Second derivatives M_i from the tridiagonal system
+// h_i-1 M_i-1 + 2 (h_i-1 + h_i) M_i + h_i M_i+1 = 6 (m_i - m_i-1),
+// with M_0 = M_n-1 = 0 (Thomas algorithm)
+template<typename T>
+void Interpolator<T>::buildCubic()
+{
+    const unsigned int n = _x.size();
+    std::vector<T> M(n, 0), cp(n, 0), dp(n, 0);
+    for (unsigned int i = 1; i < n - 1; ++i)
+    {
+        T h0 = _x[i] - _x[i - 1], h1 = _x[i + 1] - _x[i];
+        T rhs = 6 * ((_y[i + 1] - _y[i]) / h1 - (_y[i] - _y[i - 1]) / h0);
+        T diag = 2 * (h0 + h1) - h0 * cp[i - 1];
+        cp[i] = h1 / diag;
+        dp[i] = (rhs - h0 * dp[i - 1]) / diag;
+    }
+    for (unsigned int i = n - 2; i > 0; --i)
+    {
+        M[i] = dp[i] - cp[i] * M[i + 1];
+    }
+    for (unsigned int k = 0; k < n - 1; ++k)
+    {
+        T h = _x[k + 1] - _x[k];
+        _Segments[k] = {
+            _y[k],
+            (_y[k + 1] - _y[k]) / h - h * (2 * M[k] + M[k + 1]) / 6,
+            M[k] / 2,
+            (M[k + 1] - M[k]) / (6 * h)
+        };
+    }
+}
+
+// Cubic Hermite interpolation with slopes s at the points
+template<typename T>
+void Interpolator<T>::buildHermite(const std::vector<T> &s)
+{
+    for (unsigned int k = 0; k < _Segments.size(); ++k)
+    {
+        T h = _x[k + 1] - _x[k];
+        T m = (_y[k + 1] - _y[k]) / h;
+        _Segments[k] = {
+            _y[k],
+            s[k],
+            (3 * m - 2 * s[k] - s[k + 1]) / h,
+            (s[k] + s[k + 1] - 2 * m) / (h * h)
+        };
+    }
+}
+
+// Akima slopes, with the secants extrapolated by two intervals at each end
+template<typename T>
+std::vector<T> Interpolator<T>::akimaSlopes(const std::vector<T> &m) const
+{
+    const unsigned int nm = m.size();
+    // me[k + 2] = m_k, k = -2 .. nm + 1
+    std::vector<T> me(nm + 4);
+    std::copy(m.begin(), m.end(), me.begin() + 2);
+    me[1] = 2 * me[2] - me[3];
+    me[0] = 2 * me[1] - me[2];
+    me[nm + 2] = 2 * me[nm + 1] - me[nm];
+    me[nm + 3] = 2 * me[nm + 2] - me[nm + 1];
+
+    std::vector<T> s(nm + 1);
+    for (unsigned int i = 0; i <= nm; ++i)
+    {
+        // m_i-2, m_i-1, m_i, m_i+1
+        T w1 = std::abs(me[i + 3] - me[i + 2]);
+        T w2 = std::abs(me[i + 1] - me[i]);
+        s[i] = (w1 + w2 == 0)
+               ? (me[i + 1] + me[i + 2]) / 2
+               : (w1 * me[i + 1] + w2 * me[i + 2]) / (w1 + w2);
+    }
+    return s;
+}
+
+// Weighted harmonic mean of the neighbouring secants, zero at local extrema,
+// and shape-preserving three-point slopes at the ends
+template<typename T>
+std::vector<T> Interpolator<T>::monotoneSlopes(const std::vector<T> &m) const
+{
+    const unsigned int nm = m.size();
+    std::vector<T> s(nm + 1);
+    if (nm == 1)
+    {
+        s[0] = s[1] = m[0];
+        return s;
+    }
+    for (unsigned int i = 1; i < nm; ++i)
+    {
+        T h0 = _x[i] - _x[i - 1], h1 = _x[i + 1] - _x[i];
+        if (m[i - 1] * m[i] <= 0)
+        {
+            s[i] = 0;
+        }
+        else
+        {
+            T w1 = 2 * h1 + h0, w2 = h1 + 2 * h0;
+            s[i] = (w1 + w2) / (w1 / m[i - 1] + w2 / m[i]);
+        }
+    }
+    auto end = [](T h0, T h1, T m0, T m1)
+    {
+        T s = ((2 * h0 + h1) * m0 - h0 * m1) / (h0 + h1);
+        if (s * m0 <= 0)
+        {
+            return T(0);
+        }
+        if (m0 * m1 <= 0 && std::abs(s) > std::abs(3 * m0))
+        {
+            return 3 * m0;
+        }
+        return s;
+    };
+    s[0] = end(_x[1] - _x[0], _x[2] - _x[1], m[0], m[1]);
+    s[nm] = end(_x[nm] - _x[nm - 1], _x[nm - 1] - _x[nm - 2], m[nm - 1], m[nm - 2]);
+    return s;
+}
+
+template<typename T>
+void Interpolator<T>::save(std::ostream &os) const
+{
+    auto prec = os.precision(std::numeric_limits<T>::max_digits10);
+    os << "# Interpolator\n"
+       << "scheme " << static_cast<int>(_Scheme) << '\n'
+       << "points " << _x.size() << '\n';
+    for (unsigned int i = 0; i < _x.size(); ++i)
+    {
+        os << _x[i] << ' ' << _y[i] << '\n';
+    }
+    os.precision(prec);
+}
+
+template<typename T>
+void Interpolator<T>::save(const std::string &fileName) const
+{
+    std::ofstream ofs(fileName);
+    if (!ofs)
+    {
+        ERROR(IO, "cannot open file \"" + fileName + "\" for writing");
+    }
+    save(ofs);
+    if (!ofs)
+    {
+        ERROR(IO, "error while writing interpolation table to \"" + fileName + "\"");
+    }
+}
+
+template<typename T>
+Interpolator<T> Interpolator<T>::load(std::istream &is)
+{
+    std::string header, key1, key2;
+    int scheme;
+    unsigned int n;
+    std::getline(is, header);
+    is >> key1 >> scheme >> key2 >> n;
+    if (!is || header != "# Interpolator" || key1 != "scheme" || key2 != "points"
+            || scheme < 0 || scheme > static_cast<int>(Scheme::Monotone))
+    {
+        ERROR(IO, "invalid interpolation table header");
+    }
+    std::vector<T> x(n), y(n);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        is >> x[i] >> y[i];
+    }
+    if (!is)
+    {
+        ERROR(IO, "truncated interpolation table (expected " + utils::strFrom(n) + " points)");
+    }
+    return Interpolator(x, y, static_cast<Scheme>(scheme));
+}
+
+template<typename T>
+Interpolator<T> Interpolator<T>::load(const std::string &fileName)
+{
+    std::ifstream ifs(fileName);
+    if (!ifs)
+    {
+        ERROR(IO, "cannot open file \"" + fileName + "\" for reading");
+    }
+    return load(ifs);
+}
+
+// Sorted runs of queries advance the interval linearly, a decreasing query
+// restarts with a binary search
+template<typename T>
+template<int D>
+void Interpolator<T>::evaluateBatch(const T *xs, unsigned int n, T *ys) const
+{
+    const index_t last = _Segments.size() - 1;
+    index_t k = 0;
+    T prev = n ? xs[0] : T();
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        T x = xs[i];
+        checkRange(x);
+        if (i == 0 || x < prev)
+        {
+            k = find(x);
+        }
+        else
+        {
+            while (k < last && x >= _x[k + 1])
+            {
+                ++k;
+            }
+        }
+        ys[i] = eval<D>(x, k);
+        prev = x;
+    }
+}
+
+/******************************************************************************
+ *                                 Tabulator                                  *
+ ******************************************************************************/
+
+// Adaptive tabulation of an expensive function for interpolation. Starting
+// from options.initial_points evenly spaced nodes, the midpoint of every
+// interval not yet converged is evaluated, and the interval is converged if
+// the interpolation at the midpoint is within abs_tol + rel_tol * |f|.
+// Midpoints are always kept as nodes, so no evaluation is wasted, and are
+// evaluated in parallel batches (f must then be thread-safe).
+template<typename T>
+class Tabulator
+{
+public:
+    // Options
+    struct Options
+    {
+        typename Interpolator<T>::Scheme scheme;
+        T abs_tol;
+        T rel_tol;
+        unsigned int initial_points;
+        unsigned int max_points;
+        // evaluate the nodes of a batch across threads
+        bool parallel;
+
+        Options()
+            : scheme {Interpolator<T>::Scheme::Cubic}
+            , abs_tol {1.e-8}
+            , rel_tol {1.e-6}
+            , initial_points {17}
+            , max_points {100000}
+            , parallel {true}
+        {}
+    };
+
+    Options options;
+
+private:
+    // Statistics of the last tabulation
+    unsigned int _nEvaluations {0};
+    bool _isConverged {false};
+
+public:
+    // Constructors/Destructor
+    Tabulator() = default;
+    explicit Tabulator(const Options &opts)
+        : options(opts)
+    {}
+    ~Tabulator() = default;
+
+    // Tabulation
+    Interpolator<T> tabulate(const ScalarFunction<T> &f, T a, T b);
+
+    // Queries
+    unsigned int nEvaluations() const
+    {
+        return _nEvaluations;
+    }
+    // false if max_points was reached before the tolerance
+    bool isConverged() const
+    {
+        return _isConverged;
+    }
+
+private:
+    void evaluate(const ScalarFunction<T> &f, const std::vector<T> &x, std::vector<T> &y);
+};
+
+template<typename T>
+Interpolator<T> Tabulator<T>::tabulate(const ScalarFunction<T> &f, T a, T b)
+{
+    if (f.xDim() != 1)
+    {
+        ERROR(SIZE, "only xDim=1 functions can be tabulated");
+    }
+    if (!(b > a))
+    {
+        ERROR(LOGIC, "empty tabulation interval");
+    }
+    unsigned int n0 = std::max(options.initial_points, 3u);
+    std::vector<T> x(n0), y;
+    for (unsigned int i = 0; i < n0; ++i)
+    {
+        x[i] = a + (b - a) * i / (n0 - 1);
+    }
+    _nEvaluations = 0;
+    evaluate(f, x, y);
+    // converged[k]: interval [x_k, x_k+1]
+    std::vector<bool> converged(n0 - 1, false);
+
+    std::vector<T> xm, ym, xn, yn;
+    std::vector<bool> cn;
+    while (true)
+    {
+        // midpoints of the intervals to test
+        xm.clear();
+        for (unsigned int k = 0; k < converged.size(); ++k)
+        {
+            if (!converged[k])
+            {
+                xm.push_back((x[k] + x[k + 1]) / 2);
+            }
+        }
+        _isConverged = xm.empty();
+        if (_isConverged || x.size() + xm.size() > options.max_points)
+        {
+            break;
+        }
+        evaluate(f, xm, ym);
+        Interpolator<T> current(x, y, options.scheme);
+
+        // insert the midpoints
+        xn.clear();
+        yn.clear();
+        cn.clear();
+        unsigned int j = 0;
+        for (unsigned int k = 0; k < converged.size(); ++k)
+        {
+            xn.push_back(x[k]);
+            yn.push_back(y[k]);
+            if (converged[k])
+            {
+                cn.push_back(true);
+                continue;
+            }
+            T err = std::abs(current.value(xm[j]) - ym[j]);
+            bool ok = err <= options.abs_tol + options.rel_tol * std::abs(ym[j]);
+            xn.push_back(xm[j]);
+            yn.push_back(ym[j]);
+            cn.push_back(ok);
+            cn.push_back(ok);
+            ++j;
+        }
+        xn.push_back(x.back());
+        yn.push_back(y.back());
+        x.swap(xn);
+        y.swap(yn);
+        converged.swap(cn);
+    }
+    if (!_isConverged)
+    {
+        WARNING("tabulation stopped at " << x.size() << " points before reaching the tolerance");
+    }
+    return Interpolator<T>(x, y, options.scheme);
+}
+
+template<typename T>
+void Tabulator<T>::evaluate(const ScalarFunction<T> &f, const std::vector<T> &x, std::vector<T> &y)
+{
+    const int n = x.size();
+    y.resize(n);
+    _nEvaluations += n;
+#ifdef _OPENMP
+    bool par = options.parallel && n > 1 && !omp_in_parallel();
+#endif
+    std::exception_ptr error;
+    #pragma omp parallel for schedule(dynamic) if(par)
+    for (int i = 0; i < n; ++i)
+    {
+        try
+        {
+            y[i] = f(&x[i]);
+        }
+        catch (...)
+        {
+            #pragma omp critical
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+}
+
+END_NAMESPACE // LQCDA
+
+#endif // INTERPOLATOR_HPP
@@ -0,0 +1,566 @@
+/*
+ * LBFGSMinimizer.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef LBFGS_MINIMIZER_HPP
+#define LBFGS_MINIMIZER_HPP
+
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#include "Minimizer.hpp"
+#include "NumericalDerivatives.hpp"
+
+#include <Eigen/Cholesky>
+
+BEGIN_NAMESPACE(LQCDA)
+BEGIN_NAMESPACE(MIN)
+
+class LBFGSMinimizerOptions
+    : public MinimizerOptions
+{
+public:
+    // maximum number of quasi-Newton iterations
+    unsigned int max_iterations;
+    // number of correction pairs kept by L-BFGS
+    unsigned int memory;
+    // largest unbounded problem solved with dense BFGS
+    unsigned int dense_max_dim;
+    // convergence when EDM < 0.002 * tolerance * error_definition (as MIGRAD)
+    double tolerance;
+    double error_definition;
+    // maximum number of step reductions in a line search
+    unsigned int max_line_search;
+    // relative finite difference steps for the gradient and the final Hessian
+    double gradient_step;
+    double hessian_step;
+    // compute the parameters covariance from a finite difference Hessian
+    bool compute_errors;
+
+public:
+    LBFGSMinimizerOptions()
+        : MinimizerOptions()
+    {
+        init();
+    }
+    LBFGSMinimizerOptions(const MinimizerOptions &opts)
+        : MinimizerOptions(opts)
+    {
+        init();
+    }
+
+    virtual ~LBFGSMinimizerOptions() noexcept = default;
+
+    virtual void print(std::ostream &os) const override
+    {
+        os << "L-BFGS options:\n"
+           << "\tmax_iterations = " << max_iterations << std::endl
+           << "\tmemory = " << memory << std::endl
+           << "\tdense_max_dim = " << dense_max_dim << std::endl
+           << "\ttolerance = " << tolerance << std::endl
+           << "\terror_definition = " << error_definition << std::endl
+           << "\tmax_line_search = " << max_line_search << std::endl
+           << "\tgradient_step = " << gradient_step << std::endl
+           << "\thessian_step = " << hessian_step << std::endl
+           << "\tcompute_errors = " << compute_errors << std::endl
+           << "\ttime_evaluations = " << time_evaluations << std::endl;
+    }
+
+private:
+    void init()
+    {
+        max_iterations = 1000;
+        memory = 8;
+        dense_max_dim = 10;
+        tolerance = 0.1;
+        error_definition = 1.;
+        max_line_search = 30;
+        gradient_step = 1.e-5;
+        hessian_step = 1.e-3;
+        compute_errors = true;
+    }
+};
+
+/******************************************************************************
+ *                              LBFGSMinimizer                                *
+ ******************************************************************************/
+
+// Projected quasi-Newton minimizer with finite difference gradients, or the
+// analytic gradient of the function if it has one (see hasGradient()). Small
+// unbounded problems use a dense BFGS inverse Hessian, bounded or large ones
+// the limited-memory two-loop recursion, with the search direction restricted
+// to the free variables (L-BFGS-B style active set). Fixed parameters are
+// treated as variables with equal lower and upper bounds.
+// When the number of parameters N is known at compile time, all the work is
+// done on fixed-size Eigen objects (always with the dense update), so that
+// solve() performs no heap allocation.
+template<typename T, int N = Dynamic>
+class LBFGSMinimizer
+    : public Minimizer<T>
+{
+public:
+    // Typedefs
+    typedef LBFGSMinimizerOptions OptionsType;
+    typedef LBFGS_ID ID;
+    typedef Vector<T, N> VectorType;
+    typedef Matrix<T, N, N> MatrixType;
+
+    // Parameters box, a parameter is fixed if lower == upper
+    struct Box
+    {
+        VectorType lower;
+        VectorType upper;
+    };
+
+    // Outcome of solve()
+    struct Status
+    {
+        T fval;
+        T edm;
+        unsigned int n_iter;
+        bool converged;
+        bool hessian_ok;
+    };
+
+private:
+    OptionsType _Opts;
+
+public:
+    // Constructor
+    LBFGSMinimizer(const OptionsType &opts = OptionsType())
+        : _Opts(opts)
+    {}
+    // Destructor
+    virtual ~LBFGSMinimizer() noexcept = default;
+
+    // Options
+    virtual OptionsType &options() override
+    {
+        return _Opts;
+    }
+
+    // Minimize
+    using Minimizer<T>::minimize;
+    virtual typename Minimizer<T>::Result minimize(
+        const ScalarFunction<T> &F,
+        const std::vector<T> &x0,
+        const std::vector<T> &e0,
+        const std::vector<ScalarConstraint<T>> &c) override;
+    typename Minimizer<T>::Result minimize(
+        const ScalarFunction<T> &F,
+        const std::vector<T> &x0,
+        const std::vector<ScalarConstraint<T>> &c);
+
+    // Core solver: x holds the starting point on entry and the minimum on
+    // exit, e0 the initial parameter scales, cov receives the covariance
+    // (if options().compute_errors) and edmTrace the EDM of each iteration
+    Status solve(
+        const ScalarFunction<T> &F,
+        VectorType &x,
+        const VectorType &e0,
+        const Box &box,
+        MatrixType &cov,
+        std::vector<double> *edmTrace = nullptr) const;
+
+    // Box built from constraints
+    static Box makeBox(const std::vector<ScalarConstraint<T>> &c, index_t n);
+
+private:
+    static bool isFixed(const Box &box, index_t i)
+    {
+        return box.lower(i) == box.upper(i);
+    }
+    static void project(VectorType &x, const Box &box)
+    {
+        x = x.cwiseMax(box.lower).cwiseMin(box.upper);
+    }
+    void freeMask(
+        const VectorType &x,
+        const VectorType &g,
+        const Box &box,
+        VectorType &mask) const;
+};
+
+template<typename T>
+using LBFGS = LBFGSMinimizer<T>;
+
+template<typename T, int N>
+typename Minimizer<T>::Result LBFGSMinimizer<T, N>::minimize(
+    const ScalarFunction<T> &F,
+    const std::vector<T> &x0,
+    const std::vector<T> &e0,
+    const std::vector<ScalarConstraint<T>> &c)
+{
+    utils::vostream vout(std::cout, _Opts.verbosity);
+    vout(NORMAL) << "Minimizing with L-BFGS minimizer\n";
+    vout(NORMAL) << _Opts << std::endl;
+
+    index_t n = x0.size();
+    if (N != Dynamic && n != N)
+    {
+        ERROR(SIZE, "wrong number of parameters for fixed-size minimizer (expected "
+              + utils::strFrom(N) + ", got " + utils::strFrom(n) + ")");
+    }
+    if (e0.size() != x0.size())
+    {
+        ERROR(SIZE, "initial errors size mismatch (expected "
+              + utils::strFrom(n) + ", got " + utils::strFrom(e0.size()) + ")");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    InstrumentedFunction<T> IF(F, _Opts.time_evaluations);
+
+    VectorType x = ConstMap<VectorType>(x0.data(), n);
+    VectorType e = ConstMap<VectorType>(e0.data(), n);
+    Box box = makeBox(c, n);
+    MatrixType cov;
+
+    typename Minimizer<T>::Result result;
+    Status status = solve(IF, x, e, box, cov, &result.telemetry.edm_trace);
+
+    result.final_cost = status.fval;
+    result.is_valid = status.converged && status.hessian_ok;
+    result.minimum.assign(x.data(), x.data() + n);
+    result.errors.assign(n, 0.);
+    if (_Opts.compute_errors)
+    {
+        result.covariance = cov.template cast<double>();
+        for (index_t i = 0; i < n; ++i)
+        {
+            result.errors[i] = std::sqrt(std::max(result.covariance(i, i), 0.));
+        }
+    }
+
+    Telemetry &tel = result.telemetry;
+    tel.n_calls = IF.nCalls();
+    tel.n_gradient_calls = IF.nGradientCalls();
+    tel.eval_time = IF.evalTime();
+    tel.total_time = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start).count();
+
+    if (!result.is_valid)
+    {
+        vout(NORMAL) << "L-BFGS minimization result is not valid ("
+                     << (status.converged ? "non positive-definite Hessian" : "no convergence")
+                     << ", EDM = " << status.edm << ") !\n";
+    }
+    else
+    {
+        vout(NORMAL) << "(L-BFGS) Fit successful !\n"
+                     << "Resulting minimum is : " << x.transpose() << std::endl
+                     << "Final cost = " << status.fval << ", EDM = " << status.edm
+                     << ", iterations = " << status.n_iter << std::endl;
+    }
+    vout(DEBUG) << tel;
+
+    return result;
+}
+
+template<typename T, int N>
+typename Minimizer<T>::Result LBFGSMinimizer<T, N>::minimize(
+    const ScalarFunction<T> &F,
+    const std::vector<T> &x0,
+    const std::vector<ScalarConstraint<T>> &c)
+{
+    std::vector<T> e0(x0.size(), 0.1);
+    return minimize(F, x0, e0, c);
+}
+
+template<typename T, int N>
+typename LBFGSMinimizer<T, N>::Box LBFGSMinimizer<T, N>::makeBox(
+    const std::vector<ScalarConstraint<T>> &c,
+    index_t n)
+{
+    Box box;
+    box.lower.setConstant(n, -std::numeric_limits<T>::infinity());
+    box.upper.setConstant(n, std::numeric_limits<T>::infinity());
+    for (index_t i = 0; i < std::min<index_t>(n, c.size()); ++i)
+    {
+        if (c[i].hasFixedValue())
+        {
+            box.lower(i) = box.upper(i) = c[i].fixedValue();
+            continue;
+        }
+        if (c[i].hasLowerBound())
+            box.lower(i) = c[i].lowerBound();
+        if (c[i].hasUpperBound())
+            box.upper(i) = c[i].upperBound();
+        if (box.lower(i) > box.upper(i))
+        {
+            ERROR(LOGIC, "empty bounds for parameter " + utils::strFrom(i));
+        }
+    }
+    return box;
+}
+
+template<typename T, int N>
+typename LBFGSMinimizer<T, N>::Status LBFGSMinimizer<T, N>::solve(
+    const ScalarFunction<T> &F,
+    VectorType &x,
+    const VectorType &e0,
+    const Box &box,
+    MatrixType &cov,
+    std::vector<double> *edmTrace) const
+{
+    const index_t n = x.size();
+    if (e0.size() != n || box.lower.size() != n || box.upper.size() != n)
+    {
+        ERROR(SIZE, "L-BFGS problem size mismatch");
+    }
+    const T up = _Opts.error_definition;
+    const T edmMax = 0.002 * _Opts.tolerance * up;
+    const T c1 = 1.e-4;
+
+    // initial inverse Hessian: scale^2 / 2Up, as for a chi2 with errors e0
+    VectorType scale(n), h0(n);
+    FOR_VEC(scale, i)
+    {
+        scale(i) = e0(i) > T {0} ? e0(i) : T {0.1};
+        h0(i) = scale(i) * scale(i) / (2 * up);
+    }
+
+    // central differences, made one-sided against the bounds
+    NumericalDerivatives<T, N> nd(F, scale);
+    nd.setBounds(box.lower, box.upper);
+    nd.setGradientStep(_Opts.gradient_step);
+    nd.setHessianStep(_Opts.hessian_step);
+    const bool analytic = F.hasGradient();
+    auto gradient = [&](const VectorType & xg, T fg, VectorType & g)
+    {
+        if (analytic)
+        {
+            F.gradient(xg.data(), g.data());
+            FOR_VEC(g, i)
+            {
+                if (isFixed(box, i))
+                    g(i) = 0;
+            }
+        }
+        else
+        {
+            nd.gradient(xg.data(), fg, g.data());
+        }
+    };
+
+    bool bounded = false;
+    FOR_VEC(x, i)
+    {
+        if (!isFixed(box, i) && (std::isfinite(box.lower(i)) || std::isfinite(box.upper(i))))
+            bounded = true;
+    }
+    const bool dense = N != Dynamic || (n <= _Opts.dense_max_dim && !bounded);
+
+    // dense BFGS inverse Hessian
+    MatrixType H;
+    // L-BFGS correction pairs (circular buffer)
+    const index_t m = dense ? 0 : std::max(1u, _Opts.memory);
+    Matrix<T, N, Dynamic> S, Y;
+    Vector<T> rho, alpha;
+    index_t nPairs = 0, newest = -1;
+    auto resetMetric = [&]()
+    {
+        if (dense)
+        {
+            H = h0.asDiagonal();
+        }
+        nPairs = 0;
+        newest = -1;
+    };
+    if (!dense)
+    {
+        S.resize(n, m);
+        Y.resize(n, m);
+        rho.resize(m);
+        alpha.resize(m);
+    }
+    resetMetric();
+
+    VectorType g(n), gm(n), d(n), mask(n), xn(n), gn(n), s(n), yv(n);
+
+    Status status;
+    status.n_iter = 0;
+    status.converged = false;
+    status.hessian_ok = true;
+
+    project(x, box);
+    T fx = F(x.data());
+    gradient(x, fx, g);
+
+    bool freshMetric = true;
+    while (status.n_iter < _Opts.max_iterations)
+    {
+        // search direction on the free variables
+        freeMask(x, g, box, mask);
+        gm = g.cwiseProduct(mask);
+        if (dense)
+        {
+            d = -(H * gm).cwiseProduct(mask);
+        }
+        else
+        {
+            d = gm;
+            for (index_t k = 0, j = newest; k < nPairs; ++k, j = (j + m - 1) % m)
+            {
+                alpha(j) = rho(j) * S.col(j).dot(d);
+                d -= alpha(j) * Y.col(j);
+            }
+            if (nPairs > 0)
+            {
+                d *= S.col(newest).dot(Y.col(newest)) / Y.col(newest).squaredNorm();
+            }
+            else
+            {
+                d = d.cwiseProduct(h0);
+            }
+            for (index_t k = 0, j = (newest + m - nPairs + 1) % m; k < nPairs; ++k, j = (j + 1) % m)
+            {
+                T beta = rho(j) * Y.col(j).dot(d);
+                d += S.col(j) * (alpha(j) - beta);
+            }
+            d = -d.cwiseProduct(mask);
+        }
+        T gd = g.dot(d);
+        if (!(gd < 0) && !freshMetric)
+        {
+            resetMetric();
+            freshMetric = true;
+            continue;
+        }
+        status.edm = -gd / 2;
+        if (edmTrace)
+        {
+            edmTrace->push_back(status.edm);
+        }
+        if (!(status.edm > edmMax))
+        {
+            status.converged = !(status.edm < 0);
+            break;
+        }
+        status.n_iter++;
+
+        // backtracking line search with projection
+        T step = 1, fn = fx;
+        bool accepted = false;
+        for (unsigned int k = 0; k < _Opts.max_line_search; ++k)
+        {
+            xn = x + step * d;
+            project(xn, box);
+            fn = F(xn.data());
+            if (fn <= fx + c1 * g.dot(xn - x))
+            {
+                accepted = true;
+                break;
+            }
+            // safeguarded quadratic interpolation
+            T q = fn - fx - step * gd;
+            T next = q > 0 ? -gd * step * step / (2 * q) : step / 2;
+            step = std::min(std::max(next, step / 10), step / 2);
+        }
+        if (!accepted)
+        {
+            if (freshMetric)
+            {
+                break;
+            }
+            resetMetric();
+            freshMetric = true;
+            continue;
+        }
+
+        gradient(xn, fn, gn);
+        s = xn - x;
+        yv = gn - g;
+        T sy = s.dot(yv);
+        if (sy > std::numeric_limits<T>::epsilon() * yv.squaredNorm())
+        {
+            if (dense)
+            {
+                if (freshMetric)
+                {
+                    // Shanno-Phua scaling of the initial metric
+                    H *= sy / (yv.transpose() * H * yv).value();
+                }
+                VectorType Hy = H * yv;
+                T yHy = yv.dot(Hy);
+                H += ((sy + yHy) / (sy * sy)) * s * s.transpose()
+                     - (Hy * s.transpose() + s * Hy.transpose()) / sy;
+            }
+            else
+            {
+                newest = (newest + 1) % m;
+                S.col(newest) = s;
+                Y.col(newest) = yv;
+                rho(newest) = 1 / sy;
+                nPairs = std::min(nPairs + 1, m);
+            }
+            freshMetric = false;
+        }
+        x = xn;
+        fx = fn;
+        g = gn;
+    }
+    status.fval = fx;
+
+    if (_Opts.compute_errors)
+    {
+        MatrixType Hs(n, n);
+        status.hessian_ok = nd.hessian(x.data(), Hs);
+        if (status.hessian_ok)
+        {
+            Eigen::LLT<MatrixType> llt(Hs);
+            status.hessian_ok = llt.info() == Eigen::Success;
+            if (status.hessian_ok)
+            {
+                cov = (2 * up) * llt.solve(MatrixType::Identity(n, n));
+            }
+        }
+        if (!status.hessian_ok)
+        {
+            // fall back on the quasi-Newton estimate
+            if (dense)
+            {
+                cov = (2 * up) * H;
+            }
+            else
+            {
+                cov = (2 * up) * MatrixType(h0.asDiagonal());
+            }
+        }
+        FOR_VEC(x, i)
+        {
+            if (isFixed(box, i))
+            {
+                cov.row(i).setZero();
+                cov.col(i).setZero();
+            }
+        }
+    }
+
+    return status;
+}
+
+// Variables held at a bound by the gradient, and fixed ones, are inactive
+template<typename T, int N>
+void LBFGSMinimizer<T, N>::freeMask(
+    const VectorType &x,
+    const VectorType &g,
+    const Box &box,
+    VectorType &mask) const
+{
+    FOR_VEC(x, i)
+    {
+        bool active = isFixed(box, i)
+                      || (x(i) <= box.lower(i) && g(i) > 0)
+                      || (x(i) >= box.upper(i) && g(i) < 0);
+        mask(i) = active ? T {0} : T {1};
+    }
+}
+
+END_NAMESPACE
+END_NAMESPACE
+
+#endif // LBFGS_MINIMIZER_HPP
@@ -8,28 +8,40 @@
 #ifndef LQCDA_HPP_
 #define LQCDA_HPP_
 
+#include "CachedParametrizedFunction.hpp"
 #include "CostFunction.hpp"
 #include "DataFile.hpp"	
 // #include "DataReader.hpp"				
+#include "DifferentialEvolutionMinimizer.hpp"
 #include "DataSet.hpp"					
 // #include "DataSetIterator.hpp"			
 #include "Fit.hpp"						
 #include "FitInterface.hpp"			
 #include "FitOptions.hpp"				
 #include "FitResult.hpp"				
+#include "Formula.hpp"
 #include "Function.hpp"				
 #include "FunctionInterpolator.hpp"
+#include "GaussianPrior.hpp"
+#include "GSLMultiRootFinder.hpp"
 #include "GSLRootFinder.hpp"
+#include "GSLUtils.hpp"
 #include "Globals.hpp"	
 // #include "GracePlot.hpp"
 // #include "Graph.hpp"				
+#include "Interpolator.hpp"
 // #include "IOObject.hpp"				
+#include "LBFGSMinimizer.hpp"
 #include "LinalgUtils.hpp"				
 #include "MatrixSample.hpp"			
 #include "MetaProgUtils.hpp"			
 #include "Minimize.hpp"				
 #include "Minimizer.hpp"				
-#include "Minuit2Minimizer.hpp"		
+#include "MinimizerTelemetry.hpp"
+#include "Minuit2Minimizer.hpp"
+#include "Models.hpp"
+#include "MultiStartMinimizer.hpp"		
+#include "NumericalDerivatives.hpp"
 #include "ParametrizedFunction.hpp"	
 #include "ParserState.hpp"	
 // #include "Plot.hpp"		
@@ -37,6 +49,7 @@
 // #include "PlotObject.hpp"
 // #include "PlotOptions.hpp"
 // #include "PlotRenderer.hpp"
+#include "Quadrature.hpp"
 #include "Random.hpp"					
 #include "Reduction.hpp"				
 #include "RootFinder.hpp"				
@@ -44,7 +57,8 @@
 #include "ScalarConstraint.hpp"				
 // #include "StaticFunction.hpp"	
 #include "Statistics.hpp"		
-// #include "StaticParametrizedFunction.hpp"
+#include "StaticFit.hpp"
+#include "StaticParametrizedFunction.hpp"
 #include "TypeTraits.hpp"				
 #include "XYData.hpp"					
 #include "XYDataInterface.hpp"			
@@ -139,6 +139,27 @@ MatrixType PseudoInverse(const MatrixType& mat, double pinv_tol = 1.e-6)
 	return (svd.matrixV()*singularValues.asDiagonal()*svd.matrixU().transpose());
 }
 
+// Solves L x = b in place for lower triangular L, by blocked forward
+// substitution. The update of the trailing blocks is split across threads.
+// T must be given explicitly to bind b to vector segments.
+template<typename T>
+void ParallelLowerSolveInPlace(const Matrix<T>& L, Ref<Vector<T>> b, index_t blockSize)
+{
+	index_t n = L.rows();
+	assert(L.cols() == n && b.size() == n && blockSize > 0);
+	for(index_t k = 0; k < n; k += blockSize)
+	{
+		index_t kb = std::min(blockSize, n - k);
+		L.block(k, k, kb, kb).template triangularView<Eigen::Lower>().solveInPlace(b.segment(k, kb));
+		#pragma omp parallel for
+		for(index_t j = k + kb; j < n; j += blockSize)
+		{
+			index_t jb = std::min(blockSize, n - j);
+			b.segment(j, jb).noalias() -= L.block(j, k, jb, kb) * b.segment(k, kb);
+		}
+	}
+}
+
 
 END_NAMESPACE // LQCDA
 
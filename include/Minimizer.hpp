@@ -11,6 +11,7 @@
  #include "Globals.hpp"
  #include "Function.hpp"
  #include "ScalarConstraint.hpp"
+ #include "MinimizerTelemetry.hpp"
 
 BEGIN_NAMESPACE(LQCDA)
 BEGIN_NAMESPACE(MIN)
@@ -19,10 +20,13 @@ class MinimizerOptions
 {
 public:
 	Verbosity verbosity;
+	// time the cost function calls (call counts are always recorded)
+	bool time_evaluations;
 
 public:
 	MinimizerOptions() {
 		verbosity = NORMAL;
+		time_evaluations = true;
 	}
 
 	virtual ~MinimizerOptions() noexcept = default;
@@ -30,7 +34,8 @@ public:
 	virtual void print(std::ostream& os) const
 	{
 		os << "Minimizer options:\n"
-		<< "\tverbosity = " << verbosity << std::endl;
+		<< "\tverbosity = " << verbosity << std::endl
+		<< "\ttime_evaluations = " << time_evaluations << std::endl;
 	}
 };
 
@@ -48,8 +53,21 @@ public:
 	{
 		std::vector<double> minimum;
 		std::vector<double> errors;
+		// covariance at the minimum (empty if not provided)
+		Matrix<double> covariance;
+		// asymmetric (MINOS) errors, lower ones being negative (empty if
+		// not computed)
+		std::vector<double> lower_errors;
+		std::vector<double> upper_errors;
+		// whether each MINOS bound was found (false for the parameters not
+		// computed, and for the bounds where MINOS failed and the error is
+		// the parabolic one)
+		std::vector<bool> lower_valid;
+		std::vector<bool> upper_valid;
 		double final_cost;
 		bool is_valid;
+		// cost of the minimization
+		Telemetry telemetry;
 	};
 
 	// Typedefs
@@ -72,6 +90,12 @@ public:
 	Result minimize(
 		const ScalarFunction<Scalar>& F, 
 		const std::vector<Scalar>& x0);
+	// Warm-started minimization, seeded with a previous (nearby) result
+	virtual Result minimize(
+		const ScalarFunction<Scalar>& F, 
+		const std::vector<Scalar>& x0,
+		const std::vector<ScalarConstraint<Scalar>>& c,
+		const Result& warmStart);
 };
 
 template<typename T>
@@ -79,7 +103,25 @@ typename Minimizer<T>::Result Minimizer<T>::minimize(
 		const ScalarFunction<Scalar>& F, 
 		const std::vector<Scalar>& x0)
 {
-	return minimize(F, x0, std::vector<ScalarConstraint<Scalar>>(x0.size()));
+	return minimize(F, x0, std::vector<Scalar>(x0.size(), 0.1),
+		std::vector<ScalarConstraint<Scalar>>(x0.size()));
+}
+
+template<typename T>
+typename Minimizer<T>::Result Minimizer<T>::minimize(
+		const ScalarFunction<Scalar>& F, 
+		const std::vector<Scalar>& x0,
+		const std::vector<ScalarConstraint<Scalar>>& c,
+		const Result& warmStart)
+{
+	// default: use the previous errors as initial steps
+	std::vector<Scalar> e0(warmStart.errors.begin(), warmStart.errors.end());
+	if(e0.size() != x0.size())
+	{
+		ERROR(SIZE, "warm start size mismatch (expected "
+			+ utils::strFrom(x0.size()) + ", got " + utils::strFrom(e0.size()) + ")");
+	}
+	return minimize(F, x0, e0, c);
 }
 
 template<typename T>
@@ -12,6 +12,9 @@
  #include "Factory.hpp"
  #include "SingletonHolder.hpp"
  #include "Minuit2Minimizer.hpp"
+ #include "DifferentialEvolutionMinimizer.hpp"
+ #include "LBFGSMinimizer.hpp"
+ #include "MultiStartMinimizer.hpp"
 
  #include <iostream>
 
@@ -36,7 +39,9 @@
  			<
  			Minimizer<T>, 
  			int,
- 			std::function< Minimizer<T> * () >
+ 			std::function< Minimizer<T> * () >,
+ 			utils::DefaultFactoryError,
+ 			utils::policies::thread::LockFreeOnceInit
  			>
  			{
   			public:
@@ -45,7 +50,9 @@
  				<
  				Minimizer<T>, 
  				int,
- 				std::function< Minimizer<T> * () >
+ 				std::function< Minimizer<T> * () >,
+ 				utils::DefaultFactoryError,
+ 				utils::policies::thread::LockFreeOnceInit
  				> factory_type;
  				using typename factory_type::product_type;
  				using typename factory_type::id_type;
@@ -72,11 +79,23 @@
  			MinimizerFactoryImpl<T>::MinimizerFactoryImpl()
  			{
  				registerMinimizer<MnMigradMinimizer<T>>(MIGRAD_ID());
+ 				registerMinimizer<LBFGSMinimizer<T>>(LBFGS_ID());
+ 				registerMinimizer<MultiStartMinimizer<T>>(MULTISTART_ID());
+ 				registerMinimizer<DifferentialEvolutionMinimizer<T>>(DE_ID());
  			}
  		}
 
+ 		// The factory is created once and safe for concurrent use: minimizers can
+ 		// be created from parallel regions, but additional registrations
+ 		// (RegisterMinimizer) must happen before.
  		template<typename T>
- 		using MinimizerFactory = utils::SingletonHolder<MinimizerFactoryImpl<T>>;
+ 		using MinimizerFactory = utils::SingletonHolder
+ 		<
+ 		MinimizerFactoryImpl<T>,
+ 		utils::policies::creation::OpNewCreator,
+ 		utils::policies::lifetime::DefaultLifetime,
+ 		utils::policies::thread::LockFreeOnceInit
+ 		>;
 
  		template<class M>
  		bool RegisterMinimizer(const typename MinimizerFactory<typename M::scalar_type>::singleton_type::id_type & id)
@@ -0,0 +1,349 @@
+/*
+ * MinimizerTelemetry.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef MINIMIZER_TELEMETRY_HPP
+#define MINIMIZER_TELEMETRY_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+
+#include "Globals.hpp"
+#include "Function.hpp"
+
+BEGIN_NAMESPACE(LQCDA)
+BEGIN_NAMESPACE(MIN)
+
+/******************************************************************************
+ *                                 Telemetry                                  *
+ ******************************************************************************/
+
+// Cost of a single minimization. Times are wall-clock seconds: eval_time is
+// the time during which at least one cost evaluation was running, so that
+// concurrent evaluations are not counted several times.
+struct Telemetry
+{
+    // number of cost function calls
+    unsigned long n_calls {0};
+    // number of gradient calls
+    unsigned long n_gradient_calls {0};
+    // number of cost function calls spent in pre-minimization
+    unsigned long n_pre_min_calls {0};
+    // time spent evaluating the cost function
+    double eval_time {0.};
+    // total time of the minimization
+    double total_time {0.};
+    // estimated distance to minimum at each iteration
+    std::vector<double> edm_trace;
+
+    double overheadTime() const
+    {
+        return std::max(total_time - eval_time, 0.);
+    }
+};
+
+inline std::ostream &operator<<(std::ostream &os, const Telemetry &t)
+{
+    os << "Minimizer telemetry:\n"
+       << "\tcost calls = " << t.n_calls
+       << " (pre-minimization: " << t.n_pre_min_calls << ")\n"
+       << "\tgradient calls = " << t.n_gradient_calls << '\n'
+       << "\tcost evaluation time = " << t.eval_time << " s\n"
+       << "\tminimizer overhead = " << t.overheadTime() << " s\n"
+       << "\titerations = " << t.edm_trace.size() << std::endl;
+    return os;
+}
+
+/******************************************************************************
+ *                             TelemetrySummary                               *
+ ******************************************************************************/
+
+// Aggregates the telemetry of a batch of minimizations. add() can be called
+// concurrently.
+class TelemetrySummary
+{
+public:
+    // Accumulate
+    void add(const Telemetry &t)
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        _nFits++;
+        _nCalls += t.n_calls;
+        _nGradientCalls += t.n_gradient_calls;
+        _nPreMinCalls += t.n_pre_min_calls;
+        _EvalTime += t.eval_time;
+        _TotalTime += t.total_time;
+        _nIterations += t.edm_trace.size();
+        if (t.n_calls > _MaxCalls)
+        {
+            _MaxCalls = t.n_calls;
+        }
+        if (t.total_time > _MaxTime)
+        {
+            _MaxTime = t.total_time;
+        }
+    }
+    void reset()
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        _nFits = _nCalls = _nGradientCalls = _nPreMinCalls = _nIterations = _MaxCalls = 0;
+        _EvalTime = _TotalTime = _MaxTime = 0.;
+    }
+
+    // Accessors
+    unsigned long nFits() const { return locked(_nFits); }
+    unsigned long nCalls() const { return locked(_nCalls); }
+    unsigned long nGradientCalls() const { return locked(_nGradientCalls); }
+    unsigned long nPreMinCalls() const { return locked(_nPreMinCalls); }
+    unsigned long nIterations() const { return locked(_nIterations); }
+    unsigned long maxCalls() const { return locked(_MaxCalls); }
+    double evalTime() const { return locked(_EvalTime); }
+    double totalTime() const { return locked(_TotalTime); }
+    double maxTime() const { return locked(_MaxTime); }
+    double overheadTime() const
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        return std::max(_TotalTime - _EvalTime, 0.);
+    }
+    double meanCalls() const
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        return _nFits ? double(_nCalls) / _nFits : 0.;
+    }
+    double meanTime() const
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        return _nFits ? _TotalTime / _nFits : 0.;
+    }
+
+    void print(std::ostream &os) const
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        os << "Minimizer telemetry summary (" << _nFits << " minimizations):\n"
+           << "\tcost calls = " << _nCalls << " (mean " << (_nFits ? double(_nCalls) / _nFits : 0.)
+           << ", max " << _MaxCalls << ", pre-minimization " << _nPreMinCalls << ")\n"
+           << "\tgradient calls = " << _nGradientCalls << '\n'
+           << "\tcost evaluation time = " << _EvalTime << " s\n"
+           << "\tminimizer overhead = " << std::max(_TotalTime - _EvalTime, 0.) << " s\n"
+           << "\ttotal time = " << _TotalTime << " s (mean " << (_nFits ? _TotalTime / _nFits : 0.)
+           << ", max " << _MaxTime << ")" << std::endl;
+    }
+
+private:
+    template<typename V>
+    V locked(const V &v) const
+    {
+        std::lock_guard<std::mutex> lock(_Mutex);
+        return v;
+    }
+
+private:
+    mutable std::mutex _Mutex;
+    unsigned long _nFits {0};
+    unsigned long _nCalls {0};
+    unsigned long _nGradientCalls {0};
+    unsigned long _nPreMinCalls {0};
+    unsigned long _nIterations {0};
+    unsigned long _MaxCalls {0};
+    double _EvalTime {0.};
+    double _TotalTime {0.};
+    double _MaxTime {0.};
+};
+
+inline std::ostream &operator<<(std::ostream &os, const TelemetrySummary &s)
+{
+    s.print(os);
+    return os;
+}
+
+/******************************************************************************
+ *                           InstrumentedFunction                             *
+ ******************************************************************************/
+
+// Counts and times the calls to a wrapped ScalarFunction. Counters are
+// relaxed atomics, so the wrapper can be evaluated concurrently. The
+// evaluation time is the wall time during which at least one evaluation is
+// running: overlapping evaluations (parallel MINOS, concurrent batches) are
+// counted once, and the time never exceeds the wall time of the caller.
+// Analytic gradients of the wrapped function are forwarded, counted as
+// gradient calls and timed as evaluations.
+template<typename T>
+class InstrumentedFunction
+    : public ScalarFunction<T>
+{
+private:
+    // Typedefs
+    typedef std::chrono::steady_clock clock_type;
+
+public:
+    // Constructors/Destructor
+    explicit InstrumentedFunction(const ScalarFunction<T> &f, bool timed = true)
+        : ScalarFunction<T>(f.xDim())
+        , _F(f)
+        , _isTimed(timed)
+        , _nCalls {0}
+        , _nGradientCalls {0}
+        , _EvalTime {0}
+        , _nActive {0}
+        , _nOpen {0}
+    {}
+    virtual ~InstrumentedFunction() = default;
+
+public: // Queries
+    unsigned long nCalls() const
+    {
+        return _nCalls.load(std::memory_order_relaxed);
+    }
+    unsigned long nGradientCalls() const
+    {
+        return _nGradientCalls.load(std::memory_order_relaxed);
+    }
+    double evalTime() const
+    {
+        return 1.e-9 * _EvalTime.load(std::memory_order_relaxed);
+    }
+    const ScalarFunction<T> &function() const
+    {
+        return _F;
+    }
+    virtual bool isThreadSafe() const override
+    {
+        return _F.isThreadSafe();
+    }
+
+public: // Counters
+    void countGradient() const
+    {
+        _nGradientCalls.fetch_add(1, std::memory_order_relaxed);
+    }
+    void reset()
+    {
+        _nCalls = 0;
+        _nGradientCalls = 0;
+        _EvalTime = 0;
+        _nActive = 0;
+        _nOpen = 0;
+    }
+
+public: // Evaluators
+    virtual T operator()(const T *x) const override
+    {
+        _nCalls.fetch_add(1, std::memory_order_relaxed);
+        if (!_isTimed)
+        {
+            return _F(x);
+        }
+        enter();
+        T res;
+        try
+        {
+            res = _F(x);
+        }
+        catch (...)
+        {
+            leave();
+            throw;
+        }
+        leave();
+        return res;
+    }
+    using ScalarFunction<T>::operator();
+    virtual void evaluateMany(const T *X, unsigned int nPoints, T *out) const override
+    {
+        _nCalls.fetch_add(nPoints, std::memory_order_relaxed);
+        if (!_isTimed)
+        {
+            _F.evaluateMany(X, nPoints, out);
+            return;
+        }
+        enter();
+        try
+        {
+            _F.evaluateMany(X, nPoints, out);
+        }
+        catch (...)
+        {
+            leave();
+            throw;
+        }
+        leave();
+    }
+
+public: // Derivatives
+    virtual bool hasGradient() const override
+    {
+        return _F.hasGradient();
+    }
+    virtual void gradient(const T *x, T *g) const override
+    {
+        countGradient();
+        if (!_isTimed)
+        {
+            _F.gradient(x, g);
+            return;
+        }
+        enter();
+        try
+        {
+            _F.gradient(x, g);
+        }
+        catch (...)
+        {
+            leave();
+            throw;
+        }
+        leave();
+    }
+
+private:
+    // The first evaluation to start and the last one to end delimit a busy
+    // period: the count of running evaluations is atomic and only its 0->1
+    // and 1->0 transitions take the lock. A period closed by a late 1->0
+    // transition after the next one was opened is merged with it, _nOpen
+    // counting the opened periods which are not closed yet.
+    void enter() const
+    {
+        if (_nActive.fetch_add(1, std::memory_order_acq_rel) == 0)
+        {
+            std::lock_guard<std::mutex> lock(_TimeMutex);
+            if (_nOpen++ == 0)
+            {
+                _BusyStart = clock_type::now();
+            }
+        }
+    }
+    void leave() const
+    {
+        if (_nActive.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        {
+            std::lock_guard<std::mutex> lock(_TimeMutex);
+            if (--_nOpen == 0)
+            {
+                _EvalTime.fetch_add(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                        clock_type::now() - _BusyStart).count(),
+                                    std::memory_order_relaxed);
+            }
+        }
+    }
+
+private:
+    const ScalarFunction<T> &_F;
+    bool _isTimed;
+    mutable std::atomic<unsigned long> _nCalls;
+    mutable std::atomic<unsigned long> _nGradientCalls;
+    mutable std::atomic<long long> _EvalTime;
+    mutable std::atomic<unsigned int> _nActive;
+    mutable std::mutex _TimeMutex;
+    mutable unsigned int _nOpen;
+    mutable clock_type::time_point _BusyStart;
+};
+
+END_NAMESPACE // MIN
+END_NAMESPACE // LQCDA
+
+#endif // MINIMIZER_TELEMETRY_HPP
@@ -8,16 +8,27 @@
 #ifndef MINUIT2_MINIMIZER_HPP_
 #define MINUIT2_MINIMIZER_HPP_
 
+#include <cmath>
+#include <exception>
+#include <limits>
+
 #include "Minimizer.hpp"
+#include "NumericalDerivatives.hpp"
+
+#include <Eigen/Cholesky>
 
 #include "Minuit2/FCNBase.h"
+#include "Minuit2/FCNGradientBase.h"
 #include "Minuit2/FunctionMinimum.h"
 #include "Minuit2/MnMigrad.h"
 #include "Minuit2/MnPrint.h"
 #include "Minuit2/MnSimplex.h"
 #include "Minuit2/MnUserParameters.h"
+#include "Minuit2/MnUserCovariance.h"
 
 #include "Minuit2/MnMinos.h"
+#include "Minuit2/MnCross.h"
+#include "Minuit2/MinosError.h"
 
 
 BEGIN_NAMESPACE(LQCDA)
@@ -31,6 +42,20 @@ public:
     bool pre_minimize;
     unsigned int pre_min_level;
     double error_definition;
+    // provide MIGRAD with batched central difference gradients (the analytic
+    // gradient of a function which has one is always provided)
+    bool parallel_gradient;
+    bool richardson;
+    double gradient_step;
+    // recompute the covariance from a batched finite difference Hessian
+    bool hessian;
+    double hessian_step;
+    // parameters with MINOS asymmetric errors, each bound being computed as
+    // an independent task, the tasks run concurrently if minos_parallel is
+    // set and the function is thread-safe (ScalarFunction::isThreadSafe())
+    std::vector<unsigned int> minos;
+    unsigned int minos_max_calls;
+    bool minos_parallel;
 
 public:
     MnMigradMinimizerOptions()
@@ -52,7 +77,16 @@ public:
            << "\tlevel = " << level << std::endl
            << "\tpre_minimize = " << pre_minimize << std::endl
            << "\tpre_minimize level = " << pre_min_level << std::endl
-           << "\terror_definition = " << error_definition << std::endl;
+           << "\terror_definition = " << error_definition << std::endl
+           << "\tparallel_gradient = " << parallel_gradient << std::endl
+           << "\trichardson = " << richardson << std::endl
+           << "\tgradient_step = " << gradient_step << std::endl
+           << "\thessian = " << hessian << std::endl
+           << "\thessian_step = " << hessian_step << std::endl
+           << "\tminos = " << minos.size() << " parameter(s)" << std::endl
+           << "\tminos_max_calls = " << minos_max_calls << std::endl
+           << "\tminos_parallel = " << minos_parallel << std::endl
+           << "\ttime_evaluations = " << time_evaluations << std::endl;
     }
 
 private:
@@ -62,6 +96,13 @@ private:
         pre_minimize = true;
         pre_min_level = 1;
         error_definition = 1.;
+        parallel_gradient = false;
+        richardson = false;
+        gradient_step = 1.e-5;
+        hessian = false;
+        hessian_step = 1.e-3;
+        minos_max_calls = 0;
+        minos_parallel = true;
     }
 };
 
@@ -100,6 +141,56 @@ private:
         }
     };
 
+    // Analytic gradient of the function if it has one, otherwise central
+    // difference gradients, all the stencil points being evaluated in one batch
+    class Mn2FCNGradientWrapper
+        : public ROOT::Minuit2::FCNGradientBase
+    {
+    private:
+        const InstrumentedFunction<T> &_F;
+        const MnMigradMinimizerOptions& _Opts;
+        NumericalDerivatives<T> _D;
+
+    public:
+        Mn2FCNGradientWrapper(
+            const InstrumentedFunction<T> &f,
+            const MnMigradMinimizerOptions& opts,
+            const NumericalDerivatives<T> &d)
+        : FCNGradientBase()
+        , _F(f)
+        , _Opts(opts)
+        , _D(d)
+        {}
+        virtual ~Mn2FCNGradientWrapper() {}
+
+        virtual double Up () const
+        {
+            return _Opts.error_definition;
+        }
+        virtual double operator()(const std::vector<double> &args) const
+        {
+            return _F(args);
+        }
+        virtual std::vector<double> Gradient(const std::vector<double> &args) const
+        {
+            std::vector<double> g(args.size());
+            if (_F.hasGradient())
+            {
+                _F.gradient(args.data(), g.data());
+            }
+            else
+            {
+                _F.countGradient();
+                _D.gradient(args.data(), g.data());
+            }
+            return g;
+        }
+        virtual bool CheckGradient() const
+        {
+            return false;
+        }
+    };
+
 private:
     OptionsType _Opts;
 
@@ -128,6 +219,38 @@ public:
         const ScalarFunction<T> &F,
         const std::vector<T> &x0,
         const std::vector<ScalarConstraint<T>> &c);
+    virtual typename Minimizer<T>::Result minimize(
+        const ScalarFunction<T> &F,
+        const std::vector<T> &x0,
+        const std::vector<ScalarConstraint<T>> &c,
+        const typename Minimizer<T>::Result &warmStart) override;
+
+private:
+    ROOT::Minuit2::MnUserParameters makeParameters(
+        const std::vector<T> &x0,
+        const std::vector<T> &e0,
+        const std::vector<ScalarConstraint<T>> &c) const;
+    typename Minimizer<T>::Result run(
+        const ScalarFunction<T> &F,
+        const ROOT::Minuit2::MnUserParameters &params,
+        const ROOT::Minuit2::MnUserCovariance *cov,
+        const std::vector<ScalarConstraint<T>> &c,
+        bool pre_minimize);
+    void runMinos(
+        const InstrumentedFunction<T> &F,
+        const ROOT::Minuit2::FunctionMinimum &Min,
+        const std::vector<ScalarConstraint<T>> &c,
+        typename Minimizer<T>::Result &result) const;
+    NumericalDerivatives<T> derivatives(
+        const ScalarFunction<T> &F,
+        const std::vector<double> &scale,
+        const std::vector<ScalarConstraint<T>> &c) const;
+    template<typename FCN>
+    static ROOT::Minuit2::FunctionMinimum migrad(
+        const FCN &fcn,
+        const ROOT::Minuit2::MnUserParameters &params,
+        const ROOT::Minuit2::MnUserCovariance *cov,
+        unsigned int level);
 
 };
 
@@ -149,6 +272,89 @@ typename Minimizer<T>::Result MnMigradMinimizer<T>::minimize(
     vout(NORMAL) << "Initial parameters:\n";
     assert(e0.size() == x0.size());
     // for_each(e0.begin(), e0.end(), [](T& x){x*=0.01;});
+    ROOT::Minuit2::MnUserParameters params = makeParameters(x0, e0, c);
+    vout(NORMAL) << params << std::endl;
+
+    return run(F, params, nullptr, c, _Opts.pre_minimize);
+}
+
+template<typename T>
+typename Minimizer<T>::Result MnMigradMinimizer<T>::minimize(
+    const ScalarFunction<T> &F,
+    const std::vector<T> &x0,
+    const std::vector<ScalarConstraint<T>> &c)
+{
+    std::vector<T> e0(x0.size(), 0.1);
+    return minimize(F, x0, e0, c);
+}
+
+// The previous errors are used as initial steps and the previous covariance
+// (of the variable parameters) seeds MIGRAD's metric, so that the
+// pre-minimization pass can be skipped.
+template<typename T>
+typename Minimizer<T>::Result MnMigradMinimizer<T>::minimize(
+    const ScalarFunction<T> &F,
+    const std::vector<T> &x0,
+    const std::vector<ScalarConstraint<T>> &c,
+    const typename Minimizer<T>::Result &warmStart)
+{
+    utils::vostream vout(std::cout, _Opts.verbosity);
+    vout(NORMAL) << "Minimizing with Minuit2 MIGRAD minimizer (warm start)\n";
+    vout(NORMAL) << _Opts << std::endl;
+
+    unsigned int n = x0.size();
+    if (warmStart.errors.size() != n)
+    {
+        ERROR(SIZE, "warm start size mismatch (expected "
+              + utils::strFrom(n) + ", got " + utils::strFrom(warmStart.errors.size()) + ")");
+    }
+    std::vector<T> e0(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        e0[i] = warmStart.errors[i] > 0. ? warmStart.errors[i] : 0.1;
+    }
+
+    vout(NORMAL) << "Initial parameters:\n";
+    ROOT::Minuit2::MnUserParameters params = makeParameters(x0, e0, c);
+    vout(NORMAL) << params << std::endl;
+
+    if (warmStart.covariance.rows() != n || warmStart.covariance.cols() != n)
+    {
+        return run(F, params, nullptr, c, false);
+    }
+
+    std::vector<unsigned int> var;
+    for (unsigned int i = 0; i < n; i++)
+    {
+        if (i >= c.size() || !c[i].hasFixedValue())
+            var.push_back(i);
+    }
+    // a parameter which was fixed in the previous minimization has no
+    // variance, and would make the seed singular
+    for (auto i : var)
+    {
+        if (!(warmStart.covariance(i, i) > 0.))
+        {
+            vout(NORMAL) << "Parameter " << i << " has no previous variance, not seeding the covariance\n";
+            return run(F, params, nullptr, c, false);
+        }
+    }
+    ROOT::Minuit2::MnUserCovariance cov(var.size());
+    for (unsigned int k1 = 0; k1 < var.size(); k1++)
+        for (unsigned int k2 = 0; k2 <= k1; k2++)
+        {
+            cov(k1, k2) = warmStart.covariance(var[k1], var[k2]);
+        }
+
+    return run(F, params, &cov, c, false);
+}
+
+template<typename T>
+ROOT::Minuit2::MnUserParameters MnMigradMinimizer<T>::makeParameters(
+    const std::vector<T> &x0,
+    const std::vector<T> &e0,
+    const std::vector<ScalarConstraint<T>> &c) const
+{
     ROOT::Minuit2::MnUserParameters params(x0, e0);
     for (int i = 0; i < c.size(); i++)
     {
@@ -162,27 +368,46 @@ typename Minimizer<T>::Result MnMigradMinimizer<T>::minimize(
         if (c[i].hasUpperBound())
             params.SetUpperLimit(i, c[i].upperBound());
     }
-    vout(NORMAL) << params << std::endl;
+    return params;
+}
+
+template<typename T>
+typename Minimizer<T>::Result MnMigradMinimizer<T>::run(
+    const ScalarFunction<T> &F,
+    const ROOT::Minuit2::MnUserParameters &params,
+    const ROOT::Minuit2::MnUserCovariance *cov,
+    const std::vector<ScalarConstraint<T>> &c,
+    bool pre_minimize)
+{
+    utils::vostream vout(std::cout, _Opts.verbosity);
+    auto start = std::chrono::steady_clock::now();
 
-    auto MnF = new Mn2FCNWrapper(F, _Opts);
+    InstrumentedFunction<T> IF(F, _Opts.time_evaluations);
+    Mn2FCNWrapper MnF(IF, _Opts);
+    std::unique_ptr<Mn2FCNGradientWrapper> MnG;
+    if (_Opts.parallel_gradient || IF.hasGradient())
+    {
+        MnG.reset(new Mn2FCNGradientWrapper(IF, _Opts, derivatives(IF, params.Errors(), c)));
+    }
 
-    if (_Opts.pre_minimize)
+    if (pre_minimize)
     {
         vout(DEBUG) << "(MINUIT) Pre-minimizer call :\n"
                     << "--------------------------------------------------------";
-        ROOT::Minuit2::MnMigrad migrad1(*MnF, params, _Opts.pre_min_level);
-        auto preMin = migrad1();
+        auto preMin = MnG
+                      ? migrad(*MnG, params, nullptr, _Opts.pre_min_level)
+                      : migrad(MnF, params, nullptr, _Opts.pre_min_level);
         vout(DEBUG) << preMin
                     << "--------------------------------------------------------"
                     << std::endl;
 
     }
+    unsigned long nPreMinCalls = IF.nCalls();
     vout(DEBUG) << "(MINUIT) Minimizer call :\n"
                 << "--------------------------------------------------------";
-    ROOT::Minuit2::MnMigrad migrad2(*MnF, params, _Opts.level);
-    auto Min =  migrad2();
-
-    delete MnF;
+    auto Min = MnG
+               ? migrad(*MnG, params, cov, _Opts.level)
+               : migrad(MnF, params, cov, _Opts.level);
 
     typename Minimizer<T>::Result result;
     result.final_cost = Min.Fval();
@@ -190,6 +415,76 @@ typename Minimizer<T>::Result MnMigradMinimizer<T>::minimize(
     result.minimum = Min.UserParameters().Params();
     result.errors = Min.UserParameters().Errors();
 
+    // covariance of the variable parameters, in external numbering
+    unsigned int n = result.minimum.size();
+    if (Min.HasCovariance())
+    {
+        const ROOT::Minuit2::MnUserCovariance &ucov = Min.UserCovariance();
+        std::vector<unsigned int> var;
+        for (unsigned int i = 0; i < n; i++)
+        {
+            if (i >= c.size() || !c[i].hasFixedValue())
+                var.push_back(i);
+        }
+        result.covariance.setZero(n, n);
+        for (unsigned int k1 = 0; k1 < var.size(); k1++)
+            for (unsigned int k2 = 0; k2 < var.size(); k2++)
+            {
+                result.covariance(var[k1], var[k2]) = ucov(k1, k2);
+            }
+    }
+
+    // finite difference Hessian at the minimum
+    if (_Opts.hessian && Min.IsValid())
+    {
+        Matrix<T> H;
+        Eigen::LLT<Matrix<T>> llt;
+        bool ok = derivatives(IF, result.errors, c).hessian(result.minimum.data(), H);
+        if (ok)
+        {
+            llt.compute(H);
+            ok = llt.info() == Eigen::Success;
+        }
+        if (ok)
+        {
+            Matrix<T> hcov = 2 * _Opts.error_definition * llt.solve(Matrix<T>::Identity(n, n));
+            result.covariance.setZero(n, n);
+            for (unsigned int i = 0; i < n; i++)
+            {
+                if (i < c.size() && c[i].hasFixedValue())
+                    continue;
+                for (unsigned int j = 0; j < n; j++)
+                    if (j >= c.size() || !c[j].hasFixedValue())
+                        result.covariance(i, j) = hcov(i, j);
+                result.errors[i] = std::sqrt(result.covariance(i, i));
+            }
+        }
+        else
+        {
+            vout(NORMAL) << "(MINUIT) Finite difference Hessian is not positive definite, "
+                         << "keeping MIGRAD covariance\n";
+        }
+    }
+
+    if (!_Opts.minos.empty() && Min.IsValid())
+    {
+        runMinos(IF, Min, c, result);
+    }
+
+    Telemetry &tel = result.telemetry;
+    tel.n_calls = IF.nCalls();
+    tel.n_gradient_calls = IF.nGradientCalls();
+    tel.n_pre_min_calls = nPreMinCalls;
+    tel.eval_time = IF.evalTime();
+    for (auto &st : Min.States())
+    {
+        tel.edm_trace.push_back(st.Edm());
+    }
+    tel.total_time = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start).count();
+    vout(DEBUG) << tel;
+
+
     if (!Min.IsValid())
     {
         vout(NORMAL) << "Minuit Library reported that minimization result is not valid !\n";
@@ -214,14 +509,146 @@ typename Minimizer<T>::Result MnMigradMinimizer<T>::minimize(
     }
 }
 
+// Each MINOS bound is an independent task, with its own FCN wrapper. MnMinos
+// only reads the minimum, which all the tasks share. The tasks all evaluate
+// the same function, so they only run concurrently if it is thread-safe. Bounds that are not
+// computed are left to 0 and flagged as not valid, as are the bounds where
+// MINOS fails (the error is then the parabolic one).
 template<typename T>
-typename Minimizer<T>::Result MnMigradMinimizer<T>::minimize(
+void MnMigradMinimizer<T>::runMinos(
+    const InstrumentedFunction<T> &F,
+    const ROOT::Minuit2::FunctionMinimum &Min,
+    const std::vector<ScalarConstraint<T>> &c,
+    typename Minimizer<T>::Result &result) const
+{
+    utils::vostream vout(std::cout, _Opts.verbosity);
+    unsigned int n = result.minimum.size();
+    std::vector<unsigned int> par;
+    for (auto i : _Opts.minos)
+    {
+        if (i >= n)
+        {
+            ERROR(SIZE, "out of limit MINOS parameter (requested "
+                  + utils::strFrom(i) + " out of " + utils::strFrom(n) + ")");
+        }
+        if (i < c.size() && c[i].hasFixedValue())
+        {
+            vout(NORMAL) << "(MINUIT) parameter " << i << " is fixed, skipping MINOS\n";
+            continue;
+        }
+        par.push_back(i);
+    }
+    result.lower_errors.assign(n, 0.);
+    result.upper_errors.assign(n, 0.);
+    result.lower_valid.assign(n, false);
+    result.upper_valid.assign(n, false);
+    // std::vector<bool> elements cannot be written from several threads
+    const int nTasks = 2 * par.size();
+    std::vector<char> valid(nTasks, 0);
+    std::exception_ptr error;
+#ifdef _OPENMP
+    const bool parallel = _Opts.minos_parallel && F.isThreadSafe();
+#endif
+    #pragma omp parallel for schedule(dynamic, 1) if(parallel)
+    for (int k = 0; k < nTasks; ++k)
+    {
+        unsigned int i = par[k / 2];
+        try
+        {
+            Mn2FCNWrapper MnF(F, _Opts);
+            ROOT::Minuit2::MnMinos minos(MnF, Min, _Opts.level);
+            double xmin = Min.UserState().Value(i);
+            if (k % 2 == 0)
+            {
+                ROOT::Minuit2::MinosError me(i, xmin, minos.Loval(i, _Opts.minos_max_calls),
+                                             ROOT::Minuit2::MnCross());
+                result.lower_errors[i] = me.Lower();
+                valid[k] = me.LowerValid();
+            }
+            else
+            {
+                ROOT::Minuit2::MinosError me(i, xmin, ROOT::Minuit2::MnCross(),
+                                             minos.Upval(i, _Opts.minos_max_calls));
+                result.upper_errors[i] = me.Upper();
+                valid[k] = me.UpperValid();
+            }
+        }
+        catch (...)
+        {
+            #pragma omp critical
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    for (int k = 0; k < nTasks; ++k)
+    {
+        (k % 2 == 0 ? result.lower_valid : result.upper_valid)[par[k / 2]] = valid[k];
+    }
+
+    for (auto i : par)
+    {
+        vout(NORMAL) << "(MINOS) parameter " << i << ": " << result.minimum[i]
+                     << " " << result.lower_errors[i] << (result.lower_valid[i] ? "" : " (invalid)")
+                     << " +" << result.upper_errors[i] << (result.upper_valid[i] ? "" : " (invalid)")
+                     << std::endl;
+    }
+}
+
+template<typename T>
+NumericalDerivatives<T> MnMigradMinimizer<T>::derivatives(
     const ScalarFunction<T> &F,
-    const std::vector<T> &x0,
-    const std::vector<ScalarConstraint<T>> &c)
+    const std::vector<double> &scale,
+    const std::vector<ScalarConstraint<T>> &c) const
 {
-    std::vector<T> e0(x0.size(), 0.1);
-    return minimize(F, x0, e0, c);
+    unsigned int n = scale.size();
+    Vector<T> s(n), lo(n), hi(n);
+    for (unsigned int i = 0; i < n; i++)
+    {
+        s(i) = scale[i] > 0. ? scale[i] : 0.1;
+        lo(i) = -std::numeric_limits<T>::infinity();
+        hi(i) = std::numeric_limits<T>::infinity();
+        if (i >= c.size())
+            continue;
+        if (c[i].hasFixedValue())
+        {
+            lo(i) = hi(i) = c[i].fixedValue();
+            continue;
+        }
+        if (c[i].hasLowerBound())
+            lo(i) = c[i].lowerBound();
+        if (c[i].hasUpperBound())
+            hi(i) = c[i].upperBound();
+    }
+    NumericalDerivatives<T> D(F, s);
+    D.setBounds(lo, hi);
+    D.setGradientStep(_Opts.gradient_step);
+    D.setHessianStep(_Opts.hessian_step);
+    D.setRichardson(_Opts.richardson);
+    return D;
+}
+
+template<typename T>
+template<typename FCN>
+ROOT::Minuit2::FunctionMinimum MnMigradMinimizer<T>::migrad(
+    const FCN &fcn,
+    const ROOT::Minuit2::MnUserParameters &params,
+    const ROOT::Minuit2::MnUserCovariance *cov,
+    unsigned int level)
+{
+    if (cov)
+    {
+        ROOT::Minuit2::MnMigrad migrad(fcn, params, *cov, level);
+        return migrad();
+    }
+    ROOT::Minuit2::MnMigrad migrad(fcn, params, level);
+    return migrad();
 }
 
 // template<typename T>
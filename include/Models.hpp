@@ -0,0 +1,377 @@
+/*
+ * Models.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef MODELS_HPP
+#define MODELS_HPP
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "Globals.hpp"
+#include "Exceptions.hpp"
+#include "ParametrizedFunction.hpp"
+
+BEGIN_NAMESPACE(LQCDA)
+BEGIN_NAMESPACE(MODELS)
+
+/******************************************************************************
+ *                            Exponential models                              *
+ ******************************************************************************/
+
+BEGIN_NAMESPACE(internal)
+
+// Sum of exponential states in the time x0 = t, with parameters
+// (A_0, E_0, A_1, E_1, ...):
+//     f(t) = sum_i A_i s_i(t) b_i(t),
+//     b_i(t) = exp(-E_i t) [+/- exp(-E_i (Lt - t)) if periodic],
+// where s_i(t) = (-1)^t = cos(pi t) for oscillating states and 1 otherwise.
+// Amplitudes are linear parameters. Batches are evaluated state by state,
+// with a vectorizable loop over the points.
+template<typename T>
+class ExponentialModel
+    : public ParametrizedScalarFunction<T>
+{
+private:
+    // oscillating states
+    std::vector<bool> _isOscillating;
+    // time extent, 0 if not periodic
+    T _Lt;
+    // +1 for cosh-like, -1 for sinh-like periodic states
+    T _Sign;
+
+public:
+    // Constructors/Destructor
+    ExponentialModel(unsigned int nStates, unsigned int nOscillating, T Lt, T sign);
+    virtual ~ExponentialModel() = default;
+
+public: // Queries
+    using ParametrizedScalarFunction<T>::xDim;
+    using ParametrizedScalarFunction<T>::yDim;
+    using ParametrizedScalarFunction<T>::nPar;
+    unsigned int nStates() const
+    {
+        return _isOscillating.size();
+    }
+    bool isPeriodic() const
+    {
+        return _Lt > 0;
+    }
+    T timeExtent() const
+    {
+        return _Lt;
+    }
+
+public: // Evaluators
+    virtual T operator()(const T *x, const T *p) const override;
+    using ParametrizedScalarFunction<T>::operator();
+    virtual void evaluateMany(const T *X, unsigned int nPoints, const T *p, T *out) const override;
+
+public: // Linearity
+    virtual bool isLinearParameter(unsigned int k) const override
+    {
+        return k % 2 == 0;
+    }
+
+public: // Derivatives
+    virtual bool hasParameterGradient() const override
+    {
+        return true;
+    }
+    virtual void parameterGradient(const T *x, const T *p, T *g) const override;
+
+private:
+    // b_i(t) s_i(t) and its derivative with respect to E_i
+    void state(unsigned int i, T E, T t, T &b, T &db) const
+    {
+        T e1 = std::exp(-E * t);
+        b = e1;
+        db = -t * e1;
+        if (isPeriodic())
+        {
+            T e2 = std::exp(-E * (_Lt - t));
+            b += _Sign * e2;
+            db -= _Sign * (_Lt - t) * e2;
+        }
+        if (_isOscillating[i])
+        {
+            T s = std::cos(M_PI * t);
+            b *= s;
+            db *= s;
+        }
+    }
+};
+
+template<typename T>
+ExponentialModel<T>::ExponentialModel(unsigned int nStates, unsigned int nOscillating, T Lt, T sign)
+    : ParametrizedScalarFunction<T>(1, 2 * (nStates + nOscillating))
+    , _isOscillating(nStates + nOscillating, false)
+    , _Lt(Lt)
+    , _Sign(sign)
+{
+    if (nStates + nOscillating == 0)
+    {
+        ERROR(SIZE, "exponential model needs at least one state");
+    }
+    std::fill(_isOscillating.begin() + nStates, _isOscillating.end(), true);
+}
+
+template<typename T>
+T ExponentialModel<T>::operator()(const T *x, const T *p) const
+{
+    T res {0}, b, db;
+    for (unsigned int i = 0; i < nStates(); ++i)
+    {
+        state(i, p[2 * i + 1], x[0], b, db);
+        res += p[2 * i] * b;
+    }
+    return res;
+}
+
+template<typename T>
+void ExponentialModel<T>::evaluateMany(const T *X, unsigned int nPoints, const T *p, T *out) const
+{
+    const unsigned int xdim = xDim();
+    std::fill(out, out + nPoints, T {0});
+    for (unsigned int i = 0; i < nStates(); ++i)
+    {
+        const T A = p[2 * i], E = p[2 * i + 1];
+        const bool osc = _isOscillating[i];
+        if (isPeriodic())
+        {
+            for (unsigned int k = 0; k < nPoints; ++k)
+            {
+                const T t = X[k * xdim];
+                T b = std::exp(-E * t) + _Sign * std::exp(-E * (_Lt - t));
+                out[k] += A * (osc ? b * std::cos(M_PI * t) : b);
+            }
+        }
+        else
+        {
+            for (unsigned int k = 0; k < nPoints; ++k)
+            {
+                const T t = X[k * xdim];
+                T b = std::exp(-E * t);
+                out[k] += A * (osc ? b * std::cos(M_PI * t) : b);
+            }
+        }
+    }
+}
+
+template<typename T>
+void ExponentialModel<T>::parameterGradient(const T *x, const T *p, T *g) const
+{
+    T b, db;
+    for (unsigned int i = 0; i < nStates(); ++i)
+    {
+        state(i, p[2 * i + 1], x[0], b, db);
+        g[2 * i] = b;
+        g[2 * i + 1] = p[2 * i] * db;
+    }
+}
+
+END_NAMESPACE // internal
+
+// f(t) = sum_i A_i exp(-E_i t), parameters (A_0, E_0, A_1, E_1, ...)
+template<typename T>
+class MultiExp
+    : public internal::ExponentialModel<T>
+{
+public:
+    explicit MultiExp(unsigned int nStates = 1)
+        : internal::ExponentialModel<T>(nStates, 0, 0, 1)
+    {}
+};
+
+// Periodic correlator with time extent Lt,
+// f(t) = sum_i A_i (exp(-E_i t) + exp(-E_i (Lt - t)))
+template<typename T>
+class Cosh
+    : public internal::ExponentialModel<T>
+{
+public:
+    Cosh(unsigned int nStates, T Lt)
+        : internal::ExponentialModel<T>(nStates, 0, Lt, 1)
+    {}
+};
+
+// Anti-periodic correlator with time extent Lt,
+// f(t) = sum_i A_i (exp(-E_i t) - exp(-E_i (Lt - t)))
+template<typename T>
+class Sinh
+    : public internal::ExponentialModel<T>
+{
+public:
+    Sinh(unsigned int nStates, T Lt)
+        : internal::ExponentialModel<T>(nStates, 0, Lt, -1)
+    {}
+};
+
+// Staggered correlator with nStates non-oscillating states followed by
+// nOscillating opposite-parity states, f(t) = sum_i A_i b_i(t) +
+// (-1)^t sum_j B_j b_j(t), periodic (cosh) if Lt > 0. Parameters are
+// (A_0, E_0, ..., B_0, M_0, ...)
+template<typename T>
+class Oscillating
+    : public internal::ExponentialModel<T>
+{
+public:
+    Oscillating(unsigned int nStates, unsigned int nOscillating, T Lt = 0)
+        : internal::ExponentialModel<T>(nStates, nOscillating, Lt, 1)
+    {}
+};
+
+/******************************************************************************
+ *                               Polynomial                                   *
+ ******************************************************************************/
+
+// f(x) = sum_k c_k prod_j x_j^{n_kj}, with monomials given by their powers
+// n_kj, e.g. {{0, 0}, {1, 0}, {0, 1}} for c_0 + c_1 x_0 + c_2 x_1 (chiral and
+// continuum extrapolations in m_pi^2 and a^2). The model is linear.
+template<typename T>
+class Polynomial
+    : public ParametrizedScalarFunction<T>
+{
+public:
+    // Typedefs
+    typedef std::vector<unsigned int> Monomial;
+
+private:
+    std::vector<Monomial> _Terms;
+
+public:
+    // Constructors/Destructor
+    // c_0 + c_1 x + ... + c_degree x^degree
+    explicit Polynomial(unsigned int degree);
+    explicit Polynomial(const std::vector<Monomial> &terms);
+    virtual ~Polynomial() = default;
+
+public: // Queries
+    using ParametrizedScalarFunction<T>::xDim;
+    using ParametrizedScalarFunction<T>::yDim;
+    using ParametrizedScalarFunction<T>::nPar;
+    const std::vector<Monomial> &terms() const
+    {
+        return _Terms;
+    }
+
+public: // Evaluators
+    virtual T operator()(const T *x, const T *p) const override;
+    using ParametrizedScalarFunction<T>::operator();
+    virtual void evaluateMany(const T *X, unsigned int nPoints, const T *p, T *out) const override;
+
+public: // Linearity
+    virtual bool isLinear() const override
+    {
+        return true;
+    }
+    virtual void designRow(const T *x, T *row) const override;
+
+public: // Derivatives
+    virtual bool hasParameterGradient() const override
+    {
+        return true;
+    }
+    virtual void parameterGradient(const T *x, const T *p, T *g) const override
+    {
+        designRow(x, g);
+    }
+
+private:
+    T monomial(unsigned int k, const T *x) const
+    {
+        T m {1};
+        for (unsigned int j = 0; j < _Terms[k].size(); ++j)
+        {
+            for (unsigned int n = 0; n < _Terms[k][j]; ++n)
+            {
+                m *= x[j];
+            }
+        }
+        return m;
+    }
+};
+
+template<typename T>
+Polynomial<T>::Polynomial(unsigned int degree)
+    : ParametrizedScalarFunction<T>(1, degree + 1)
+{
+    for (unsigned int k = 0; k <= degree; ++k)
+    {
+        _Terms.push_back(Monomial(1, k));
+    }
+}
+
+template<typename T>
+Polynomial<T>::Polynomial(const std::vector<Monomial> &terms)
+    : _Terms(terms)
+{
+    if (terms.empty() || terms[0].empty())
+    {
+        ERROR(SIZE, "polynomial needs at least one term and one variable");
+    }
+    for (auto &t : terms)
+    {
+        if (t.size() != terms[0].size())
+        {
+            ERROR(SIZE, "polynomial terms have different numbers of variables");
+        }
+    }
+    this->setSize(terms[0].size(), terms.size());
+}
+
+template<typename T>
+T Polynomial<T>::operator()(const T *x, const T *p) const
+{
+    T res {0};
+    for (unsigned int k = 0; k < _Terms.size(); ++k)
+    {
+        res += p[k] * monomial(k, x);
+    }
+    return res;
+}
+
+// Horner scheme for single variable polynomials
+template<typename T>
+void Polynomial<T>::evaluateMany(const T *X, unsigned int nPoints, const T *p, T *out) const
+{
+    const unsigned int xdim = xDim();
+    bool horner = xdim == 1;
+    for (unsigned int k = 0; k < _Terms.size() && horner; ++k)
+    {
+        horner = _Terms[k][0] == k;
+    }
+    if (!horner)
+    {
+        ParametrizedScalarFunction<T>::evaluateMany(X, nPoints, p, out);
+        return;
+    }
+    const unsigned int n = _Terms.size();
+    std::fill(out, out + nPoints, p[n - 1]);
+    for (unsigned int k = n - 1; k-- > 0;)
+    {
+        const T c = p[k];
+        for (unsigned int i = 0; i < nPoints; ++i)
+        {
+            out[i] = out[i] * X[i] + c;
+        }
+    }
+}
+
+template<typename T>
+void Polynomial<T>::designRow(const T *x, T *row) const
+{
+    for (unsigned int k = 0; k < _Terms.size(); ++k)
+    {
+        row[k] = monomial(k, x);
+    }
+}
+
+END_NAMESPACE // MODELS
+END_NAMESPACE // LQCDA
+
+#endif // MODELS_HPP
@@ -0,0 +1,461 @@
+/*
+ * MultiStartMinimizer.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef MULTI_START_MINIMIZER_HPP
+#define MULTI_START_MINIMIZER_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <limits>
+
+#include "Minimizer.hpp"
+#include "Minuit2Minimizer.hpp"
+#include "Random.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+BEGIN_NAMESPACE(LQCDA)
+BEGIN_NAMESPACE(MIN)
+
+BEGIN_NAMESPACE(internal)
+
+// n points on a Latin hypercube, over the bounds of the parameters that have
+// both and over x0 +/- spread * max(|x0|, e0) (cut by a single bound) for the
+// others. Fixed parameters keep their x0 value.
+template<typename T>
+std::vector<std::vector<T>> LatinHypercube(
+    const std::vector<T> &x0,
+    const std::vector<T> &e0,
+    const std::vector<ScalarConstraint<T>> &c,
+    unsigned int n,
+    double spread,
+    RandGen &rg)
+{
+    const unsigned int npar = x0.size();
+    std::vector<std::vector<T>> points(n, x0);
+    std::vector<unsigned int> perm(n);
+    for (unsigned int i = 0; i < npar && n > 0; i++)
+    {
+        const bool hasC = i < c.size();
+        if (hasC && c[i].hasFixedValue())
+        {
+            continue;
+        }
+        T width = spread * std::max<T>(std::abs(x0[i]), e0[i]);
+        T lo = x0[i] - width, hi = x0[i] + width;
+        if (hasC && c[i].hasLowerBound() && c[i].hasUpperBound())
+        {
+            lo = c[i].lowerBound();
+            hi = c[i].upperBound();
+        }
+        else if (hasC && c[i].hasLowerBound())
+        {
+            lo = std::max(lo, c[i].lowerBound());
+            hi = std::max(hi, lo + 2 * width);
+        }
+        else if (hasC && c[i].hasUpperBound())
+        {
+            hi = std::min(hi, c[i].upperBound());
+            lo = std::min(lo, hi - 2 * width);
+        }
+
+        for (unsigned int k = 0; k < n; k++)
+        {
+            perm[k] = k;
+        }
+        for (unsigned int k = n - 1; k > 0; k--)
+        {
+            std::swap(perm[k], perm[rg.getUniformInt(k + 1)]);
+        }
+        for (unsigned int k = 0; k < n; k++)
+        {
+            points[k][i] = lo + (hi - lo) * (perm[k] + rg.getUniform(0., 1.)) / n;
+        }
+    }
+    return points;
+}
+
+END_NAMESPACE // internal
+
+template<typename INNER_OPTIONS>
+class MultiStartMinimizerOptions
+    : public MinimizerOptions
+{
+public:
+    // number of starting points (the first one is x0)
+    unsigned int n_starts;
+    // half-width of the sampling box around x0 for parameters without both
+    // bounds, in units of max(|x0|, e0)
+    double spread;
+    // random generator seed
+    int seed;
+    // run the starts concurrently
+    bool parallel;
+    // cancel runs still above best cost + cancel_margin * max(|best cost|, 1)
+    // after cancel_after cost function calls. The best cost is the one found
+    // so far by the concurrent runs, so that the cancelled runs (and possibly
+    // the result) depend on the thread scheduling.
+    bool cancel;
+    double cancel_margin;
+    unsigned long cancel_after;
+    // inner minimizer options
+    INNER_OPTIONS inner;
+
+public:
+    MultiStartMinimizerOptions()
+        : MinimizerOptions()
+    {
+        init();
+    }
+    MultiStartMinimizerOptions(const MinimizerOptions &opts)
+        : MinimizerOptions(opts)
+    {
+        init();
+    }
+
+    virtual ~MultiStartMinimizerOptions() noexcept = default;
+
+    virtual void print(std::ostream &os) const override
+    {
+        os << "Multi-start options:\n"
+           << "\tn_starts = " << n_starts << std::endl
+           << "\tspread = " << spread << std::endl
+           << "\tseed = " << seed << std::endl
+           << "\tparallel = " << parallel << std::endl
+           << "\tcancel = " << cancel << std::endl
+           << "\tcancel_margin = " << cancel_margin << std::endl
+           << "\tcancel_after = " << cancel_after << std::endl;
+        inner.print(os);
+    }
+
+private:
+    void init()
+    {
+        n_starts = 16;
+        spread = 1.;
+        seed = 1;
+        parallel = true;
+        cancel = false;
+        cancel_margin = 1.;
+        cancel_after = 500;
+    }
+};
+
+/******************************************************************************
+ *                           MultiStartMinimizer                              *
+ ******************************************************************************/
+
+// Runs the INNER minimizer from several starting points drawn on a Latin
+// hypercube, over the bounds of the parameters that have both, and around x0
+// for the others. Starts run concurrently (the minimized function must be
+// thread-safe) and, if requested, a run whose cost stays well above the best
+// minimum found so far is cancelled. The best result is returned, all the local minima are
+// available through localMinima().
+template<typename T, template<typename> class INNER = MnMigradMinimizer>
+class MultiStartMinimizer
+    : public Minimizer<T>
+{
+    static_assert(std::is_base_of<Minimizer<T>, INNER<T>>::value,
+                  "MultiStartMinimizer requires an inner minimizer");
+
+public:
+    // Typedefs
+    typedef MultiStartMinimizerOptions<typename INNER<T>::OptionsType> OptionsType;
+    typedef MULTISTART_ID ID;
+    typedef typename Minimizer<T>::Result Result;
+
+    // Outcome of one start
+    struct LocalMinimum
+    {
+        std::vector<T> start;
+        Result result;
+        bool cancelled;
+    };
+
+private:
+    // Thrown to abort a dominated run
+    struct Cancelled {};
+
+    // Cost function of one run, tracks its best value against the global one.
+    // It counts its own calls, so that the calls of a cancelled run (whose
+    // telemetry is lost with the exception) are still reported.
+    class RunFunction
+        : public ScalarFunction<T>
+    {
+    public:
+        RunFunction(const ScalarFunction<T> &f, const std::atomic<double> &best,
+                    const OptionsType &opts)
+            : ScalarFunction<T>(f.xDim())
+            , _F(f)
+            , _Best(best)
+            , _Opts(opts)
+        {}
+
+        virtual T operator()(const T *x) const override
+        {
+            unsigned long nCalls = _nCalls.fetch_add(1, std::memory_order_relaxed) + 1;
+            T res = _F(x);
+            double min = _Min.load(std::memory_order_relaxed);
+            while (res < min && !_Min.compare_exchange_weak(min, res, std::memory_order_relaxed))
+                ;
+            min = std::min<double>(min, res);
+            double best = _Best.load(std::memory_order_relaxed);
+            if (_Opts.cancel && nCalls > _Opts.cancel_after
+                    && min > best + _Opts.cancel_margin * std::max(std::abs(best), 1.))
+            {
+                throw Cancelled();
+            }
+            return res;
+        }
+        using ScalarFunction<T>::operator();
+        virtual bool isThreadSafe() const override
+        {
+            return _F.isThreadSafe();
+        }
+        virtual bool hasGradient() const override
+        {
+            return _F.hasGradient();
+        }
+        virtual void gradient(const T *x, T *g) const override
+        {
+            _F.gradient(x, g);
+        }
+
+        unsigned long nCalls() const
+        {
+            return _nCalls.load(std::memory_order_relaxed);
+        }
+
+    private:
+        const ScalarFunction<T> &_F;
+        const std::atomic<double> &_Best;
+        const OptionsType &_Opts;
+        mutable std::atomic<unsigned long> _nCalls {0};
+        mutable std::atomic<double> _Min {std::numeric_limits<double>::infinity()};
+    };
+
+private:
+    OptionsType _Opts;
+    std::vector<LocalMinimum> _Minima;
+
+public:
+    // Constructor
+    MultiStartMinimizer(const OptionsType &opts = OptionsType())
+        : _Opts(opts)
+    {}
+    // Destructor
+    virtual ~MultiStartMinimizer() noexcept = default;
+
+    // Options
+    virtual OptionsType &options() override
+    {
+        return _Opts;
+    }
+
+    // Minimize
+    using Minimizer<T>::minimize;
+    virtual Result minimize(
+        const ScalarFunction<T> &F,
+        const std::vector<T> &x0,
+        const std::vector<T> &e0,
+        const std::vector<ScalarConstraint<T>> &c) override;
+    Result minimize(
+        const ScalarFunction<T> &F,
+        const std::vector<T> &x0,
+        const std::vector<ScalarConstraint<T>> &c);
+
+    // Local minima of the last minimization, sorted by increasing cost
+    const std::vector<LocalMinimum> &localMinima() const
+    {
+        return _Minima;
+    }
+    // Spread (standard deviation) of the converged local minima
+    std::vector<T> spread() const;
+
+private:
+    std::vector<std::vector<T>> startingPoints(
+        const std::vector<T> &x0,
+        const std::vector<T> &e0,
+        const std::vector<ScalarConstraint<T>> &c);
+};
+
+template<typename T>
+using MULTISTART = MultiStartMinimizer<T>;
+
+template<typename T, template<typename> class INNER>
+typename MultiStartMinimizer<T, INNER>::Result MultiStartMinimizer<T, INNER>::minimize(
+    const ScalarFunction<T> &F,
+    const std::vector<T> &x0,
+    const std::vector<T> &e0,
+    const std::vector<ScalarConstraint<T>> &c)
+{
+    utils::vostream vout(std::cout, _Opts.verbosity);
+    vout(NORMAL) << "Minimizing with multi-start minimizer\n";
+    vout(NORMAL) << _Opts << std::endl;
+
+    if (e0.size() != x0.size())
+    {
+        ERROR(SIZE, "initial errors size mismatch (expected "
+              + utils::strFrom(x0.size()) + ", got " + utils::strFrom(e0.size()) + ")");
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::vector<T>> starts = startingPoints(x0, e0, c);
+    const int n = starts.size();
+
+    typename INNER<T>::OptionsType innerOpts = _Opts.inner;
+    innerOpts.verbosity = _Opts.verbosity == DEBUG ? DEBUG : SILENT;
+
+    // evaluation wall time of the concurrent runs
+    InstrumentedFunction<T> IF(F, _Opts.time_evaluations);
+    std::atomic<double> best {std::numeric_limits<double>::infinity()};
+    std::vector<LocalMinimum> minima(n);
+    std::exception_ptr error;
+
+    #pragma omp parallel for schedule(dynamic, 1) if(_Opts.parallel)
+    for (int k = 0; k < n; ++k)
+    {
+        LocalMinimum &lm = minima[k];
+        lm.start = starts[k];
+        lm.cancelled = false;
+        lm.result.is_valid = false;
+        lm.result.final_cost = std::numeric_limits<double>::infinity();
+        RunFunction RF(IF, best, _Opts);
+        try
+        {
+            INNER<T> inner(innerOpts);
+            lm.result = inner.minimize(RF, lm.start, e0, c);
+            if (lm.result.is_valid)
+            {
+                double cur = best.load();
+                while (lm.result.final_cost < cur
+                        && !best.compare_exchange_weak(cur, lm.result.final_cost))
+                    ;
+            }
+        }
+        catch (const Cancelled &)
+        {
+            lm.cancelled = true;
+            lm.result.telemetry.n_calls = RF.nCalls();
+        }
+        catch (...)
+        {
+            #pragma omp critical
+            if (!error)
+            {
+                error = std::current_exception();
+            }
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+
+    std::stable_sort(minima.begin(), minima.end(),
+                     [](const LocalMinimum & a, const LocalMinimum & b)
+    {
+        if (a.result.is_valid != b.result.is_valid)
+            return a.result.is_valid;
+        return a.result.final_cost < b.result.final_cost;
+    });
+    _Minima = std::move(minima);
+
+    Result result = _Minima.front().result;
+    Telemetry &tel = result.telemetry;
+    tel = Telemetry();
+    unsigned int nCancelled = 0;
+    for (auto &lm : _Minima)
+    {
+        tel.n_calls += lm.result.telemetry.n_calls;
+        tel.n_gradient_calls += lm.result.telemetry.n_gradient_calls;
+        tel.n_pre_min_calls += lm.result.telemetry.n_pre_min_calls;
+        nCancelled += lm.cancelled;
+    }
+    tel.eval_time = IF.evalTime();
+    tel.edm_trace = _Minima.front().result.telemetry.edm_trace;
+    tel.total_time = std::chrono::duration<double>(
+                         std::chrono::steady_clock::now() - start).count();
+
+    vout(NORMAL) << "(MULTISTART) " << n << " starts, " << nCancelled << " cancelled\n"
+                 << "Best cost = " << result.final_cost
+                 << (result.is_valid ? "" : " (not valid)") << std::endl;
+    vout(DEBUG) << tel;
+
+    return result;
+}
+
+template<typename T, template<typename> class INNER>
+typename MultiStartMinimizer<T, INNER>::Result MultiStartMinimizer<T, INNER>::minimize(
+    const ScalarFunction<T> &F,
+    const std::vector<T> &x0,
+    const std::vector<ScalarConstraint<T>> &c)
+{
+    std::vector<T> e0(x0.size(), 0.1);
+    return minimize(F, x0, e0, c);
+}
+
+template<typename T, template<typename> class INNER>
+std::vector<T> MultiStartMinimizer<T, INNER>::spread() const
+{
+    std::vector<T> res;
+    unsigned int n = 0;
+    for (auto &lm : _Minima)
+    {
+        if (!lm.result.is_valid)
+            continue;
+        if (res.empty())
+        {
+            res.assign(lm.result.minimum.size(), T {0});
+        }
+        n++;
+    }
+    if (n < 2)
+    {
+        return res;
+    }
+    for (unsigned int i = 0; i < res.size(); i++)
+    {
+        T mean {0}, sq {0};
+        for (auto &lm : _Minima)
+            if (lm.result.is_valid)
+            {
+                mean += lm.result.minimum[i];
+                sq += lm.result.minimum[i] * lm.result.minimum[i];
+            }
+        mean /= n;
+        res[i] = std::sqrt(std::max(sq / n - mean * mean, T {0}) * n / (n - 1));
+    }
+    return res;
+}
+
+template<typename T, template<typename> class INNER>
+std::vector<std::vector<T>> MultiStartMinimizer<T, INNER>::startingPoints(
+    const std::vector<T> &x0,
+    const std::vector<T> &e0,
+    const std::vector<ScalarConstraint<T>> &c)
+{
+    const unsigned int n = std::max(1u, _Opts.n_starts);
+    std::vector<std::vector<T>> starts(1, x0);
+    if (n > 1)
+    {
+        RandGen rg(_Opts.seed);
+        std::vector<std::vector<T>> lhs = internal::LatinHypercube(x0, e0, c, n - 1, _Opts.spread, rg);
+        starts.insert(starts.end(), lhs.begin(), lhs.end());
+    }
+    return starts;
+}
+
+END_NAMESPACE
+END_NAMESPACE
+
+#endif // MULTI_START_MINIMIZER_HPP
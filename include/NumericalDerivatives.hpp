@@ -0,0 +1,253 @@
+/*
+ * NumericalDerivatives.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef NUMERICAL_DERIVATIVES_HPP
+#define NUMERICAL_DERIVATIVES_HPP
+
+#include <cmath>
+#include <limits>
+
+#include "Globals.hpp"
+#include "Function.hpp"
+#include "Exceptions.hpp"
+
+BEGIN_NAMESPACE(LQCDA)
+
+/******************************************************************************
+ *                           NumericalDerivatives                             *
+ ******************************************************************************/
+
+// Finite difference gradient and Hessian of a ScalarFunction. The step along
+// parameter i is step * max(|x_i|, scale_i). All the stencil points of a
+// gradient or a Hessian are evaluated with a single evaluateMany() call, which
+// Chi2CostFunction spreads across threads.
+// Parameters with equal lower and upper bounds are fixed (zero gradient,
+// identity Hessian block). Near a bound, gradients become one-sided and the
+// Hessian stencil is shifted inside the bounds.
+// When the number of parameters N is known at compile time (and small), the
+// stencils are fixed-size Eigen objects and no heap allocation is made.
+template<typename T, int N = Dynamic>
+class NumericalDerivatives
+{
+public:
+    // Typedefs
+    typedef Vector<T, N> VectorType;
+    typedef Matrix<T, N, N> MatrixType;
+
+private:
+    // Stencil sizes
+    static constexpr bool isFixedSize = N != Dynamic && N <= 12;
+    static constexpr int NG = isFixedSize ? 4 * N : Dynamic;
+    static constexpr int NH = isFixedSize ? 2 * N * N + 1 : Dynamic;
+    // values at the stencil points that are not skipped, on the stack in
+    // the fixed-size case
+    template<int MaxSize>
+    using Values = Eigen::Matrix<T, Dynamic, 1, Eigen::ColMajor, MaxSize, 1>;
+
+public:
+    // Constructors / Destructor
+    NumericalDerivatives(const ScalarFunction<T> &f, const VectorType &scale);
+    ~NumericalDerivatives() = default;
+
+    // Settings
+    void setBounds(const VectorType &lower, const VectorType &upper);
+    void setGradientStep(T step) { m_GradientStep = step; }
+    void setHessianStep(T step) { m_HessianStep = step; }
+    // Richardson extrapolation of central differences (twice the calls)
+    void setRichardson(bool richardson) { m_Richardson = richardson; }
+
+    // Derivatives
+    void gradient(const T *x, T *g) const;
+    // with the known value fx = f(x), which is not evaluated again when a
+    // bound makes the difference one-sided
+    void gradient(const T *x, T fx, T *g) const;
+    // returns false if the Hessian has non finite entries
+    bool hessian(const T *x, MatrixType &H) const;
+
+private:
+    bool isFixed(index_t i) const
+    {
+        return m_Lower(i) == m_Upper(i);
+    }
+    void gradient_h(const T *x, const T *fx, T *g) const;
+
+private:
+    const ScalarFunction<T> &m_F;
+    VectorType m_Scale;
+    VectorType m_Lower;
+    VectorType m_Upper;
+    T m_GradientStep {1.e-5};
+    T m_HessianStep {1.e-3};
+    bool m_Richardson {false};
+};
+
+template<typename T, int N>
+NumericalDerivatives<T, N>::NumericalDerivatives(const ScalarFunction<T> &f, const VectorType &scale)
+    : m_F(f)
+    , m_Scale(scale)
+{
+    if (f.xDim() && scale.size() != f.xDim())
+    {
+        ERROR(SIZE, "wrong number of derivative scales (expected "
+              + utils::strFrom(f.xDim()) + ", got " + utils::strFrom(scale.size()) + ")");
+    }
+    m_Lower.setConstant(scale.size(), -std::numeric_limits<T>::infinity());
+    m_Upper.setConstant(scale.size(), std::numeric_limits<T>::infinity());
+}
+
+template<typename T, int N>
+void NumericalDerivatives<T, N>::setBounds(const VectorType &lower, const VectorType &upper)
+{
+    if (lower.size() != m_Scale.size() || upper.size() != m_Scale.size())
+    {
+        ERROR(SIZE, "wrong number of bounds (expected " + utils::strFrom(m_Scale.size()) + ")");
+    }
+    m_Lower = lower;
+    m_Upper = upper;
+}
+
+template<typename T, int N>
+void NumericalDerivatives<T, N>::gradient(const T *x, T *g) const
+{
+    gradient_h(x, nullptr, g);
+}
+
+template<typename T, int N>
+void NumericalDerivatives<T, N>::gradient(const T *x, T fx, T *g) const
+{
+    gradient_h(x, &fx, g);
+}
+
+// Stencil point k of parameter i is at index ind(i, k) in the batch, or -1 if
+// it is x itself and fx is known
+template<typename T, int N>
+void NumericalDerivatives<T, N>::gradient_h(const T *x, const T *fx, T *g) const
+{
+    const index_t n = m_Scale.size();
+    ConstMap<VectorType> xv(x, n);
+    // at most 4 points per parameter
+    Matrix<T, N, NG> P(n, 4 * n);
+    Matrix<index_t, N, 4> ind(n, 4);
+    VectorType xp(n), xm(n);
+    Vector<bool, N> central(n);
+    index_t np = 0;
+    for (index_t i = 0; i < n; ++i)
+    {
+        if (isFixed(i))
+            continue;
+        T h = m_GradientStep * std::max(std::abs(x[i]), m_Scale(i));
+        central(i) = x[i] + h <= m_Upper(i) && x[i] - h >= m_Lower(i);
+        xp(i) = std::min(x[i] + h, m_Upper(i));
+        xm(i) = std::max(x[i] - h, m_Lower(i));
+        int nh = central(i) && m_Richardson ? 2 : 1;
+        for (int k = 0; k < 2 * nh; ++k)
+        {
+            T d = k < 2 ? T {1} : T {0.5};
+            T xk = x[i] + d * ((k % 2 == 0 ? xp(i) : xm(i)) - x[i]);
+            if (fx && xk == x[i])
+            {
+                ind(i, k) = -1;
+                continue;
+            }
+            P.col(np) = xv;
+            P(i, np) = xk;
+            ind(i, k) = np++;
+        }
+    }
+    Values<NG> f(np);
+    m_F.evaluateMany(P.data(), np, f.data());
+    auto fk = [&](index_t i, int k)
+    {
+        return ind(i, k) < 0 ? *fx : f(ind(i, k));
+    };
+
+    for (index_t i = 0; i < n; ++i)
+    {
+        if (isFixed(i))
+        {
+            g[i] = 0;
+            continue;
+        }
+        T d1 = (fk(i, 0) - fk(i, 1)) / (xp(i) - xm(i));
+        if (central(i) && m_Richardson)
+        {
+            T d2 = (fk(i, 2) - fk(i, 3)) / (xp(i) - xm(i)) * 2;
+            g[i] = (4 * d2 - d1) / 3;
+        }
+        else
+        {
+            g[i] = d1;
+        }
+    }
+}
+
+template<typename T, int N>
+bool NumericalDerivatives<T, N>::hessian(const T *x, MatrixType &H) const
+{
+    const index_t n = m_Scale.size();
+    VectorType h(n), xc = ConstMap<VectorType>(x, n);
+    for (index_t i = 0; i < n; ++i)
+    {
+        h(i) = m_HessianStep * std::max(std::abs(x[i]), m_Scale(i));
+        if (!isFixed(i) && m_Upper(i) - m_Lower(i) > 4 * h(i))
+        {
+            xc(i) = std::min(std::max(x[i], m_Lower(i) + 2 * h(i)), m_Upper(i) - 2 * h(i));
+        }
+    }
+
+    // stencil: centre, x +/- h_i e_i, then x +/- h_i e_i +/- h_j e_j (j < i)
+    Matrix<T, N, NH> P(n, 2 * n * n + 1);
+    index_t np = 0;
+    P.col(np++) = xc;
+    for (index_t i = 0; i < n; ++i)
+    {
+        if (isFixed(i))
+            continue;
+        for (int si = 1; si >= -1; si -= 2)
+        {
+            P.col(np) = xc;
+            P(i, np++) += si * h(i);
+        }
+        for (index_t j = 0; j < i; ++j)
+        {
+            if (isFixed(j))
+                continue;
+            for (int k = 0; k < 4; ++k)
+            {
+                P.col(np) = xc;
+                P(i, np) += k < 2 ? h(i) : -h(i);
+                P(j, np++) += k % 2 == 0 ? h(j) : -h(j);
+            }
+        }
+    }
+    Values<NH> f(np);
+    m_F.evaluateMany(P.data(), np, f.data());
+
+    H.setIdentity(n, n);
+    const T fc = f(0);
+    index_t col = 1;
+    for (index_t i = 0; i < n; ++i)
+    {
+        if (isFixed(i))
+            continue;
+        H(i, i) = (f(col) - 2 * fc + f(col + 1)) / (h(i) * h(i));
+        col += 2;
+        for (index_t j = 0; j < i; ++j)
+        {
+            if (isFixed(j))
+                continue;
+            H(i, j) = H(j, i) = (f(col) - f(col + 1) - f(col + 2) + f(col + 3))
+                                / (4 * h(i) * h(j));
+            col += 4;
+        }
+    }
+    return H.allFinite();
+}
+
+END_NAMESPACE
+
+#endif // NUMERICAL_DERIVATIVES_HPP
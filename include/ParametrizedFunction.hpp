@@ -8,7 +8,9 @@
 #ifndef PARAMETRIZED_FUNCTION_HPP
 #define PARAMETRIZED_FUNCTION_HPP
 
+#include <algorithm>
 #include <functional>
+#include <vector>
 
 #include "Function.hpp"
 
@@ -48,6 +50,33 @@ public: // Evaluator
     virtual T operator()(const T *x, const T *p) const = 0;
     T operator()(const std::vector<T> &x, const std::vector<T> &p) const;
     T operator()(const Vector<T> &x, const Vector<T> &p) const;
+    // Evaluates nPoints points stored contiguously in X (xDim() values each)
+    // with the same parameters
+    virtual void evaluateMany(const T *X, unsigned int nPoints, const T *p, T *out) const;
+
+public: // Linearity
+    // A model linear in its parameters, f(x, p) = sum_k row_k(x) p_k,
+    // declares it by overriding isLinear() and designRow()
+    virtual bool isLinear() const
+    {
+        return false;
+    }
+    virtual void designRow(const T *x, T *row) const;
+    // A model linear in some of its parameters only declares them here
+    virtual bool isLinearParameter(unsigned int k) const
+    {
+        return isLinear();
+    }
+
+public: // Derivatives
+    // A model with analytic derivatives with respect to its parameters,
+    // g_k = df/dp_k (x, p), declares it by overriding hasParameterGradient()
+    // and parameterGradient()
+    virtual bool hasParameterGradient() const
+    {
+        return false;
+    }
+    virtual void parameterGradient(const T *x, const T *p, T *g) const;
 
 private: // Utility functions
     void checkXdim(unsigned int xdim) const;
@@ -89,6 +118,180 @@ private: // Data
     function_type m_f;
 };
 
+// Parametrized function storing its callable F (T(const T *, const T *)) by
+// value. Type erasure only happens at the ParametrizedScalarFunction
+// interface: evaluateMany() calls the callable directly, so that it can be
+// inlined and vectorized in the loop over points.
+template<typename T, typename F>
+class ParametrizedLambdaFunction
+    : public ParametrizedScalarFunction<T>
+{
+public: // Typedefs
+    typedef F function_type;
+
+public: // Constructors/Destructor
+    ParametrizedLambdaFunction(const unsigned int xdim, const unsigned int npar, const F &f)
+        : ParametrizedScalarFunction<T>(xdim, npar)
+        , m_f(f)
+    {}
+    ParametrizedLambdaFunction(const unsigned int xdim, const unsigned int npar, F &&f)
+        : ParametrizedScalarFunction<T>(xdim, npar)
+        , m_f(std::move(f))
+    {}
+    virtual ~ParametrizedLambdaFunction() = default;
+
+public: // Queries
+    using ParametrizedScalarFunction<T>::xDim;
+    using ParametrizedScalarFunction<T>::yDim;
+    using ParametrizedScalarFunction<T>::nPar;
+    const F &function() const
+    {
+        return m_f;
+    }
+
+public: // Evaluator
+    virtual T operator()(const T *x, const T *p) const override
+    {
+        return m_f(x, p);
+    }
+    using ParametrizedScalarFunction<T>::operator();
+    virtual void evaluateMany(const T *X, unsigned int nPoints, const T *p, T *out) const override
+    {
+        const unsigned int xdim = xDim();
+        for (unsigned int k = 0; k < nPoints; ++k)
+        {
+            out[k] = m_f(X + k * xdim, p);
+        }
+    }
+
+private: // Data
+    F m_f;
+};
+
+template<typename T, typename F>
+ParametrizedLambdaFunction<T, typename std::decay<F>::type> MakeParametrizedLambdaFunction(
+    const unsigned int xdim,
+    const unsigned int npar,
+    F &&f)
+{
+    return ParametrizedLambdaFunction<T, typename std::decay<F>::type>(xdim, npar, std::forward<F>(f));
+}
+
+/******************************************************************************
+ *                       Vector Parametrized Function                         *
+ ******************************************************************************/
+
+// Parametrized function with yDim() components evaluated jointly, e.g. the
+// channels of a simultaneous fit sharing energies: subexpressions common to
+// several components are computed once per point.
+template<typename T>
+class ParametrizedVectorFunction
+{
+public: // Constructors/Destructor
+    explicit ParametrizedVectorFunction(const unsigned int xdim = 0,
+                                        const unsigned int ydim = 0,
+                                        const unsigned int npar = 0);
+    virtual ~ParametrizedVectorFunction() = default;
+
+protected: // Assignment
+    void setSize(const unsigned int xdim, const unsigned int ydim, const unsigned int npar);
+
+public: // Queries
+    virtual unsigned int xDim() const
+    {
+        return m_xDim;
+    }
+    virtual unsigned int yDim() const
+    {
+        return m_yDim;
+    }
+    virtual unsigned int nPar() const
+    {
+        return m_nPar;
+    }
+
+public: // Evaluator
+    // Sets the yDim() components y of f(x, p)
+    virtual void operator()(const T *x, const T *p, T *y) const = 0;
+    std::vector<T> operator()(const std::vector<T> &x, const std::vector<T> &p) const;
+    // Evaluates nPoints points stored contiguously in X (xDim() values each)
+    // with the same parameters. Component k of point i is stored in
+    // Y[k * ldY + i].
+    virtual void evaluateMany(const T *X, unsigned int nPoints, const T *p, T *Y, unsigned int ldY) const;
+
+public: // Linearity
+    // A model linear in its parameters, f_k(x, p) = sum_l A_kl(x) p_l,
+    // declares it by overriding isLinear() and designRows(), which sets the
+    // yDim() x nPar() row-major matrix A(x)
+    virtual bool isLinear() const
+    {
+        return false;
+    }
+    virtual void designRows(const T *x, T *A) const;
+
+private: // Utility functions
+    void checkXdim(unsigned int xdim) const;
+    void checkNpar(unsigned int n) const;
+
+private: // Data
+    unsigned int m_xDim;
+    unsigned int m_yDim;
+    unsigned int m_nPar;
+};
+
+// Vector parametrized function storing its callable F
+// (void(const T *x, const T *p, T *y)) by value
+template<typename T, typename F>
+class ParametrizedVectorLambdaFunction
+    : public ParametrizedVectorFunction<T>
+{
+public: // Typedefs
+    typedef F function_type;
+
+public: // Constructors/Destructor
+    ParametrizedVectorLambdaFunction(const unsigned int xdim, const unsigned int ydim,
+                                     const unsigned int npar, const F &f)
+        : ParametrizedVectorFunction<T>(xdim, ydim, npar)
+        , m_f(f)
+    {}
+    ParametrizedVectorLambdaFunction(const unsigned int xdim, const unsigned int ydim,
+                                     const unsigned int npar, F &&f)
+        : ParametrizedVectorFunction<T>(xdim, ydim, npar)
+        , m_f(std::move(f))
+    {}
+    virtual ~ParametrizedVectorLambdaFunction() = default;
+
+public: // Queries
+    using ParametrizedVectorFunction<T>::xDim;
+    using ParametrizedVectorFunction<T>::yDim;
+    using ParametrizedVectorFunction<T>::nPar;
+    const F &function() const
+    {
+        return m_f;
+    }
+
+public: // Evaluator
+    virtual void operator()(const T *x, const T *p, T *y) const override
+    {
+        m_f(x, p, y);
+    }
+    using ParametrizedVectorFunction<T>::operator();
+
+private: // Data
+    F m_f;
+};
+
+template<typename T, typename F>
+ParametrizedVectorLambdaFunction<T, typename std::decay<F>::type> MakeParametrizedVectorLambdaFunction(
+    const unsigned int xdim,
+    const unsigned int ydim,
+    const unsigned int npar,
+    F &&f)
+{
+    return ParametrizedVectorLambdaFunction<T, typename std::decay<F>::type>(xdim, ydim, npar, std::forward<F>(f));
+}
+
+
 
 /******************************************************************************
  *                     Bind parameters utility functions                      *
@@ -123,6 +326,122 @@ BEGIN_NAMESPACE(internal)
 
 END_NAMESPACE // internal
 
+// ScalarFunction x -> f(x, p) of a ParametrizedScalarFunction f with bound
+// parameters p, e.g. a fitted model passed to a Roots::RootFinder or plotted.
+// f is held as F: by reference by default, or by value (F the model type, see
+// bindParameters()). Up to MAXPAR parameters are stored inline, so
+// that binding and rebinding (setParameters(), e.g. once per sample) do not
+// allocate; larger models fall back to a heap buffer allocated on binding.
+// Evaluations never allocate.
+template<typename T, unsigned int MAXPAR = 16, typename F = const ParametrizedScalarFunction<T> &>
+class BoundParametrizedFunction
+    : public ScalarFunction<T>
+{
+public: // Constructors/Destructor
+    template<typename FF>
+    BoundParametrizedFunction(FF &&f, const T *p)
+        : ScalarFunction<T>(f.xDim())
+        , m_f(std::forward<FF>(f))
+    {
+        if (f.nPar() > MAXPAR)
+        {
+            m_pHeap.resize(f.nPar());
+        }
+        setParameters(p);
+    }
+    BoundParametrizedFunction(const BoundParametrizedFunction &other)
+        : ScalarFunction<T>(other.xDim())
+        , m_f(other.m_f)
+        , m_pHeap(other.m_pHeap)
+    {
+        setParameters(other.parameters());
+    }
+    virtual ~BoundParametrizedFunction() = default;
+
+public: // Assignment
+    void setParameters(const T *p)
+    {
+        std::copy(p, p + m_f.nPar(), m_pHeap.empty() ? m_pInline : m_pHeap.data());
+    }
+
+public: // Queries
+    using ScalarFunction<T>::xDim;
+    using ScalarFunction<T>::yDim;
+    unsigned int nPar() const
+    {
+        return m_f.nPar();
+    }
+    const T *parameters() const
+    {
+        return m_pHeap.empty() ? m_pInline : m_pHeap.data();
+    }
+    const ParametrizedScalarFunction<T> &function() const
+    {
+        return m_f;
+    }
+
+public: // Evaluators
+    virtual T operator()(const T *x) const override
+    {
+        return function()(x, parameters());
+    }
+    using ScalarFunction<T>::operator();
+    virtual void evaluateMany(const T *X, unsigned int nPoints, T *out) const override
+    {
+        function().evaluateMany(X, nPoints, parameters(), out);
+    }
+
+private: // Data
+    F m_f;
+    T m_pInline[MAXPAR];
+    std::vector<T> m_pHeap;
+};
+
+BEGIN_NAMESPACE(internal)
+
+// Model argument F (as deduced by a forwarding reference) held by reference
+// if it is an lvalue, and stored by value if it is a temporary
+template<typename T, typename F>
+using HeldParametrizedFunction = typename std::conditional <
+                                 std::is_lvalue_reference<F>::value,
+                                 const ParametrizedScalarFunction<T> &,
+                                 typename std::decay<F>::type >::type;
+
+template<typename T, typename F>
+using BoundFunction = typename std::enable_if <
+                      std::is_base_of<ParametrizedScalarFunction<T>, typename std::decay<F>::type>::value,
+                      BoundParametrizedFunction<T, 16, HeldParametrizedFunction<T, F>> >::type;
+
+END_NAMESPACE // internal
+
+// A model passed as a temporary is stored by value in the result, otherwise
+// it is held by reference and must outlive it
+template<typename F, typename T>
+internal::BoundFunction<T, F> bindParameters(F &&f, const T *p)
+{
+    return internal::BoundFunction<T, F>(std::forward<F>(f), p);
+}
+template<typename F, typename T>
+internal::BoundFunction<T, F> bindParameters(F &&f, const std::vector<T> &p)
+{
+    if (p.size() != f.nPar())
+    {
+        ERROR(SIZE, "wrong number of parameters bound (expected "
+              + utils::strFrom(f.nPar()) + ", got " + utils::strFrom(p.size()) + ")");
+    }
+    return internal::BoundFunction<T, F>(std::forward<F>(f), p.data());
+}
+template<typename F, typename T>
+internal::BoundFunction<T, F> bindParameters(F &&f, const Vector<T> &p)
+{
+    if (p.size() != f.nPar())
+    {
+        ERROR(SIZE, "wrong number of parameters bound (expected "
+              + utils::strFrom(f.nPar()) + ", got " + utils::strFrom(p.size()) + ")");
+    }
+    return internal::BoundFunction<T, F>(std::forward<F>(f), p.data());
+}
+
 /******************************************************************************
  *                         StaticParametrizedFunction                         *
  ******************************************************************************/
@@ -214,6 +533,32 @@ T ParametrizedScalarFunction<T>::operator()(const Vector<T> &x, const Vector<T>
     return (*this)(x.data(), p.data());
 }
 
+template<typename T>
+void ParametrizedScalarFunction<T>::evaluateMany(
+    const T *X,
+    unsigned int nPoints,
+    const T *p,
+    T *out) const
+{
+    const unsigned int xdim = xDim();
+    for (unsigned int k = 0; k < nPoints; ++k)
+    {
+        out[k] = (*this)(X + k * xdim, p);
+    }
+}
+
+template<typename T>
+void ParametrizedScalarFunction<T>::designRow(const T *x, T *row) const
+{
+    ERROR(IMPLEMENTATION, "model does not provide its design matrix row");
+}
+
+template<typename T>
+void ParametrizedScalarFunction<T>::parameterGradient(const T *x, const T *p, T *g) const
+{
+    ERROR(IMPLEMENTATION, "model does not provide its parameter gradient");
+}
+
 template<typename T>
 void ParametrizedScalarFunction<T>::checkXdim(unsigned int xdim) const
 {
@@ -269,6 +614,93 @@ T ParametrizedSFunction<T>::operator()(const T *x, const T *p) const
 {
     return m_f(x, p);
 }
+
+/******************************************************************************
+ *                   ParametrizedVectorFunction<T> definition                 *
+ ******************************************************************************/
+
+template<typename T>
+ParametrizedVectorFunction<T>::ParametrizedVectorFunction(
+    const unsigned int xdim,
+    const unsigned int ydim,
+    const unsigned int npar)
+{
+    setSize(xdim, ydim, npar);
+}
+
+template<typename T>
+void ParametrizedVectorFunction<T>::setSize(
+    const unsigned int xdim,
+    const unsigned int ydim,
+    const unsigned int npar)
+{
+    m_xDim = xdim;
+    m_yDim = ydim;
+    m_nPar = npar;
+}
+
+template<typename T>
+std::vector<T> ParametrizedVectorFunction<T>::operator()(const std::vector<T> &x, const std::vector<T> &p) const
+{
+    this->checkXdim(x.size());
+    this->checkNpar(p.size());
+    std::vector<T> y(yDim());
+    (*this)(x.data(), p.data(), y.data());
+    return y;
+}
+
+template<typename T>
+void ParametrizedVectorFunction<T>::evaluateMany(
+    const T *X,
+    unsigned int nPoints,
+    const T *p,
+    T *Y,
+    unsigned int ldY) const
+{
+    // the point buffer is kept by the thread across calls, it is taken out
+    // during the evaluation so that a model evaluating another vector model
+    // gets its own buffer
+    static thread_local std::vector<T> buffer;
+    const unsigned int xdim = xDim(), ydim = yDim();
+    std::vector<T> y;
+    y.swap(buffer);
+    y.resize(ydim);
+    for (unsigned int i = 0; i < nPoints; ++i)
+    {
+        (*this)(X + i * xdim, p, y.data());
+        for (unsigned int k = 0; k < ydim; ++k)
+        {
+            Y[k * ldY + i] = y[k];
+        }
+    }
+    buffer.swap(y);
+}
+
+template<typename T>
+void ParametrizedVectorFunction<T>::designRows(const T *x, T *A) const
+{
+    ERROR(IMPLEMENTATION, "model does not provide its design matrix rows");
+}
+
+template<typename T>
+void ParametrizedVectorFunction<T>::checkXdim(unsigned int xdim) const
+{
+    if (m_xDim && xdim != xDim())
+    {
+        ERROR(SIZE, "wrong number of arguments provided (expected "
+              + utils::strFrom(xDim()) + ", got " + utils::strFrom(xdim) + ")");
+    }
+}
+
+template<typename T>
+void ParametrizedVectorFunction<T>::checkNpar(unsigned int n) const
+{
+    if (n != m_nPar)
+    {
+        ERROR(SIZE, "wrong number of parameters provided (expected "
+              + utils::strFrom(m_nPar) + ", got " + utils::strFrom(n) + ")");
+    }
+}
 // template<typename T>
 // template<typename... Ts>
 // T ParametrizedScalarFunction<T>::operator()(const Ts...a) const
@@ -0,0 +1,411 @@
+/*
+ * Quadrature.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef QUADRATURE_HPP
+#define QUADRATURE_HPP
+
+#include <cmath>
+#include <exception>
+#include <limits>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gsl/gsl_errno.h>
+#include <gsl/gsl_integration.h>
+
+#include "Globals.hpp"
+#include "Exceptions.hpp"
+#include "Function.hpp"
+#include "GSLUtils.hpp"
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+BEGIN_NAMESPACE(LQCDA)
+
+/******************************************************************************
+ *                                  Integral                                  *
+ ******************************************************************************/
+
+template<typename T>
+class Integral
+{
+private:
+    // Integral value and error estimate
+    T _v, _e;
+
+public:
+    Integral(T v = T(), T e = T())
+        : _v {v}
+        , _e {e}
+    {}
+
+    T value() const
+    {
+        return _v;
+    }
+    T error() const
+    {
+        return _e;
+    }
+};
+
+/******************************************************************************
+ *                                 Quadrature                                 *
+ ******************************************************************************/
+
+// Integration of xDim=1 functions over [a, b], with the algorithms
+//     Adaptive      : GSL QAG with a Gauss-Kronrod rule of options.key, or
+//                     QAGI/QAGIU/QAGIL if a and/or b are infinite,
+//     GaussLegendre : fixed order Gauss-Legendre rule, for smooth integrands
+//                     on finite intervals. The integrand is evaluated at
+//                     all the nodes through evaluateMany(), and no error
+//                     estimate is given (error() is 0).
+// The GSL workspace and the node buffers are allocated once and reused, so
+// a Quadrature is not thread-safe: integrateMany() integrates a family of
+// functions (e.g. a fitted curve bound to the parameters of each bootstrap
+// sample) across threads, each one with its own workspace.
+template<typename T>
+class Quadrature
+{
+public:
+    // Algorithms
+    enum class Algorithm
+    {
+        Adaptive, GaussLegendre
+    };
+
+    // Options
+    struct Options
+    {
+        // absolute and relative target errors (Adaptive)
+        double epsabs;
+        double epsrel;
+        // maximum number of subintervals (Adaptive)
+        unsigned int limit;
+        // Gauss-Kronrod rule, GSL_INTEG_GAUSS15 to GSL_INTEG_GAUSS61 (QAG)
+        int key;
+        // split integrateMany() across threads
+        bool parallel;
+
+        Options()
+            : epsabs {0.}
+            , epsrel {1.e-8}
+            , limit {1000}
+            , key {GSL_INTEG_GAUSS21}
+            , parallel {true}
+        {}
+    };
+
+    Options options;
+
+private:
+    // Per-thread buffers, the GSL workspace is (re)allocated on first use
+    // or when options.limit grows
+    struct Workspace
+    {
+        std::unique_ptr<gsl_integration_workspace, decltype(&gsl_integration_workspace_free)> gsl {nullptr, gsl_integration_workspace_free};
+        unsigned int limit {0};
+        std::vector<T> x;
+        std::vector<T> y;
+    };
+
+    // Data
+    Algorithm _Algorithm;
+    // Gauss-Legendre nodes and weights on [-1, 1]
+    std::vector<T> _Nodes;
+    std::vector<T> _Weights;
+    Workspace _Workspace;
+
+public:
+    // Constructors/Destructor
+    explicit Quadrature(Algorithm algorithm = Algorithm::Adaptive, unsigned int order = 20);
+    // with its own workspace
+    Quadrature(const Quadrature &other);
+    ~Quadrature() = default;
+
+    // Queries
+    Algorithm algorithm() const
+    {
+        return _Algorithm;
+    }
+    unsigned int order() const
+    {
+        return _Nodes.size();
+    }
+
+    // Integration
+    Integral<T> integrate(const ScalarFunction<T> &f, T a, T b);
+    std::vector<Integral<T>> integrateMany(
+        const std::vector<const ScalarFunction<T> *> &f,
+        T a, T b);
+
+private:
+    void computeNodes(unsigned int order);
+    Integral<T> integrate_h(const ScalarFunction<T> &f, T a, T b, Workspace &ws) const;
+    Integral<T> integrateAdaptive(const ScalarFunction<T> &f, T a, T b, Workspace &ws) const;
+    Integral<T> integrateGaussLegendre(const ScalarFunction<T> &f, T a, T b, Workspace &ws) const;
+};
+
+template<typename T>
+Quadrature<T>::Quadrature(Algorithm algorithm, unsigned int order)
+    : _Algorithm(algorithm)
+{
+    if (_Algorithm == Algorithm::GaussLegendre)
+    {
+        if (order == 0)
+        {
+            ERROR(LOGIC, "Gauss-Legendre quadrature needs a strictly positive order");
+        }
+        computeNodes(order);
+    }
+    _Workspace.x.resize(_Nodes.size());
+    _Workspace.y.resize(_Nodes.size());
+}
+
+template<typename T>
+Quadrature<T>::Quadrature(const Quadrature &other)
+    : options(other.options)
+    , _Algorithm(other._Algorithm)
+    , _Nodes(other._Nodes)
+    , _Weights(other._Weights)
+{
+    _Workspace.x.resize(_Nodes.size());
+    _Workspace.y.resize(_Nodes.size());
+}
+
+template<typename T>
+Integral<T> Quadrature<T>::integrate(const ScalarFunction<T> &f, T a, T b)
+{
+    if (f.xDim() != 1)
+    {
+        ERROR(SIZE, "quadrature only accepts xDim=1 functions");
+    }
+    return integrate_h(f, a, b, _Workspace);
+}
+
+template<typename T>
+std::vector<Integral<T>> Quadrature<T>::integrateMany(
+    const std::vector<const ScalarFunction<T> *> &f,
+    T a, T b)
+{
+    for (auto fi : f)
+    {
+        if (!fi)
+        {
+            ERROR(NULLPTR, "null function in quadrature batch");
+        }
+        if (fi->xDim() != 1)
+        {
+            ERROR(SIZE, "quadrature only accepts xDim=1 functions");
+        }
+    }
+
+    const int n = f.size();
+    std::vector<Integral<T>> integrals(n);
+#ifdef _OPENMP
+    bool par = options.parallel && n > 1 && !omp_in_parallel();
+#endif
+    std::exception_ptr error;
+    #pragma omp parallel if(par)
+    {
+        // one workspace per thread
+        std::unique_ptr<Workspace> local;
+#ifdef _OPENMP
+        if (par)
+        {
+            local.reset(new Workspace);
+            local->x.resize(_Nodes.size());
+            local->y.resize(_Nodes.size());
+        }
+#endif
+        Workspace &ws = local ? *local : _Workspace;
+        #pragma omp for schedule(dynamic)
+        for (int i = 0; i < n; ++i)
+        {
+            try
+            {
+                integrals[i] = integrate_h(*f[i], a, b, ws);
+            }
+            catch (...)
+            {
+                #pragma omp critical
+                if (!error)
+                {
+                    error = std::current_exception();
+                }
+            }
+        }
+    }
+    if (error)
+    {
+        std::rethrow_exception(error);
+    }
+    return integrals;
+}
+
+// Roots of the Legendre polynomial P_n by Newton's method, from the
+// asymptotic guesses cos(pi (i + 3/4) / (n + 1/2)), and weights
+// 2 / ((1 - x^2) P'_n(x)^2)
+template<typename T>
+void Quadrature<T>::computeNodes(unsigned int order)
+{
+    const unsigned int n = order;
+    _Nodes.resize(n);
+    _Weights.resize(n);
+    for (unsigned int i = 0; i < (n + 1) / 2; ++i)
+    {
+        double x = std::cos(M_PI * (i + 0.75) / (n + 0.5));
+        double dp = 0.;
+        for (unsigned int iter = 0; iter < 100; ++iter)
+        {
+            // P_n(x) and P'_n(x) from the recurrence
+            double p0 = 1., p1 = 0.;
+            for (unsigned int k = 1; k <= n; ++k)
+            {
+                double p2 = p1;
+                p1 = p0;
+                p0 = ((2. * k - 1.) * x * p1 - (k - 1.) * p2) / k;
+            }
+            dp = n * (x * p0 - p1) / (x * x - 1.);
+            double dx = p0 / dp;
+            x -= dx;
+            if (std::abs(dx) < 1.e-15)
+            {
+                break;
+            }
+        }
+        double w = 2. / ((1. - x * x) * dp * dp);
+        _Nodes[i] = -x;
+        _Nodes[n - 1 - i] = x;
+        _Weights[i] = w;
+        _Weights[n - 1 - i] = w;
+    }
+}
+
+template<typename T>
+Integral<T> Quadrature<T>::integrate_h(const ScalarFunction<T> &f, T a, T b, Workspace &ws) const
+{
+    switch (_Algorithm)
+    {
+    case Algorithm::Adaptive:
+        return integrateAdaptive(f, a, b, ws);
+    case Algorithm::GaussLegendre:
+        return integrateGaussLegendre(f, a, b, ws);
+    }
+    ERROR(IMPLEMENTATION, "unknown quadrature algorithm");
+}
+
+template<typename T>
+Integral<T> Quadrature<T>::integrateAdaptive(const ScalarFunction<T> &f, T a, T b, Workspace &ws) const
+{
+    if (!ws.gsl || ws.limit < options.limit)
+    {
+        ws.gsl.reset(gsl_integration_workspace_alloc(options.limit));
+        if (!ws.gsl)
+        {
+            ERROR(MEMORY, "GSL integration workspace allocation failed");
+        }
+        ws.limit = options.limit;
+    }
+
+    // An exception thrown by f cannot cross GSL: it is stored, GSL gets NaNs
+    // without further evaluations of f, and the exception is rethrown once
+    // GSL returns
+    struct Params
+    {
+        const ScalarFunction<T> *f;
+        std::exception_ptr error;
+    } params {&f, nullptr};
+    gsl_function fun;
+    fun.function = [](double x, void *p)->double
+    {
+        Params *params = static_cast<Params *>(p);
+        if (!params->error)
+        {
+            try
+            {
+                T xt = x;
+                return (*params->f)(&xt);
+            }
+            catch (...)
+            {
+                params->error = std::current_exception();
+            }
+        }
+        return std::numeric_limits<double>::quiet_NaN();
+    };
+    fun.params = &params;
+
+    double result = 0., abserr = 0.;
+    int status;
+    // GSL errors are returned as statuses rather than aborting
+    GSLErrorGuard guard;
+    bool ainf = std::isinf(a), binf = std::isinf(b);
+    if (ainf && binf && a < 0 && b > 0)
+    {
+        status = gsl_integration_qagi(&fun, options.epsabs, options.epsrel, options.limit,
+                                      ws.gsl.get(), &result, &abserr);
+    }
+    else if (binf && !ainf && b > 0)
+    {
+        status = gsl_integration_qagiu(&fun, a, options.epsabs, options.epsrel, options.limit,
+                                       ws.gsl.get(), &result, &abserr);
+    }
+    else if (ainf && !binf && a < 0)
+    {
+        status = gsl_integration_qagil(&fun, b, options.epsabs, options.epsrel, options.limit,
+                                       ws.gsl.get(), &result, &abserr);
+    }
+    else if (!ainf && !binf)
+    {
+        status = gsl_integration_qag(&fun, a, b, options.epsabs, options.epsrel, options.limit,
+                                     options.key, ws.gsl.get(), &result, &abserr);
+    }
+    else
+    {
+        ERROR(LOGIC, "invalid integration interval [" + utils::strFrom(a) + ", "
+              + utils::strFrom(b) + "]");
+    }
+    if (params.error)
+    {
+        std::rethrow_exception(params.error);
+    }
+    if (status != GSL_SUCCESS)
+    {
+        ERROR(RUNTIME, std::string("quadrature failed: ") + gsl_strerror(status));
+    }
+    return Integral<T>(result, abserr);
+}
+
+template<typename T>
+Integral<T> Quadrature<T>::integrateGaussLegendre(const ScalarFunction<T> &f, T a, T b, Workspace &ws) const
+{
+    if (!std::isfinite(a) || !std::isfinite(b))
+    {
+        ERROR(LOGIC, "Gauss-Legendre quadrature needs a finite interval");
+    }
+    const unsigned int n = _Nodes.size();
+    T c = (b + a) / 2, h = (b - a) / 2;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        ws.x[i] = c + h * _Nodes[i];
+    }
+    f.evaluateMany(ws.x.data(), n, ws.y.data());
+    T s = 0;
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        s += _Weights[i] * ws.y[i];
+    }
+    return Integral<T>(h * s, 0);
+}
+
+END_NAMESPACE // LQCDA
+
+#endif // QUADRATURE_HPP
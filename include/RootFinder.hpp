@@ -8,10 +8,19 @@
 #ifndef ROOT_FINDER_HPP
 #define ROOT_FINDER_HPP
 
+ #include <algorithm>
+ #include <exception>
+ #include <memory>
+ #include <vector>
+
  #include "Globals.hpp"
  #include "Exceptions.hpp"
  #include "Function.hpp"
 
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
  BEGIN_NAMESPACE(LQCDA)
  BEGIN_NAMESPACE(Roots)
 
@@ -21,34 +30,83 @@
  private:
  	// Root value and error
  	T _r, _e;
+ 	// false if the solver stopped on options.max_iter before reaching the
+ 	// requested precision
+ 	bool _Converged;
 
  public:
- 	Root(T r, T e)
+ 	Root(T r = T(), T e = T(), bool converged = true)
  	: _r{r}
  	, _e{e}
+ 	, _Converged{converged}
  	{}
 
  	T value() const { return _r; }
  	T error() const { return _e; }
+ 	bool converged() const { return _Converged; }
  };
- 
+
  template<typename T>
  class RootFinder
  {
+ public:
+ 	// Options
+ 	struct Options
+ 	{
+ 		// maximum number of iterations of a solve, a root reached on this
+ 		// limit is flagged as not converged
+ 		unsigned int max_iter;
+ 		// initial half-width of the brackets around the central root in
+ 		// solveMany(), relative to xmax - xmin
+ 		double bracket_width;
+ 		// split solveMany() across threads
+ 		bool parallel;
+
+ 		Options()
+ 		: max_iter{100}
+ 		, bracket_width{0.05}
+ 		, parallel{true}
+ 		{}
+ 	};
+
+ 	Options options;
+
  public:
  	// Constructors/Destructor
  	RootFinder() = default;
  	virtual ~RootFinder() =0;
 
  	Root<T> solve(const ScalarFunction<T>& f, T xmin, T xmax, double epsrel =1.e-4);
+ 	// Solves a family of functions, e.g. a fitted curve bound to the
+ 	// parameters of each bootstrap sample (see bindParameters). If a central
+ 	// function is given, its root is found first and each function is
+ 	// solved in a bracket around it, widened until it contains a sign
+ 	// change. The solves are split across threads, each one with its own
+ 	// copy of the finder (see clone()). A failed solve throws, a root
+ 	// reached on options.max_iter is returned with converged() false.
+ 	std::vector<Root<T>> solveMany(
+ 		const std::vector<const ScalarFunction<T>*>& f,
+ 		T xmin, T xmax,
+ 		double epsrel =1.e-4,
+ 		const ScalarFunction<T>* central =nullptr);
+
+ 	// Copy with an independent solver state, needed by a parallel solveMany()
+ 	virtual std::unique_ptr<RootFinder<T>> clone() const;
 
  private:
  	virtual Root<T> solve_h(const ScalarFunction<T>& f, T xmin, T xmax, double epsrel) =0;
+ 	bool bracket(const ScalarFunction<T>& f, T r0, T xmin, T xmax, T& lo, T& hi) const;
  };
 
  template<typename T>
  RootFinder<T>::~RootFinder<T>() {}
 
+ template<typename T>
+ std::unique_ptr<RootFinder<T>> RootFinder<T>::clone() const
+ {
+ 	ERROR(IMPLEMENTATION, "root finder cannot be copied");
+ }
+
  template<typename T>
  Root<T> RootFinder<T>::solve(const ScalarFunction<T>& f, T xmin, T xmax, double epsrel)
  {
@@ -59,8 +117,103 @@
  	return solve_h(f, xmin, xmax, epsrel);
  }
 
+ template<typename T>
+ std::vector<Root<T>> RootFinder<T>::solveMany(
+ 	const std::vector<const ScalarFunction<T>*>& f,
+ 	T xmin, T xmax,
+ 	double epsrel,
+ 	const ScalarFunction<T>* central)
+ {
+ 	for(auto fi: f)
+ 	{
+ 		if(!fi)
+ 		{
+ 			ERROR(NULLPTR, "null function in root finding batch");
+ 		}
+ 		if(fi->xDim() != 1)
+ 		{
+ 			ERROR(SIZE, "root finding only accepts xDim=1 functions");
+ 		}
+ 	}
+ 	bool narrow = central != nullptr;
+ 	if(narrow && !(options.bracket_width > 0))
+ 	{
+ 		ERROR(LOGIC, "root finding bracket width must be positive");
+ 	}
+ 	T r0 = narrow ? solve(*central, xmin, xmax, epsrel).value() : T();
+
+ 	const int n = f.size();
+ 	std::vector<Root<T>> roots(n);
+#ifdef _OPENMP
+ 	bool par = options.parallel && n > 1 && !omp_in_parallel();
+#endif
+ 	std::exception_ptr error;
+ 	#pragma omp parallel if(par)
+ 	{
+ 		// one solver per thread
+ 		std::unique_ptr<RootFinder<T>> local;
+#ifdef _OPENMP
+ 		if(par)
+ 		{
+ 			local = clone();
+ 		}
+#endif
+ 		RootFinder<T>& finder = local ? *local : *this;
+ 		#pragma omp for schedule(dynamic)
+ 		for(int i = 0; i < n; ++i)
+ 		{
+ 			try
+ 			{
+ 				T lo = xmin, hi = xmax;
+ 				if(narrow && !bracket(*f[i], r0, xmin, xmax, lo, hi))
+ 				{
+ 					ERROR(RUNTIME, "no sign change of function " + utils::strFrom(i)
+ 						+ " in [" + utils::strFrom(xmin) + ", " + utils::strFrom(xmax) + "]");
+ 				}
+ 				roots[i] = finder.solve_h(*f[i], lo, hi, epsrel);
+ 			}
+ 			catch(...)
+ 			{
+ 				#pragma omp critical
+ 				if(!error)
+ 				{
+ 					error = std::current_exception();
+ 				}
+ 			}
+ 		}
+ 	}
+ 	if(error)
+ 	{
+ 		std::rethrow_exception(error);
+ 	}
+ 	return roots;
+ }
+
+ // Widens [r0 - w, r0 + w] by factors of 4 until f changes sign, or the
+ // bracket reaches [xmin, xmax]
+ template<typename T>
+ bool RootFinder<T>::bracket(const ScalarFunction<T>& f, T r0, T xmin, T xmax, T& lo, T& hi) const
+ {
+ 	T w = options.bracket_width * (xmax - xmin);
+ 	while(true)
+ 	{
+ 		lo = std::max(xmin, r0 - w);
+ 		hi = std::min(xmax, r0 + w);
+ 		T flo = f(&lo), fhi = f(&hi);
+ 		if((flo <= 0 && fhi >= 0) || (flo >= 0 && fhi <= 0))
+ 		{
+ 			return true;
+ 		}
+ 		if(lo == xmin && hi == xmax)
+ 		{
+ 			return false;
+ 		}
+ 		w *= 4;
+ 	}
+ }
+
 
  END_NAMESPACE
  END_NAMESPACE
 
-#endif // ROOT_FINDER_HPP
\ No newline at end of file
+#endif // ROOT_FINDER_HPP
@@ -0,0 +1,365 @@
+/*
+ * StaticFit.hpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#ifndef STATIC_FIT_HPP
+#define STATIC_FIT_HPP
+
+#include <vector>
+
+#include "Globals.hpp"
+#include "Exceptions.hpp"
+#include "Function.hpp"
+#include "StaticParametrizedFunction.hpp"
+#include "XYDataInterface.hpp"
+#include "FitInterface.hpp"
+#include "ScalarConstraint.hpp"
+#include "LBFGSMinimizer.hpp"
+
+#include <Eigen/Cholesky>
+
+BEGIN_NAMESPACE(LQCDA)
+
+/******************************************************************************
+ *                         StaticChi2CostFunction                             *
+ ******************************************************************************/
+
+// Chi2 of a single y-dimension data set with exact x, for a model whose
+// dimensions are known at compile time (see StaticParametrizedFunction).
+// Parameters, x and residual buffers are fixed-size Eigen objects when the
+// number of points NPTS is also fixed. With a dynamic number of points, the
+// residuals of correlated data use a buffer kept by the thread across calls,
+// so that an evaluation performs no heap allocation in either case. Uncorrelated data are whitened by their errors, correlated data
+// by the Cholesky factor of their covariance, computed once in setData().
+// The function only reads its data during an evaluation, and can be evaluated
+// concurrently.
+template<typename MODEL, int NPTS = Dynamic>
+class StaticChi2CostFunction
+    : public ScalarFunction<typename MODEL::Scalar>
+{
+public:
+    // Typedefs
+    typedef typename MODEL::Scalar Scalar;
+    static constexpr unsigned int XDim = MODEL::XDim;
+    static constexpr unsigned int NPar = MODEL::NPar;
+    typedef Vector<Scalar, NPar> ParType;
+    typedef Matrix<Scalar, XDim, NPTS> XDataType;
+    typedef Vector<Scalar, NPTS> YDataType;
+    typedef Matrix<Scalar, NPTS, NPTS> CovType;
+
+private:
+    const MODEL &_Model;
+    XDataType _X;
+    YDataType _Y;
+    // lower Cholesky factor of the covariance, errors on the diagonal if
+    // the data are uncorrelated
+    CovType _Chol;
+    bool _isCorrelated {false};
+
+public:
+    // Constructors
+    explicit StaticChi2CostFunction(const MODEL &model)
+        : ScalarFunction<Scalar>(NPar)
+        , _Model(model)
+    {}
+    // Destructor
+    virtual ~StaticChi2CostFunction() noexcept = default;
+
+    // Data
+    void setData(const XDataType &x, const YDataType &y, const YDataType &yErr);
+    void setData(const XDataType &x, const YDataType &y, const CovType &yCov);
+    void setData(const XYDataInterface<Scalar> &data, const FitInterface &fit);
+    // Replaces the y values only (e.g. resampled data)
+    void setY(const YDataType &y);
+
+    // Accessors
+    unsigned int nPoints() const
+    {
+        return _Y.size();
+    }
+    unsigned int nDOF() const
+    {
+        return nPoints() - NPar;
+    }
+
+public:
+    virtual Scalar operator()(const Scalar *p) const override
+    {
+        return evaluate(ConstMap<ParType>(p));
+    }
+    using ScalarFunction<Scalar>::operator();
+    Scalar evaluate(const ParType &p) const;
+
+private:
+    void checkData() const;
+};
+
+template<typename MODEL, int NPTS>
+void StaticChi2CostFunction<MODEL, NPTS>::setData(
+    const XDataType &x,
+    const YDataType &y,
+    const YDataType &yErr)
+{
+    _X = x;
+    _Y = y;
+    _Chol.setZero(y.size(), y.size());
+    _Chol.diagonal() = yErr;
+    _isCorrelated = false;
+    checkData();
+}
+
+template<typename MODEL, int NPTS>
+void StaticChi2CostFunction<MODEL, NPTS>::setData(
+    const XDataType &x,
+    const YDataType &y,
+    const CovType &yCov)
+{
+    _X = x;
+    _Y = y;
+    if (yCov.rows() != y.size() || yCov.cols() != y.size())
+    {
+        ERROR(SIZE, "data covariance matrix size mismatch (expected "
+              + utils::strFrom(y.size()) + ")");
+    }
+    Eigen::LLT<CovType> llt(yCov);
+    if (llt.info() != Eigen::Success)
+    {
+        ERROR(RUNTIME, "covariance matrix of the fitted data is not positive definite");
+    }
+    _Chol = llt.matrixL();
+    _isCorrelated = true;
+    checkData();
+}
+
+// Copies the fitted points of a single y-dimension data set, x must be exact
+template<typename MODEL, int NPTS>
+void StaticChi2CostFunction<MODEL, NPTS>::setData(
+    const XYDataInterface<Scalar> &data,
+    const FitInterface &fit)
+{
+    if (data.xDim() != XDim || data.yDim() != 1)
+    {
+        ERROR(SIZE, "static fit data must have x-dimension " + utils::strFrom(XDim)
+              + " and y-dimension 1");
+    }
+    if (fit.nFitXDim() != 0)
+    {
+        ERROR(LOGIC, "static fits do not support fitted x");
+    }
+    index_t nFitPoints = fit.nFitPoints();
+    if (NPTS != Dynamic && nFitPoints != NPTS)
+    {
+        ERROR(SIZE, "wrong number of fitted points (expected "
+              + utils::strFrom(NPTS) + ", got " + utils::strFrom(nFitPoints) + ")");
+    }
+
+    std::vector<index_t> ind;
+    for (index_t i = 0; i < data.nPoints(); ++i)
+    {
+        if (fit.isFitPoint(i))
+        {
+            ind.push_back(i);
+        }
+    }
+    XDataType x(XDim, nFitPoints);
+    YDataType y(nFitPoints);
+    CovType c = CovType::Zero(nFitPoints, nFitPoints);
+    auto cov = data.yyCov(0, 0);
+    for (index_t i1 = 0; i1 < nFitPoints; ++i1)
+    {
+        for (index_t k = 0; k < XDim; ++k)
+        {
+            x(k, i1) = data.x(ind[i1], k);
+        }
+        y(i1) = data.y(ind[i1], 0);
+        for (index_t i2 = 0; i2 < nFitPoints; ++i2)
+        {
+            if (fit.isDataCorrelated(ind[i1], ind[i2]))
+            {
+                c(i1, i2) = cov(ind[i1], ind[i2]);
+            }
+        }
+    }
+    if (c.isDiagonal())
+    {
+        setData(x, y, YDataType(c.diagonal().cwiseSqrt()));
+    }
+    else
+    {
+        setData(x, y, c);
+    }
+}
+
+template<typename MODEL, int NPTS>
+void StaticChi2CostFunction<MODEL, NPTS>::setY(const YDataType &y)
+{
+    if (y.size() != _Y.size())
+    {
+        ERROR(SIZE, "wrong number of y values (expected "
+              + utils::strFrom(_Y.size()) + ", got " + utils::strFrom(y.size()) + ")");
+    }
+    _Y = y;
+}
+
+template<typename MODEL, int NPTS>
+void StaticChi2CostFunction<MODEL, NPTS>::checkData() const
+{
+    if (_X.cols() != _Y.size())
+    {
+        ERROR(SIZE, "x/y number of points mismatch");
+    }
+    if (_Y.size() < NPar)
+    {
+        ERROR(SIZE, "less data points than parameters");
+    }
+}
+
+template<typename MODEL, int NPTS>
+typename StaticChi2CostFunction<MODEL, NPTS>::Scalar StaticChi2CostFunction<MODEL, NPTS>::evaluate(
+    const ParType &p) const
+{
+    const index_t n = _Y.size();
+    if (!_isCorrelated)
+    {
+        Scalar chi2 {0};
+        for (index_t i = 0; i < n; ++i)
+        {
+            Scalar r = (_Y(i) - _Model.eval(_X.col(i).data(), p.data())) / _Chol(i, i);
+            chi2 += r * r;
+        }
+        return chi2;
+    }
+
+    // the buffer is taken out during the evaluation, so that a model
+    // evaluating another cost function gets its own buffer
+    static thread_local YDataType buffer;
+    YDataType r;
+    if (NPTS == Dynamic)
+    {
+        r.swap(buffer);
+    }
+    r.resize(n);
+    for (index_t i = 0; i < n; ++i)
+    {
+        r(i) = _Y(i) - _Model.eval(_X.col(i).data(), p.data());
+    }
+    _Chol.template triangularView<Eigen::Lower>().solveInPlace(r);
+    Scalar chi2 = r.squaredNorm();
+    if (NPTS == Dynamic)
+    {
+        buffer.swap(r);
+    }
+    return chi2;
+}
+
+/******************************************************************************
+ *                               StaticFit                                    *
+ ******************************************************************************/
+
+// Fixed-size counterpart of Chi2Fit, for small fits repeated many times (e.g.
+// over resampled data). The chi2 is minimized by the fixed-size L-BFGS solver
+// (LBFGSMinimizer<T, NPar>::solve), so that neither the minimization nor the
+// result use dynamic memory. A StaticFit is cheap to copy: concurrent fits of
+// different data sets should use one copy per thread.
+template<typename MODEL, int NPTS = Dynamic>
+class StaticFit
+{
+public:
+    // Typedefs
+    typedef StaticChi2CostFunction<MODEL, NPTS> CostType;
+    typedef typename CostType::Scalar Scalar;
+    static constexpr unsigned int NPar = CostType::NPar;
+    typedef typename CostType::ParType ParType;
+    typedef Matrix<Scalar, NPar, NPar> ParCovType;
+    typedef MIN::LBFGSMinimizer<Scalar, NPar> MinimizerType;
+
+    // Result
+    struct Result
+    {
+        ParType p;
+        ParCovType cov;
+        Scalar chi2;
+        unsigned int n_dof;
+        unsigned int n_iter;
+        bool is_valid;
+
+        Scalar chi2PerDof() const
+        {
+            return n_dof ? chi2 / n_dof : chi2;
+        }
+    };
+
+private:
+    CostType _Cost;
+    typename MinimizerType::OptionsType _Opts;
+    typename MinimizerType::Box _Box;
+
+public:
+    // Constructors
+    explicit StaticFit(const MODEL &model)
+        : _Cost(model)
+    {
+        setConstraints({});
+    }
+    // Destructor
+    ~StaticFit() = default;
+
+    // Data
+    template<typename... Args>
+    void setData(Args &&... args)
+    {
+        _Cost.setData(std::forward<Args>(args)...);
+    }
+    void setY(const typename CostType::YDataType &y)
+    {
+        _Cost.setY(y);
+    }
+    // Parameter constraints
+    void setConstraints(const std::vector<ScalarConstraint<Scalar>> &c)
+    {
+        _Box = MinimizerType::makeBox(c, NPar);
+    }
+
+    // Accessors
+    const CostType &costFunction() const
+    {
+        return _Cost;
+    }
+    typename MinimizerType::OptionsType &minimizerOptions()
+    {
+        return _Opts;
+    }
+
+    // Fit
+    Result fit(const ParType &p0, const ParType &e0) const;
+    Result fit(const ParType &p0) const
+    {
+        return fit(p0, ParType::Constant(0.1));
+    }
+};
+
+template<typename MODEL, int NPTS>
+typename StaticFit<MODEL, NPTS>::Result StaticFit<MODEL, NPTS>::fit(
+    const ParType &p0,
+    const ParType &e0) const
+{
+    Result result;
+    result.p = p0;
+    auto status = MinimizerType(_Opts).solve(_Cost, result.p, e0, _Box, result.cov);
+    if (!_Opts.compute_errors)
+    {
+        result.cov.setZero();
+    }
+    result.chi2 = status.fval;
+    result.n_dof = _Cost.nDOF();
+    result.n_iter = status.n_iter;
+    result.is_valid = status.converged && status.hessian_ok;
+    return result;
+}
+
+END_NAMESPACE // LQCDA
+
+#endif // STATIC_FIT_HPP
@@ -8,34 +8,106 @@
 #ifndef STATIC_PARAMETRIZED_FUNCTION_HPP
 #define STATIC_PARAMETRIZED_FUNCTION_HPP
 
- #include "StaticFunction.hpp"
- #include "ParametrizedFunction.hpp"
- #include "TypeTraits.hpp"
- #include "MetaProgUtils.hpp"
-
-namespace LQCDA {
-
-	template<typename XT, typename YT, typename... ARGS>
- 	class StaticParametrizedFunction: public ParametrizedFunction<XT, YT, sizeof...(ARGS)>
- 	{
- 	private:
-        INHERIT_FUNCTION_TYPEDEFS;
-
- 		y_type (*_Fcn)(x_arg_type, ARGS...);
-
- 	public:
- 		StaticParametrizedFunction(y_type (*f)(x_arg_type, ARGS...)) : _Fcn(f)
- 		{
- 			static_assert(are_floating_points<ARGS...>::value, 
- 				"The parameters of the function must be floating-point.");
- 		}
-
- 	protected:
- 		virtual y_type eval(x_arg_type x, const std::array<double, sizeof...(ARGS)>& p) {
- 			return apply_(index_bind<1>(_Fcn, x), p);
- 		}
- 	};
+#include <functional>
 
+#include "Globals.hpp"
+#include "ParametrizedFunction.hpp"
+#include "TypeTraits.hpp"
+#include "MetaProgUtils.hpp"
+
+BEGIN_NAMESPACE(LQCDA)
+
+/******************************************************************************
+ *                         StaticParametrizedFunction                         *
+ ******************************************************************************/
+
+// Parametrized function with dimensions known at compile time, built from a
+// callable T(x_1, ..., x_XDIM, p_1, ..., p_NPAR). The argument list is
+// expanded with METAPROG::int_seq, so that an evaluation involves neither
+// loops nor temporary buffers. The callable is stored as an F, by default a
+// std::function: with the callable type itself (see
+// MakeStaticParametrizedFunction), evaluations can be inlined.
+template<unsigned int XDIM, typename SIG, typename F = std::function<SIG>>
+class StaticParametrizedFunction;
+
+template<unsigned int XDIM, typename T, typename... ARGS, typename F>
+class StaticParametrizedFunction<XDIM, T(ARGS...), F>
+    : public ParametrizedScalarFunction<T>
+{
+    static_assert(are_assignable<T &, ARGS...>::value,
+                  "StaticParametrizedFunction arguments must be compatible with return type T");
+    static_assert(sizeof...(ARGS) >= XDIM,
+                  "StaticParametrizedFunction has less arguments than its x-dimension");
+
+public: // Typedefs
+    typedef T Scalar;
+    static constexpr unsigned int XDim = XDIM;
+    static constexpr unsigned int NPar = sizeof...(ARGS) - XDIM;
+    typedef Vector<T, XDim> XType;
+    typedef Vector<T, NPar> ParType;
+    typedef F function_type;
+
+public: // Constructors/Destructor
+    StaticParametrizedFunction(const function_type &f)
+        : ParametrizedScalarFunction<T>(XDim, NPar)
+        , m_f(f)
+    {}
+    StaticParametrizedFunction(function_type &&f)
+        : ParametrizedScalarFunction<T>(XDim, NPar)
+        , m_f(std::forward<function_type>(f))
+    {}
+    virtual ~StaticParametrizedFunction() = default;
+
+public: // Queries
+    using ParametrizedScalarFunction<T>::xDim;
+    using ParametrizedScalarFunction<T>::yDim;
+    using ParametrizedScalarFunction<T>::nPar;
+
+public: // Evaluators
+    virtual T operator()(const T *x, const T *p) const override
+    {
+        return eval(x, p);
+    }
+    using ParametrizedScalarFunction<T>::operator();
+    virtual void evaluateMany(const T *X, unsigned int nPoints, const T *p, T *out) const override
+    {
+        for (unsigned int k = 0; k < nPoints; ++k)
+        {
+            out[k] = eval(X + k * XDim, p);
+        }
+    }
+    // Non virtual evaluators, for fixed-size fits
+    T eval(const T *x, const T *p) const
+    {
+        return call_f(x, p, typename METAPROG::make_int_seq<0, sizeof...(ARGS)>::type());
+    }
+    T eval(const XType &x, const ParType &p) const
+    {
+        return eval(x.data(), p.data());
+    }
+
+private: // Utility functions
+    template<std::size_t s>
+    static const T &arg(const T *x, const T *p)
+    {
+        return s < XDim ? x[s] : p[s - XDim];
+    }
+    template<std::size_t... s>
+    T call_f(const T *x, const T *p, METAPROG::int_seq<s...>) const
+    {
+        return m_f(arg<s>(x, p)...);
+    }
+
+private: // Data
+    function_type m_f;
+};
+
+template<unsigned int XDIM, typename SIG, typename F>
+StaticParametrizedFunction<XDIM, SIG, typename std::decay<F>::type> MakeStaticParametrizedFunction(F &&f)
+{
+    return StaticParametrizedFunction<XDIM, SIG, typename std::decay<F>::type>(std::forward<F>(f));
 }
 
-#endif // STATIC_PARAMETRIZED_FUNCTION_HPP
\ No newline at end of file
+END_NAMESPACE // LQCDA
+
+#endif // STATIC_PARAMETRIZED_FUNCTION_HPP
@@ -0,0 +1,527 @@
+/*
+ * Formula.cpp
+ *
+ *  Created on: Oct 19, 2026
+ *      Author: Thibaut Metivet
+ */
+
+#include "Formula.hpp"
+
+#include <cctype>
+#include <cstdlib>
+#include <map>
+#include <memory>
+
+using namespace LQCDA;
+
+namespace {
+
+    typedef Formula::OpCode OpCode;
+
+    /**************************************************************************
+     *                                  AST                                   *
+     **************************************************************************/
+
+    struct Node
+    {
+        // Const, LoadX, LoadP or an arithmetic opcode
+        OpCode op;
+        double value;
+        unsigned int index;
+        std::unique_ptr<Node> a;
+        std::unique_ptr<Node> b;
+
+        bool isConstant() const
+        {
+            return op == OpCode::Const;
+        }
+    };
+
+    typedef std::unique_ptr<Node> NodePtr;
+
+    NodePtr makeLeaf(OpCode op, double value, unsigned int index)
+    {
+        NodePtr n(new Node);
+        n->op = op;
+        n->value = value;
+        n->index = index;
+        return n;
+    }
+
+    // Folds constant operands
+    NodePtr makeNode(OpCode op, NodePtr a, NodePtr b = nullptr)
+    {
+        if (a->isConstant() && (!b || b->isConstant()))
+        {
+            double v = Formula::apply(op, a->value, b ? b->value : 0.);
+            return makeLeaf(OpCode::Const, v, 0);
+        }
+        NodePtr n(new Node);
+        n->op = op;
+        n->value = 0.;
+        n->index = 0;
+        n->a = std::move(a);
+        n->b = std::move(b);
+        return n;
+    }
+
+    /**************************************************************************
+     *                                Parser                                  *
+     **************************************************************************/
+
+    const std::map<std::string, OpCode> &functions()
+    {
+        static const std::map<std::string, OpCode> f = {
+            {"exp", OpCode::Exp}, {"log", OpCode::Log}, {"sqrt", OpCode::Sqrt},
+            {"sin", OpCode::Sin}, {"cos", OpCode::Cos}, {"tan", OpCode::Tan},
+            {"asin", OpCode::Asin}, {"acos", OpCode::Acos}, {"atan", OpCode::Atan},
+            {"sinh", OpCode::Sinh}, {"cosh", OpCode::Cosh}, {"tanh", OpCode::Tanh},
+            {"abs", OpCode::Abs}, {"pow", OpCode::Pow}
+        };
+        return f;
+    }
+
+    // Recursive descent parser
+    class Parser
+    {
+    private:
+        const std::string &_Expr;
+        std::size_t _Pos {0};
+
+    public:
+        explicit Parser(const std::string &expr)
+            : _Expr(expr)
+        {}
+
+        NodePtr parse()
+        {
+            NodePtr n = expr();
+            skipSpaces();
+            if (_Pos != _Expr.size())
+            {
+                error("unexpected '" + std::string(1, _Expr[_Pos]) + "'");
+            }
+            return n;
+        }
+
+    private:
+        NodePtr expr()
+        {
+            NodePtr n = term();
+            while (accept('+') || accept('-'))
+            {
+                OpCode op = _Expr[_Pos - 1] == '+' ? OpCode::Add : OpCode::Sub;
+                n = makeNode(op, std::move(n), term());
+            }
+            return n;
+        }
+
+        NodePtr term()
+        {
+            NodePtr n = unary();
+            while (accept('*') || accept('/'))
+            {
+                OpCode op = _Expr[_Pos - 1] == '*' ? OpCode::Mul : OpCode::Div;
+                n = makeNode(op, std::move(n), unary());
+            }
+            return n;
+        }
+
+        NodePtr unary()
+        {
+            if (accept('-'))
+            {
+                return makeNode(OpCode::Neg, unary());
+            }
+            if (accept('+'))
+            {
+                return unary();
+            }
+            return power();
+        }
+
+        NodePtr power()
+        {
+            NodePtr n = primary();
+            if (accept('^'))
+            {
+                n = makePow(std::move(n), unary());
+            }
+            return n;
+        }
+
+        NodePtr primary()
+        {
+            skipSpaces();
+            if (_Pos == _Expr.size())
+            {
+                error("unexpected end of expression");
+            }
+            char c = _Expr[_Pos];
+            if (accept('('))
+            {
+                NodePtr n = expr();
+                expect(')');
+                return n;
+            }
+            if (std::isdigit(static_cast<unsigned char>(c)) || c == '.')
+            {
+                return number();
+            }
+            if (std::isalpha(static_cast<unsigned char>(c)) || c == '_')
+            {
+                return identifier();
+            }
+            error("unexpected '" + std::string(1, c) + "'");
+            return nullptr;
+        }
+
+        NodePtr number()
+        {
+            const char *begin = _Expr.c_str() + _Pos;
+            char *end;
+            double v = std::strtod(begin, &end);
+            if (end == begin)
+            {
+                error("invalid number");
+            }
+            _Pos += end - begin;
+            return makeLeaf(OpCode::Const, v, 0);
+        }
+
+        NodePtr identifier()
+        {
+            std::size_t start = _Pos;
+            while (_Pos < _Expr.size() && (std::isalnum(static_cast<unsigned char>(_Expr[_Pos])) || _Expr[_Pos] == '_'))
+            {
+                _Pos++;
+            }
+            std::string id = _Expr.substr(start, _Pos - start);
+
+            // variables and parameters
+            if ((id[0] == 'x' || id[0] == 'p') && id.size() > 1
+                    && id.find_first_not_of("0123456789", 1) == std::string::npos)
+            {
+                unsigned int k = std::strtoul(id.c_str() + 1, nullptr, 10);
+                return makeLeaf(id[0] == 'x' ? OpCode::LoadX : OpCode::LoadP, 0., k);
+            }
+            if (id == "x")
+            {
+                return makeLeaf(OpCode::LoadX, 0., 0);
+            }
+            if (id == "pi")
+            {
+                return makeLeaf(OpCode::Const, M_PI, 0);
+            }
+
+            // functions
+            auto f = functions().find(id);
+            if (f == functions().end())
+            {
+                _Pos = start;
+                error("unknown identifier '" + id + "'");
+            }
+            expect('(');
+            NodePtr a = expr();
+            NodePtr n;
+            if (f->second == OpCode::Pow)
+            {
+                expect(',');
+                n = makePow(std::move(a), expr());
+            }
+            else
+            {
+                n = makeNode(f->second, std::move(a));
+            }
+            expect(')');
+            return n;
+        }
+
+        // a^2 and a^0.5 are turned into cheaper operations
+        NodePtr makePow(NodePtr a, NodePtr b)
+        {
+            if (b->isConstant() && !a->isConstant())
+            {
+                if (b->value == 1.)
+                {
+                    return a;
+                }
+                if (b->value == 0.5)
+                {
+                    return makeNode(OpCode::Sqrt, std::move(a));
+                }
+                if (b->value == 2. && (a->op == OpCode::LoadX || a->op == OpCode::LoadP))
+                {
+                    NodePtr a2 = makeLeaf(a->op, 0., a->index);
+                    return makeNode(OpCode::Mul, std::move(a), std::move(a2));
+                }
+            }
+            return makeNode(OpCode::Pow, std::move(a), std::move(b));
+        }
+
+        void skipSpaces()
+        {
+            while (_Pos < _Expr.size() && std::isspace(static_cast<unsigned char>(_Expr[_Pos])))
+            {
+                _Pos++;
+            }
+        }
+        bool accept(char c)
+        {
+            skipSpaces();
+            if (_Pos < _Expr.size() && _Expr[_Pos] == c)
+            {
+                _Pos++;
+                return true;
+            }
+            return false;
+        }
+        void expect(char c)
+        {
+            if (!accept(c))
+            {
+                error("expected '" + std::string(1, c) + "'");
+            }
+        }
+        void error(const std::string &msg) const
+        {
+            ERROR(RUNTIME, "formula parse error in \"" + _Expr + "\" at position "
+                  + utils::strFrom(_Pos) + ": " + msg);
+        }
+    };
+
+    /**************************************************************************
+     *                               Compiler                                 *
+     **************************************************************************/
+
+    // Emits the uniform and varying code of an AST. Uniform registers are
+    // never reused, varying ones are recycled once consumed, except the ones
+    // holding the variables, which are loaded only once. Parameters and
+    // constants are also loaded once. Varying registers are numbered after the
+    // uniform ones at the end.
+    class Compiler
+    {
+    public:
+        struct Reg
+        {
+            bool uniform;
+            unsigned int index;
+        };
+
+    private:
+        std::vector<Formula::Instruction> &_Uniform;
+        std::vector<Formula::Instruction> &_Varying;
+        std::vector<Reg> _VaryingA, _VaryingB;
+        unsigned int _nUniform {0};
+        unsigned int _nVarying {0};
+        std::vector<unsigned int> _Free;
+        std::map<unsigned int, Reg> _X, _P;
+        std::map<double, Reg> _Const;
+
+    public:
+        Compiler(std::vector<Formula::Instruction> &uniform,
+                 std::vector<Formula::Instruction> &varying)
+            : _Uniform(uniform)
+            , _Varying(varying)
+        {}
+
+        Reg compile(const Node &n)
+        {
+            Formula::Instruction ins {n.op, 0, n.index, 0, n.value};
+            if (n.op == OpCode::Const || n.op == OpCode::LoadP)
+            {
+                Reg &r = n.op == OpCode::Const ? _Const[n.value] : _P[n.index];
+                if (!r.uniform)
+                {
+                    ins.dst = _nUniform++;
+                    _Uniform.push_back(ins);
+                    r = {true, ins.dst};
+                }
+                return r;
+            }
+            if (n.op == OpCode::LoadX)
+            {
+                auto x = _X.find(n.index);
+                if (x == _X.end())
+                {
+                    x = _X.insert({n.index, emitVarying(ins, {true, 0}, {true, 0})}).first;
+                }
+                return x->second;
+            }
+
+            Reg a = compile(*n.a);
+            Reg b = n.b ? compile(*n.b) : a;
+            if (a.uniform && b.uniform)
+            {
+                ins.dst = _nUniform++;
+                ins.a = a.index;
+                ins.b = b.index;
+                _Uniform.push_back(ins);
+                return {true, ins.dst};
+            }
+            release(a);
+            if (n.b)
+            {
+                release(b);
+            }
+            return emitVarying(ins, a, b);
+        }
+
+        // Final register numbering, returns the total number of registers
+        unsigned int finalize(Reg &result)
+        {
+            auto number = [this](const Reg & r)
+            {
+                return r.uniform ? r.index : _nUniform + r.index;
+            };
+            for (std::size_t i = 0; i < _Varying.size(); ++i)
+            {
+                _Varying[i].dst += _nUniform;
+                if (_Varying[i].op != OpCode::LoadX)
+                {
+                    _Varying[i].a = number(_VaryingA[i]);
+                    _Varying[i].b = number(_VaryingB[i]);
+                }
+            }
+            result.index = number(result);
+            return _nUniform + _nVarying;
+        }
+
+        unsigned int nUniform() const
+        {
+            return _nUniform;
+        }
+
+    private:
+        Reg emitVarying(Formula::Instruction ins, Reg a, Reg b)
+        {
+            if (_Free.empty())
+            {
+                ins.dst = _nVarying++;
+            }
+            else
+            {
+                ins.dst = _Free.back();
+                _Free.pop_back();
+            }
+            _Varying.push_back(ins);
+            _VaryingA.push_back(a);
+            _VaryingB.push_back(b);
+            return {false, ins.dst};
+        }
+        void release(const Reg &r)
+        {
+            if (!r.uniform && !isVariable(r))
+            {
+                _Free.push_back(r.index);
+            }
+        }
+        bool isVariable(const Reg &r) const
+        {
+            for (auto &x : _X)
+            {
+                if (!x.second.uniform && x.second.index == r.index)
+                {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    void dimensions(const Node &n, unsigned int &xDim, unsigned int &nPar)
+    {
+        if (n.op == OpCode::LoadX)
+        {
+            xDim = std::max(xDim, n.index + 1);
+        }
+        else if (n.op == OpCode::LoadP)
+        {
+            nPar = std::max(nPar, n.index + 1);
+        }
+        if (n.a)
+        {
+            dimensions(*n.a, xDim, nPar);
+        }
+        if (n.b)
+        {
+            dimensions(*n.b, xDim, nPar);
+        }
+    }
+
+    const char *name(OpCode op)
+    {
+        static const char *names[] = {
+            "const", "ldx", "ldp", "neg", "add", "sub", "mul", "div", "pow",
+            "exp", "log", "sqrt", "sin", "cos", "tan", "asin", "acos", "atan",
+            "sinh", "cosh", "tanh", "abs"
+        };
+        return names[static_cast<unsigned int>(op)];
+    }
+
+}
+
+/******************************************************************************
+ *                            Formula definition                              *
+ ******************************************************************************/
+
+Formula::Formula(const std::string &expr)
+{
+    compile(expr);
+}
+
+void Formula::compile(const std::string &expr)
+{
+    NodePtr ast = Parser(expr).parse();
+
+    std::vector<Instruction> uniform, varying;
+    Compiler c(uniform, varying);
+    Compiler::Reg res = c.compile(*ast);
+    unsigned int nRegisters = c.finalize(res);
+
+    _Expr = expr;
+    _xDim = _nPar = 0;
+    dimensions(*ast, _xDim, _nPar);
+    _nUniform = c.nUniform();
+    _nRegisters = nRegisters;
+    _Result = res.index;
+    _UniformCode.swap(uniform);
+    _VaryingCode.swap(varying);
+}
+
+std::ostream &LQCDA::operator<<(std::ostream &os, const Formula &f)
+{
+    auto print = [&os](const Formula::Instruction & ins)
+    {
+        os << "\tr" << ins.dst << " = " << name(ins.op);
+        switch (ins.op)
+        {
+        case OpCode::Const:
+            os << ' ' << ins.value;
+            break;
+        case OpCode::LoadX:
+            os << " x" << ins.a;
+            break;
+        case OpCode::LoadP:
+            os << " p" << ins.a;
+            break;
+        default:
+            os << " r" << ins.a << " r" << ins.b;
+            break;
+        }
+        os << '\n';
+    };
+    os << "Formula \"" << f.expression() << "\" (" << f.nRegisters() << " registers)\n"
+       << "uniform code:\n";
+    for (auto &ins : f.uniformCode())
+    {
+        print(ins);
+    }
+    os << "varying code:\n";
+    for (auto &ins : f.varyingCode())
+    {
+        print(ins);
+    }
+    os << "result: r" << f.result() << std::endl;
+    return os;
+}
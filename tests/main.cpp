@@ -2,7 +2,11 @@
 #include "Function.hpp"
 #include "GSLRootFinder.hpp"
 
+#include <atomic>
+#include <chrono>
 #include <iostream>
+#include <sstream>
+#include <thread>
 #include <vector>
 #include <type_traits>
 
@@ -21,6 +25,16 @@ public:
 
     using LQCDA::ParametrizedSFunction<double>::operator();
 
+    virtual bool isLinear() const override
+    {
+        return true;
+    }
+    virtual void designRow(const double *x, double *row) const override
+    {
+        row[0] = *x;
+        row[1] = 1.;
+    }
+
 private:
     static double eval(const double *x, const double *p)
     {
@@ -72,6 +86,1013 @@ double g(double x)
     return x - 1.;
 }
 
+/******************************************************************************
+ *                                   Checks                                   *
+ ******************************************************************************/
+
+static int nFailures = 0;
+
+static void check(bool ok, const string &what)
+{
+    cout << (ok ? "[  OK  ] " : "[FAILED] ") << what << endl;
+    if (!ok)
+    {
+        nFailures++;
+    }
+}
+
+static bool near(double a, double b, double tol = 1.e-12)
+{
+    return std::abs(a - b) <= tol * std::max(1., std::abs(b));
+}
+
+template<typename F>
+static bool throws(F f)
+{
+    try
+    {
+        f();
+    }
+    catch (std::exception &)
+    {
+        return true;
+    }
+    return false;
+}
+
+// callbacks throw 42 to check that their own exception reaches the caller
+template<typename F>
+static bool rethrows42(F f)
+{
+    try
+    {
+        f();
+    }
+    catch (int e)
+    {
+        return e == 42;
+    }
+    return false;
+}
+
+static bool usesOp(const Formula &f, Formula::OpCode op)
+{
+    for (auto &ins : f.uniformCode())
+        if (ins.op == op)
+            return true;
+    for (auto &ins : f.varyingCode())
+        if (ins.op == op)
+            return true;
+    return false;
+}
+
+// Two exponentials with correlated errors
+static XYData<double> exponentialData(unsigned int n)
+{
+    XYData<double> xyd(n, 1, 1);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        xyd.x(i, 0) = i;
+        xyd.y(i, 0) = 2. * exp(-0.3 * i) + 0.5 * exp(-0.8 * i) * (1. + 0.01 * sin(i));
+        for (unsigned int j = 0; j < n; ++j)
+            xyd.yyCov(0, 0)(i, j) = 1.e-6 * exp(-0.1 * (i + j)) * (i == j ? 1. : 0.3);
+    }
+    return xyd;
+}
+
+static void checkChi2Concurrency()
+{
+    const unsigned int n = 20, nEval = 64;
+    XYData<double> xyd = exponentialData(n);
+    MODELS::MultiExp<double> model(2);
+    FitInterface fit(n, 1, 1);
+    fit.fitAllPoints(true);
+    Chi2CostFunction<double> chi2(xyd, fit, {&model});
+
+    vector<double> p(4 * nEval), serial(nEval), concurrent(nEval);
+    for (unsigned int k = 0; k < nEval; ++k)
+    {
+        double q[] = {2. + 0.01 * k, 0.3, 0.5, 0.8 - 0.001 * k};
+        std::copy(q, q + 4, p.begin() + 4 * k);
+        serial[k] = chi2(p.data() + 4 * k);
+    }
+    // one cost function shared by all threads
+    #pragma omp parallel for
+    for (int k = 0; k < static_cast<int>(nEval); ++k)
+    {
+        concurrent[k] = chi2(p.data() + 4 * k);
+    }
+    check(concurrent == serial, "chi2: concurrent evaluations");
+    chi2.evaluateMany(p.data(), nEval, concurrent.data());
+    check(concurrent == serial, "chi2: batch evaluation");
+    // a model evaluating another cost function on the same thread
+    XYData<double> small = exponentialData(8);
+    FitInterface smallFit(8, 1, 1);
+    smallFit.fitAllPoints(true);
+    Chi2CostFunction<double> inner(small, smallFit, {&model});
+    auto nested = MakeParametrizedLambdaFunction<double>(1, 4, [&](const double *x, const double *q)
+    {
+        return model(x, q) + 0. * inner(q);
+    });
+    Chi2CostFunction<double> outer(xyd, fit, {&nested});
+    outer.options.parallel = false;
+    check(outer(p.data()) == serial[0], "chi2: nested evaluation");
+}
+
+static void checkChi2Parallel()
+{
+    const unsigned int n = 64;
+    XYData<double> xyd = exponentialData(n);
+    MODELS::MultiExp<double> model(2);
+    FitInterface fit(n, 1, 1);
+    fit.fitAllPoints(true);
+    Chi2CostFunction<double> chi2(xyd, fit, {&model});
+    double p[] = {1.9, 0.31, 0.4, 0.75};
+    chi2.options.parallel = false;
+    double serial = chi2(p);
+    // split the residuals and the triangular solve in small chunks
+    chi2.options.parallel = true;
+    chi2.options.parallel_threshold = 8;
+    chi2.options.block_size = 16;
+    check(near(chi2(p), serial, 1.e-10), "chi2: split evaluation");
+    // model errors are forwarded from the chunks
+    auto bad = MakeParametrizedLambdaFunction<double>(1, 4, [&](const double *x, const double *q)
+    {
+        if (x[0] > 40.)
+        {
+            ERROR(RUNTIME, "model failure");
+        }
+        return model(x, q);
+    });
+    Chi2CostFunction<double> failing(xyd, fit, {&bad});
+    failing.options = chi2.options;
+    check(throws([&] { failing(p); }), "chi2: model error in a split evaluation");
+    check(chi2.isThreadSafe() && MIN::InstrumentedFunction<double>(chi2).isThreadSafe(),
+          "chi2: declared thread-safe");
+}
+
+static void checkLinearSolve()
+{
+    const unsigned int n = 20;
+    XYData<double> xyd = exponentialData(n);
+    MODELS::Polynomial<double> model(2);
+    FitInterface fit(n, 1, 1);
+    fit.fitAllPoints(true);
+    Chi2CostFunction<double> chi2(xyd, fit, {&model});
+    Chi2CostFunction<double>::LinearSolution sol;
+    bool ok = chi2.solveLinear({}, sol) && near(chi2(sol.p.data()), sol.chi2, 1.e-8);
+    // chi2(p + d) - chi2(p) = d^T cov^-1 d at the minimum
+    Vector<double> d(3);
+    d << 1.e-3, -2.e-4, 1.e-5;
+    Vector<double> q = sol.p + d;
+    double dChi2 = d.dot(sol.cov.inverse() * d);
+    check(ok && near(chi2(q.data()) - sol.chi2, dChi2, 1.e-6), "GLS: closed-form minimum and covariance");
+    vector<ScalarConstraint<double>> c(3);
+    c[0].fixValue(0.5);
+    ok = chi2.solveLinear(c, sol) && sol.p(0) == 0.5 && sol.cov(0, 0) == 0.;
+    q = sol.p;
+    q(1) += 1.e-4;
+    check(ok && chi2(q.data()) > sol.chi2, "GLS: fixed parameter");
+    MODELS::MultiExp<double> nonLinear(1);
+    Chi2CostFunction<double> chi2NonLinear(xyd, fit, {&nonLinear});
+    check(!chi2NonLinear.solveLinear({}, sol), "GLS: non-linear model");
+}
+
+static void checkPriors()
+{
+    const unsigned int n = 20;
+    XYData<double> xyd = exponentialData(n);
+    MODELS::MultiExp<double> model(2);
+    FitInterface fit(n, 1, 1);
+    fit.fitAllPoints(true);
+    Chi2CostFunction<double> chi2(xyd, fit, {&model});
+    double p[] = {1.9, 0.31, 0.4, 0.75};
+    double c0 = chi2(p);
+    unsigned int dof0 = chi2.nDOF();
+
+    GaussianPrior<double> prior(4);
+    prior.setPrior(1, 0.3, 0.05);
+    Vector<double> mean(2);
+    mean << 0.5, 0.8;
+    Matrix<double> cov(2, 2);
+    cov << 0.04, 0.01, 0.01, 0.09;
+    prior.setCorrelatedPrior({2, 3}, mean, cov);
+    chi2.setPrior(prior);
+    Vector<double> d(2);
+    d << p[2] - 0.5, p[3] - 0.8;
+    double expected = c0 + std::pow((p[1] - 0.3) / 0.05, 2) + d.dot(cov.inverse() * d);
+    check(near(chi2(p), expected, 1.e-10) && chi2.nDOF() == dof0 + 3, "priors: augmented chi2 and DOF");
+    // the cost function keeps its own copy
+    prior.clear();
+    check(near(chi2(p), expected, 1.e-10), "priors: copy of the prior");
+    GaussianPrior<double> wrong(3);
+    wrong.setPrior(0, 1., 1.);
+    check(throws([&] { chi2.setPrior(wrong); }), "priors: wrong number of parameters");
+}
+
+template<typename T>
+using LBFGS = MIN::LBFGSMinimizer<T>;
+
+static void checkWarmStart()
+{
+    const unsigned int n = 20;
+    XYData<double> xyd = exponentialData(n);
+    MODELS::MultiExp<double> model(1);
+    MODELS::Polynomial<double> line(1);
+    Chi2Fit<double, LBFGS> fit(xyd), cold(xyd);
+    fit.fitAllPoints(true);
+    cold.fitAllPoints(true);
+    fit.options.warm_start = true;
+    fit.options.linear_solve = false;
+    cold.options.linear_solve = false;
+    auto r1 = fit.fit(model, {1., 0.1});
+    // x0 is ignored when warm-starting
+    auto r2 = fit.fit(model, {100., 5.});
+    check(r1.isValid() && r2.isValid() && near(r2.parameters()[0], r1.parameters()[0], 1.e-4)
+          && r2.telemetry().n_calls < r1.telemetry().n_calls, "warm start: same model and data");
+    // another model starts from its own x0
+    auto r3 = fit.fit(line, {1., 0.});
+    auto r4 = cold.fit(line, {1., 0.});
+    check(r3.parameters() == r4.parameters(), "warm start: other model");
+    // other fixed parameters start from their own x0
+    fit.fit(model, {1., 0.1});
+    vector<ScalarConstraint<double>> fixed(2);
+    fixed[1].fixValue(0.31);
+    auto r5 = fit.fit(model, {1., 0.31}, fixed);
+    auto r6 = cold.fit(model, {1., 0.31}, fixed);
+    check(r5.parameters() == r6.parameters(), "warm start: other fixed parameters");
+}
+
+static void checkTelemetry()
+{
+    std::atomic<unsigned long> nEval {0};
+    auto rosenbrock = MakeLambdaFunction<double>(2, [&](const double *x)
+    {
+        nEval++;
+        return std::pow(1. - x[0], 2) + 100. * std::pow(x[1] - x[0] * x[0], 2);
+    });
+    MIN::LBFGSMinimizer<double> lbfgs;
+    lbfgs.options().verbosity = SILENT;
+    auto min = lbfgs.minimize(rosenbrock, {-1., 1.});
+    const MIN::Telemetry &t = min.telemetry;
+    check(min.is_valid && t.n_calls == nEval && t.eval_time <= t.total_time && !t.edm_trace.empty(),
+          "telemetry: call count and timings");
+    MIN::TelemetrySummary summary;
+    #pragma omp parallel for
+    for (int k = 0; k < 100; ++k)
+    {
+        summary.add(t);
+    }
+    check(summary.nFits() == 100 && summary.nCalls() == 100 * nEval && summary.maxCalls() == nEval,
+          "telemetry: concurrent summary");
+}
+
+static void checkLBFGS()
+{
+    auto rosenbrock = MakeLambdaFunction<double>(10, [](const double *x)
+    {
+        double r = 0.;
+        for (unsigned int i = 0; i + 1 < 10; ++i)
+            r += 100. * std::pow(x[i + 1] - x[i] * x[i], 2) + std::pow(1. - x[i], 2);
+        return r;
+    });
+    MIN::LBFGSMinimizer<double> lbfgs;
+    lbfgs.options().verbosity = SILENT;
+    lbfgs.options().dense_max_dim = 0;
+    lbfgs.options().tolerance = 1.e-6;
+    auto min = lbfgs.minimize(rosenbrock, vector<double>(10, -1.));
+    bool ok = min.is_valid;
+    for (double x : min.minimum)
+        ok = ok && near(x, 1., 1.e-3);
+    check(ok, "L-BFGS: 10-dimensional Rosenbrock");
+    // active bound
+    vector<ScalarConstraint<double>> c(10);
+    c[0].setBounds(-2., 0.5);
+    min = lbfgs.minimize(rosenbrock, vector<double>(10, -1.), c);
+    check(min.minimum[0] == 0.5, "L-BFGS: bounded parameter");
+
+    // errors of a chi2-like quadratic, with the fixed-size solver
+    auto quadratic = MakeLambdaFunction<double>(2, [](const double *x)
+    {
+        return std::pow((x[0] - 1.) / 0.5, 2) + std::pow((x[1] + 2.) / 0.1, 2);
+    });
+    MIN::LBFGSMinimizer<double, 2> fixed;
+    fixed.options().verbosity = SILENT;
+    fixed.options().tolerance = 1.e-6;
+    min = fixed.minimize(quadratic, {0., 0.});
+    check(min.is_valid && near(min.minimum[0], 1., 1.e-5) && near(min.minimum[1], -2., 1.e-5)
+          && near(min.errors[0], 0.5, 1.e-4) && near(min.errors[1], 0.1, 1.e-4),
+          "L-BFGS: fixed-size minimum and errors");
+    vector<ScalarConstraint<double>> cf(2);
+    cf[1].fixValue(-1.5);
+    min = fixed.minimize(quadratic, {0., 0.}, cf);
+    check(min.minimum[1] == -1.5 && min.errors[1] == 0. && near(min.minimum[0], 1., 1.e-5),
+          "L-BFGS: fixed parameter");
+}
+
+static void checkMultiStart()
+{
+    // Rastrigin function, global minimum 0 at (0.3, 0.3)
+    std::atomic<unsigned long> nEval {0};
+    auto rastrigin = MakeLambdaFunction<double>(2, [&](const double *x)
+    {
+        nEval++;
+        double r = 20.;
+        for (unsigned int i = 0; i < 2; ++i)
+            r += std::pow(x[i] - 0.3, 2) - 10. * std::cos(2. * M_PI * (x[i] - 0.3));
+        return r;
+    });
+    LBFGS<double> single;
+    single.options().verbosity = SILENT;
+    auto local = single.minimize(rastrigin, {3., 3.});
+    MIN::MultiStartMinimizer<double, LBFGS> multi;
+    multi.options().verbosity = SILENT;
+    multi.options().n_starts = 32;
+    vector<ScalarConstraint<double>> c(2);
+    c[0].setBounds(-5., 5.);
+    nEval = 0;
+    auto global = multi.minimize(rastrigin, {3., 3.}, vector<double> {0.1, 0.1}, c);
+    check(local.final_cost > 1. && global.final_cost < 1.e-2 && near(global.minimum[0], 0.3, 1.e-2)
+          && near(global.minimum[1], 0.3, 1.e-2), "multi-start: global minimum");
+    // without cancellation, the result does not depend on the thread scheduling
+    auto again = multi.minimize(rastrigin, {3., 3.}, vector<double> {0.1, 0.1}, c);
+    check(again.minimum == global.minimum && again.final_cost == global.final_cost,
+          "multi-start: reproducible without cancellation");
+    // the calls of cancelled runs are counted
+    multi.options().cancel = true;
+    multi.options().cancel_after = 20;
+    nEval = 0;
+    global = multi.minimize(rastrigin, {3., 3.}, vector<double> {0.1, 0.1}, c);
+    unsigned long nRuns = 0;
+    for (auto &lm : multi.localMinima())
+        nRuns += lm.result.telemetry.n_calls;
+    check(multi.localMinima().size() == 32 && global.telemetry.n_calls == nEval && nRuns == nEval,
+          "multi-start: call count");
+}
+
+static void checkDifferentialEvolution()
+{
+    // Rastrigin function, global minimum 0 at (0.3, 0.3, 0.3)
+    auto rastrigin = MakeLambdaFunction<double>(3, [](const double *x)
+    {
+        double r = 30.;
+        for (unsigned int i = 0; i < 3; ++i)
+            r += std::pow(x[i] - 0.3, 2) - 10. * std::cos(2. * M_PI * (x[i] - 0.3));
+        return r;
+    });
+    vector<ScalarConstraint<double>> c(3);
+    for (auto &ci : c)
+        ci.setBounds(-5., 5.);
+    c[2].fixValue(0.3);
+    MIN::DE<double> de;
+    de.options().verbosity = SILENT;
+    de.options().polish = false;
+    auto min = de.minimize(rastrigin, {3., 3., 0.}, vector<double> {1., 1., 1.}, c);
+    check(min.final_cost < 0.1 && min.minimum[2] == 0.3 && near(min.minimum[0], 0.3, 0.05)
+          && near(min.minimum[1], 0.3, 0.05), "DE: global minimum");
+    // the generations do not depend on the thread scheduling
+    auto again = de.minimize(rastrigin, {3., 3., 0.}, vector<double> {1., 1., 1.}, c);
+    check(again.minimum == min.minimum, "DE: reproducible with a seed");
+    // polishing never worsens the best member
+    de.options().polish = true;
+    auto polished = de.minimize(rastrigin, {3., 3., 0.}, vector<double> {1., 1., 1.}, c);
+    check(polished.final_cost <= min.final_cost && polished.minimum[2] == 0.3, "DE: polished minimum");
+    // the population evaluations are regular calls
+    check(min.telemetry.n_calls > 0 && min.telemetry.n_pre_min_calls == 0
+          && polished.telemetry.n_calls > min.telemetry.n_calls && polished.telemetry.n_pre_min_calls == 0,
+          "DE: population evaluations counted as calls");
+}
+
+static void checkEvaluateMany()
+{
+    const unsigned int n = 7;
+    vector<double> X(2 * n), out(n);
+    for (unsigned int k = 0; k < 2 * n; ++k)
+        X[k] = 0.1 * k;
+    auto pointwise = [&](const ScalarFunction<double> &f)
+    {
+        bool ok = true;
+        for (unsigned int k = 0; k < n; ++k)
+            ok = ok && out[k] == f(X.data() + 2 * k);
+        return ok;
+    };
+    // default implementation, with a stride of xDim()
+    struct Product : ScalarFunction<double>
+    {
+        Product() : ScalarFunction<double>(2) {}
+        double operator()(const double *x) const override { return x[0] * x[1]; }
+        using ScalarFunction<double>::operator();
+    } product;
+    product.evaluateMany(X.data(), n, out.data());
+    check(pointwise(product), "evaluateMany: default implementation");
+    auto lambda = MakeLambdaFunction<double>(2, [](const double *x) { return x[0] - x[1]; });
+    lambda.evaluateMany(X.data(), n, out.data());
+    check(pointwise(lambda), "evaluateMany: lambda function");
+    // parametrized models, directly and once bound
+    MODELS::MultiExp<double> model(2);
+    vector<double> p = {1., 0.3, 0.5, 0.7};
+    model.evaluateMany(X.data(), n, p.data(), out.data());
+    bool ok = true;
+    for (unsigned int k = 0; k < n; ++k)
+        ok = ok && near(out[k], model(&X[k], p.data()));
+    auto bound = bindParameters(model, p);
+    vector<double> boundOut(n);
+    bound.evaluateMany(X.data(), n, boundOut.data());
+    check(ok && boundOut == out, "evaluateMany: parametrized model");
+}
+
+static void checkNumericalDerivatives()
+{
+    auto f = MakeLambdaFunction<double>(3, [](const double *x)
+    {
+        return x[0] * x[0] * x[1] + std::sin(x[1]) + std::exp(x[2]) * x[0];
+    });
+    double x[] = {0.7, 1.2, -0.4}, e = std::exp(x[2]);
+    Vector<double> g0(3);
+    g0 << 2. * x[0] * x[1] + e, x[0] * x[0] + std::cos(x[1]), x[0] * e;
+    Matrix<double> H0(3, 3);
+    H0 << 2. * x[1], 2. * x[0], e,
+          2. * x[0], -std::sin(x[1]), 0.,
+          e, 0., x[0] * e;
+
+    NumericalDerivatives<double> nd(f, Vector<double>::Ones(3));
+    Vector<double> g(3);
+    Matrix<double> H;
+    nd.gradient(x, g.data());
+    bool ok = nd.hessian(x, H) && (g - g0).norm() < 1.e-8 && (H - H0).norm() < 1.e-5;
+    check(ok, "derivatives: gradient and Hessian");
+    // fixed-size stencils give the same result
+    NumericalDerivatives<double, 3> ndFixed(f, Eigen::Vector3d::Ones());
+    Eigen::Vector3d gFixed;
+    Eigen::Matrix3d HFixed;
+    ndFixed.gradient(x, gFixed.data());
+    check(ndFixed.hessian(x, HFixed) && gFixed == g && HFixed == H, "derivatives: fixed size");
+    // x_1 on its upper bound, x_2 fixed
+    Vector<double> lower(3), upper(3);
+    lower << -10., -10., x[2];
+    upper << 10., x[1], x[2];
+    nd.setBounds(lower, upper);
+    nd.gradient(x, g.data());
+    ok = nd.hessian(x, H) && near(g(1), g0(1), 1.e-4) && g(2) == 0.
+         && H(2, 2) == 1. && H(0, 2) == 0. && std::abs(H(1, 1) - H0(1, 1)) < 1.e-2;
+    check(ok, "derivatives: bounded and fixed parameters");
+}
+
+static void checkMinos()
+{
+    auto quadratic = MakeLambdaFunction<double>(2, [](const double *x)
+    {
+        return std::pow((x[0] - 1.) / 0.5, 2) + std::pow((x[1] + 2.) / 0.1, 2);
+    });
+    MIN::MIGRAD<double> migrad;
+    migrad.options().verbosity = SILENT;
+    migrad.options().minos = {0, 1};
+    auto min = migrad.minimize(quadratic, {1., -2.}, vector<double> {0.1, 0.1}, {});
+    // MINOS errors of a quadratic are its parabolic errors
+    bool ok = min.lower_errors.size() == 2 && min.upper_errors.size() == 2;
+    for (unsigned int k = 0; ok && k < 2; ++k)
+    {
+        double e = k ? 0.1 : 0.5;
+        ok = min.lower_valid[k] && min.upper_valid[k] && near(min.lower_errors[k], -e, 1.e-3)
+             && near(min.upper_errors[k], e, 1.e-3);
+    }
+    check(ok, "MINOS: errors of a quadratic");
+
+    // a function which is not thread-safe is never evaluated concurrently
+    std::atomic<int> active {0}, maxActive {0};
+    auto counted = MakeLambdaFunction<double>(2, [&](const double *x)
+    {
+        int a = ++active;
+        int m = maxActive.load();
+        while (a > m && !maxActive.compare_exchange_weak(m, a))
+            ;
+        std::this_thread::sleep_for(std::chrono::microseconds(50));
+        --active;
+        return std::pow((x[0] - 1.) / 0.5, 2) + std::pow((x[1] + 2.) / 0.1, 2);
+    });
+    min = migrad.minimize(counted, {1., -2.}, vector<double> {0.1, 0.1}, {});
+    check(!counted.isThreadSafe() && maxActive == 1, "MINOS: serial tasks for a function which is not thread-safe");
+}
+
+static void checkStaticFit()
+{
+    StaticParametrizedFunction<1, double(double, double, double)> line(
+        [](double x, double a, double b) { return a * x + b; });
+    check(line.eval(Vector<double, 1>(2.), Vector<double, 2>(3., 1.)) == 7., "static fit: model evaluation");
+    StaticFit<decltype(line), 5> fit(line);
+    fit.minimizerOptions().tolerance = 1.e-6;
+    Matrix<double, 1, 5> x;
+    x << 0., 1., 2., 3., 4.;
+    Vector<double, 5> y;
+    y << 1.1, 2.9, 5.2, 6.8, 9.1;
+    Matrix<double, 5, 5> C = Matrix<double, 5, 5>::Identity() * 0.01;
+    C(0, 1) = C(1, 0) = 0.002;
+    fit.setData(x, y, C);
+    auto r = fit.fit(Vector<double, 2>(0., 0.));
+    // generalized least squares
+    Matrix<double, 5, 2> A;
+    A.col(0) = x.transpose();
+    A.col(1).setOnes();
+    Matrix<double, 2, 2> cov = (A.transpose() * C.inverse() * A).inverse();
+    Vector<double, 2> p = cov * A.transpose() * C.inverse() * y;
+    check(r.is_valid && r.n_dof == 3 && (r.p - p).norm() < 1.e-5 && (r.cov - cov).norm() < 1.e-5 * cov.norm(),
+          "static fit: correlated line fit");
+    // a dynamic number of points gives the same chi2, with the thread buffer
+    StaticChi2CostFunction<decltype(line), 5> fixedCost(line);
+    StaticChi2CostFunction<decltype(line)> dynamicCost(line);
+    fixedCost.setData(x, y, C);
+    dynamicCost.setData(Matrix<double, 1, Dynamic>(x), Vector<double>(y), Matrix<double>(C));
+    check(near(dynamicCost.evaluate(p), fixedCost.evaluate(p)) && near(dynamicCost.evaluate(r.p), fixedCost.evaluate(r.p)),
+          "static fit: dynamic number of correlated points");
+}
+
+// Counts its constructions
+struct SingletonCheck
+{
+    static std::atomic<int> nInstances;
+    SingletonCheck() { nInstances++; }
+};
+std::atomic<int> SingletonCheck::nInstances {0};
+
+static void checkThreadPolicies()
+{
+    typedef utils::SingletonHolder<SingletonCheck, utils::policies::creation::OpNewCreator,
+            utils::policies::lifetime::DefaultLifetime, utils::policies::thread::ClassLevelLockable> Holder;
+    vector<SingletonCheck *> instances(64);
+    #pragma omp parallel for
+    for (int k = 0; k < 64; ++k)
+    {
+        instances[k] = &Holder::instance();
+    }
+    bool same = true;
+    for (auto i : instances)
+        same = same && i == instances[0];
+    check(same && SingletonCheck::nInstances == 1, "policies: concurrent singleton creation");
+
+    utils::Factory<int, int, std::function<int *()>, utils::DefaultFactoryError,
+          utils::policies::thread::ClassLevelLockable> factory;
+    std::atomic<int> nCreated {0};
+    #pragma omp parallel for
+    for (int k = 0; k < 64; ++k)
+    {
+        factory.registerId(k, [k] { return new int(k); });
+        auto p = factory.create(k);
+        if (p && *p == k)
+            nCreated++;
+    }
+    check(nCreated == 64, "policies: concurrent factory registration and creation");
+}
+
+static void checkCallableFunctions()
+{
+    auto cosh = [](const double *x, const double *p) { return p[0] * std::cosh(p[1] * (x[0] - 8.)); };
+    ParametrizedSFunction<double> erased(1, 2, cosh);
+    auto lambda = MakeParametrizedLambdaFunction<double>(1, 2, cosh);
+    auto fixed = MakeStaticParametrizedFunction<1, double(double, double, double)>(
+        [](double x, double a, double m) { return a * std::cosh(m * (x - 8.)); });
+    const unsigned int n = 16;
+    vector<double> X(n), ref(n), out(n);
+    double p[] = {1., 0.3};
+    for (unsigned int k = 0; k < n; ++k)
+        X[k] = k;
+    erased.evaluateMany(X.data(), n, p, ref.data());
+    bool ok = true;
+    for (const ParametrizedScalarFunction<double> *f : {(const ParametrizedScalarFunction<double> *)&lambda,
+                                                         (const ParametrizedScalarFunction<double> *)&fixed})
+    {
+        f->evaluateMany(X.data(), n, p, out.data());
+        for (unsigned int k = 0; k < n; ++k)
+            ok = ok && near(out[k], ref[k]) && near((*f)(&X[k], p), ref[k]);
+    }
+    check(ok, "callables: lambda and static functions match the std::function one");
+}
+
+static void checkVectorModels()
+{
+    // y_k = a_k + b x, with a common slope
+    const unsigned int n = 10, nY = 3;
+    XYData<double> xyd(n, 1, nY);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        xyd.x(i, 0) = i;
+        for (unsigned int k = 0; k < nY; ++k)
+        {
+            xyd.y(i, k) = k + 1. - 0.1 * i + 0.001 * ((i * 7 + k) % 5);
+            xyd.yyCov(k, k)(i, i) = 1.e-4;
+        }
+    }
+    FitInterface fit(n, 1, nY);
+    fit.fitAllPoints(true);
+    auto joint = MakeParametrizedVectorLambdaFunction<double>(1, nY, nY + 1,
+                 [](const double *x, const double *p, double *y)
+    {
+        for (unsigned int k = 0; k < nY; ++k)
+            y[k] = p[k] + p[nY] * x[0];
+    });
+    struct Line : ParametrizedScalarFunction<double>
+    {
+        unsigned int k;
+        Line(unsigned int k) : ParametrizedScalarFunction<double>(1, nY + 1), k(k) {}
+        double operator()(const double *x, const double *p) const override { return p[k] + p[nY] * x[0]; }
+        using ParametrizedScalarFunction<double>::operator();
+    };
+    Line l0(0), l1(1), l2(2);
+    Chi2CostFunction<double> chi2Joint(xyd, fit, joint), chi2Scalar(xyd, fit, {&l0, &l1, &l2});
+    double p[] = {1., 2., 3., -0.1};
+    check(near(chi2Joint(p), chi2Scalar(p), 1.e-10) && chi2Joint.nDOF() == chi2Scalar.nDOF(),
+          "vector models: same chi2 as the scalar models");
+    auto wrong = MakeParametrizedVectorLambdaFunction<double>(1, nY + 1, nY + 1,
+                 [](const double *, const double *, double *) {});
+    check(throws([&] { Chi2CostFunction<double> c(xyd, fit, wrong); }), "vector models: y-dimension mismatch");
+}
+
+static void checkFormula()
+{
+    auto eval = [](const string & expr, double x, vector<double> p = {})
+    {
+        ParametrizedFormulaFunction<double> f(expr, 1, p.size());
+        return f(&x, p.data());
+    };
+    // precedence and associativity
+    check(near(eval("-x^2", 3.), -9.), "formula: -x^2 is -(x^2)");
+    check(near(eval("2^-1", 0.), 0.5), "formula: 2^-1 is 0.5");
+    check(near(eval("2^3^2", 0.), 512.), "formula: ^ is right associative");
+    check(near(eval("1-x-1", 2.), -2.), "formula: - is left associative");
+    check(near(eval("p0*exp(-p1*x)+p2", 1., {2., 0.5, 1.}), 2. * exp(-0.5) + 1.),
+          "formula: exponential model");
+    // pow rewrites
+    Formula sq("x^2"), rt("pow(p0,0.5)*x"), id("x^1");
+    check(!usesOp(sq, Formula::OpCode::Pow) && usesOp(sq, Formula::OpCode::Mul)
+          && near(eval("x^2", -1.5), 2.25), "formula: x^2 is a product");
+    check(!usesOp(rt, Formula::OpCode::Pow) && usesOp(rt, Formula::OpCode::Sqrt)
+          && near(eval("pow(p0,0.5)*x", 2., {9.}), 6.), "formula: a^0.5 is a square root");
+    check(!usesOp(id, Formula::OpCode::Pow) && near(eval("x^1", 1.7), 1.7),
+          "formula: a^1 is a");
+    // batches longer than BatchSize
+    ParametrizedFormulaFunction<double> lin("p0+p1*x");
+    vector<double> X(150), Y(150), p = {1., 2.};
+    bool ok = true;
+    for (unsigned int i = 0; i < X.size(); ++i)
+        X[i] = 0.1 * i;
+    lin.evaluateMany(X.data(), X.size(), p.data(), Y.data());
+    for (unsigned int i = 0; i < X.size(); ++i)
+        ok = ok && near(Y[i], 1. + 2. * X[i]);
+    check(ok, "formula: batched evaluation");
+    // parse errors
+    check(throws([] { Formula f("x+"); }), "formula: missing operand");
+    check(throws([] { Formula f("(x+1"); }), "formula: unbalanced parenthesis");
+    check(throws([] { Formula f("foo(x)"); }), "formula: unknown function");
+    check(throws([] { Formula f("pow(x)"); }), "formula: pow needs two arguments");
+    check(throws([] { Formula f("x y"); }), "formula: trailing characters");
+    check(throws([] { ParametrizedFormulaFunction<double> f("p0*x1", 1, 1); }),
+          "formula: dimensions smaller than the expression");
+}
+
+static void checkCache()
+{
+    EvaluationCache<double> cache(100, 1);
+    double x1[] = {1.}, x3[] = {1., 2., 3.}, v = 0.;
+    // same hash, different argument sizes
+    cache.insert(42, x1, 1, nullptr, 0, 10.);
+    cache.insert(42, x3, 3, nullptr, 0, 30.);
+    check(cache.size() == 2, "cache: colliding entries of different sizes are both kept");
+    check(cache.find(42, x3, 3, nullptr, 0, v) && v == 30., "cache: lookup of the longer entry");
+    check(cache.find(42, x1, 1, nullptr, 0, v) && v == 10., "cache: lookup of the shorter entry");
+    check(!cache.find(42, x3, 2, nullptr, 0, v), "cache: a prefix is not a hit");
+
+    Line line;
+    CachedParametrizedFunction<double> cached(line, 10);
+    double p[] = {2., 1.};
+    bool ok = true;
+    for (int k = 0; k < 3; ++k)
+        for (double x : {0., 1., 2.})
+            ok = ok && cached(&x, p) == line(&x, p);
+    check(ok && cached.cache()->nHits() == 6 && cached.cache()->nMisses() == 3,
+          "cache: repeated evaluations are hits");
+}
+
+static void checkCorrelatorModels()
+{
+    const double Lt = 16.;
+    MODELS::Cosh<double> cosh(2, Lt);
+    MODELS::Sinh<double> sinh(1, Lt);
+    MODELS::Oscillating<double> osc(1, 1, Lt);
+    vector<double> p = {1.2, 0.3, 0.4, 0.9};
+    auto b = [&](double E, double t, double sign) { return exp(-E * t) + sign * exp(-E * (Lt - t)); };
+    bool ok = true;
+    for (double t : {0., 3., 7., 12.})
+    {
+        ok = ok && near(cosh(&t, p.data()), 1.2 * b(0.3, t, 1.) + 0.4 * b(0.9, t, 1.))
+             && near(sinh(&t, p.data()), 1.2 * b(0.3, t, -1.))
+             && near(osc(&t, p.data()), 1.2 * b(0.3, t, 1.) + cos(M_PI * t) * 0.4 * b(0.9, t, 1.));
+    }
+    check(ok, "models: cosh, sinh and oscillating values");
+    // analytic parameter gradients, batches and linear amplitudes
+    ok = true;
+    for (const ParametrizedScalarFunction<double> *m : {(const ParametrizedScalarFunction<double> *)&cosh,
+                                                         (const ParametrizedScalarFunction<double> *)&sinh,
+                                                         (const ParametrizedScalarFunction<double> *)&osc})
+    {
+        const unsigned int n = m->nPar();
+        vector<double> ts = {1., 4., 9.}, out(3), g(n);
+        m->evaluateMany(ts.data(), ts.size(), p.data(), out.data());
+        for (unsigned int i = 0; i < ts.size(); ++i)
+        {
+            ok = ok && near(out[i], (*m)(&ts[i], p.data()));
+            m->parameterGradient(&ts[i], p.data(), g.data());
+            for (unsigned int k = 0; k < n; ++k)
+            {
+                vector<double> pp(p.begin(), p.begin() + n), pm(pp);
+                pp[k] += 1.e-6;
+                pm[k] -= 1.e-6;
+                double gk = ((*m)(&ts[i], pp.data()) - (*m)(&ts[i], pm.data())) / 2.e-6;
+                ok = ok && near(g[k], gk, 1.e-6);
+            }
+        }
+        for (unsigned int k = 0; k < n; ++k)
+            ok = ok && m->isLinearParameter(k) == (k % 2 == 0);
+    }
+    check(ok && cosh.hasParameterGradient() && sinh.hasParameterGradient() && osc.hasParameterGradient(),
+          "models: gradients, batches and linear amplitudes");
+}
+
+static void checkChi2Gradient()
+{
+    const unsigned int n = 30;
+    XYData<double> xyd(n, 1, 1);
+    for (unsigned int i = 0; i < n; ++i)
+    {
+        xyd.x(i, 0) = i;
+        xyd.y(i, 0) = 2. * exp(-0.3 * i) + 0.5 * exp(-0.8 * i) * (1. + 0.01 * sin(i));
+        for (unsigned int j = 0; j < n; ++j)
+            xyd.yyCov(0, 0)(i, j) = 1.e-6 * exp(-0.1 * (i + j)) * (i == j ? 1. : 0.3);
+    }
+    MODELS::MultiExp<double> model(2);
+    FitInterface fit(n, 1, 1);
+    fit.fitAllPoints(true);
+    Chi2CostFunction<double> chi2(xyd, fit, {&model});
+    GaussianPrior<double> prior(4);
+    prior.setPrior(1, 0.3, 0.05);
+    chi2.setPrior(prior);
+
+    vector<double> p = {1.8, 0.28, 0.6, 0.7}, g(4), gn(4);
+    chi2.gradient(p.data(), g.data());
+    NumericalDerivatives<double> nd(chi2, Vector<double>::Ones(4));
+    nd.setRichardson(true);
+    nd.gradient(p.data(), gn.data());
+    bool ok = chi2.hasGradient();
+    for (unsigned int k = 0; k < 4; ++k)
+        ok = ok && near(g[k], gn[k], 1.e-6);
+    check(ok, "chi2: analytic gradient matches finite differences");
+
+    MIN::LBFGSMinimizer<double> lbfgs;
+    lbfgs.options().verbosity = SILENT;
+    auto min = lbfgs.minimize(chi2, p);
+    check(min.is_valid && min.telemetry.n_gradient_calls > 0
+          && near(min.minimum[1], 0.3, 1.e-2), "chi2: L-BFGS fit with the analytic gradient");
+}
+
+static void checkComposition()
+{
+    MODELS::MultiExp<double> model(1);
+    vector<double> p = {1., 0.3};
+    double t = 2., f = model(&t, p.data());
+    // temporaries are stored by value
+    auto g = shift(bindParameters(MODELS::MultiExp<double>(1), p), 0.5);
+    auto h = compose([](double y) { return 2. * y; }, shift(g, 1.));
+    check(near(g(&t), f - 0.5) && near(h(&t), 2. * (f - 1.5)),
+          "composition: shift of a temporary bound model");
+    // lvalues are held by reference
+    auto b = bindParameters(model, p);
+    auto s = shift(b, 0.);
+    double q[] = {2., 0.3};
+    b.setParameters(q);
+    check(near(s(&t), 2. * f), "composition: lvalues are held by reference");
+    check(throws([&] { bindParameters(model, vector<double>(3)); }),
+          "composition: wrong number of bound parameters");
+}
+
+
+static void checkRootFinding()
+{
+    auto f = MakeLambdaFunction<double>(1, [](const double *x) { return x[0] * x[0] - 2.; });
+    Roots::BrentRootFinder<double> brent;
+    Roots::Root<double> r = brent.solve(f, 0., 2., 1.e-10);
+    check(r.converged() && near(r.value(), std::sqrt(2.), 1.e-8), "roots: Brent root of x^2 - 2");
+    // GSL errors throw instead of aborting
+    check(throws([&] { brent.solve(f, 2., 3., 1.e-10); }), "roots: bracket without a sign change");
+    // stopping on max_iter is flagged
+    brent.options.max_iter = 1;
+    check(!brent.solve(f, 0., 2., 1.e-14).converged(), "roots: max_iter flags the root");
+    brent.options.max_iter = 100;
+    // a batch, with and without a central root, gives the serial roots
+    auto shifted = [](double a)
+    {
+        return MakeLambdaFunction<double>(1, [a](const double *x) { return x[0] * x[0] - a; });
+    };
+    vector<decltype(shifted(0.))> family;
+    for (double a : {1.5, 1.8, 2., 2.3, 2.9, 3.5})
+    {
+        family.push_back(shifted(a));
+    }
+    vector<const ScalarFunction<double> *> fs;
+    for (auto &fi : family)
+    {
+        fs.push_back(&fi);
+    }
+    auto batch = brent.solveMany(fs, 0., 2., 1.e-10), narrowed = brent.solveMany(fs, 0., 2., 1.e-10, &f);
+    bool ok = batch.size() == fs.size() && narrowed.size() == fs.size();
+    for (unsigned int i = 0; ok && i < fs.size(); ++i)
+    {
+        double serial = brent.solve(*fs[i], 0., 2., 1.e-10).value();
+        ok = batch[i].converged() && narrowed[i].converged() && near(batch[i].value(), serial, 1.e-8)
+             && near(narrowed[i].value(), serial, 1.e-8);
+    }
+    check(ok, "roots: batch roots equal the serial roots");
+    brent.options.bracket_width = 0.;
+    check(throws([&] { brent.solveMany(fs, 0., 2., 1.e-10, &f); }), "roots: non-positive batch bracket width");
+    Roots::NewtonRootFinder<double> newton;
+    r = newton.polish(f, 1., 1.e-10);
+    check(r.converged() && near(r.value(), std::sqrt(2.), 1.e-8), "roots: Newton polish of x^2 - 2");
+    // exceptions of the function cross GSL unchanged
+    auto failing = MakeLambdaFunction<double>(1, [](const double *x) -> double
+    {
+        if (x[0] > 1.)
+        {
+            throw 42;
+        }
+        return x[0] * x[0] - 2.;
+    });
+    check(rethrows42([&] { brent.solve(failing, 0., 2., 1.e-10); })
+          && rethrows42([&] { newton.polish(failing, 1.5, 1.e-10); }),
+          "roots: function exception propagated");
+}
+
+static void checkMultiRootFinding()
+{
+    // x^2 + y^2 = 4 and x = y
+    auto c1 = MakeLambdaFunction<double>(2, [](const double *x) { return x[0] * x[0] + x[1] * x[1] - 4.; });
+    auto c2 = MakeLambdaFunction<double>(2, [](const double *x) { return x[0] - x[1]; });
+    vector<const ScalarFunction<double> *> c = {&c1, &c2};
+    auto jac = [](const double *x, double *j) { j[0] = 2. * x[0]; j[1] = 2. * x[1]; j[2] = 1.; j[3] = -1.; };
+    vector<double> x0 = {1., 2.};
+    auto solved = [](const vector<Roots::Root<double>> &r) {
+        return r[0].converged() && r[1].converged() && near(r[0].value(), std::sqrt(2.), 1.e-7)
+               && near(r[1].value(), std::sqrt(2.), 1.e-7);
+    };
+    Roots::GSLMultiRootFinder<double> hybrids;
+    check(solved(hybrids.solve(c, x0, 1.e-10)), "multiroot: finite difference Jacobian");
+    Roots::GSLMultiRootFinder<double> newton(Roots::GSLMultiRootFinder<double>::Algorithm::Newton);
+    check(solved(newton.solve(c, jac, x0, 1.e-10)), "multiroot: analytic Jacobian");
+    check(throws([&] { newton.solve(c, x0); }), "multiroot: missing Jacobian");
+    newton.options.max_iter = 1;
+    check(!newton.solve(c, jac, x0, 1.e-10)[0].converged(), "multiroot: max_iter flags the roots");
+    newton.options.max_iter = 1000;
+    auto c3 = MakeLambdaFunction<double>(2, [](const double *x) -> double
+    {
+        if (x[0] > 1.2)
+        {
+            throw 42;
+        }
+        return x[0] - x[1];
+    });
+    auto failingJac = [&](const double *x, double *j)
+    {
+        throw 42;
+    };
+    check(rethrows42([&] { hybrids.solve({&c1, &c3}, x0, 1.e-10); })
+          && rethrows42([&] { newton.solve(c, failingJac, x0, 1.e-10); }),
+          "multiroot: condition and Jacobian exceptions propagated");
+}
+
+static void checkQuadrature()
+{
+    auto f = MakeLambdaFunction<double>(1, [](const double *x) { return x[0] * x[0]; });
+    Quadrature<double> qag, gl(Quadrature<double>::Algorithm::GaussLegendre, 10);
+    check(near(qag.integrate(f, 0., 3.).value(), 9., 1.e-8), "quadrature: adaptive integral of x^2");
+    check(near(gl.integrate(f, 0., 3.).value(), 9., 1.e-10), "quadrature: Gauss-Legendre integral of x^2");
+    // GSL errors throw instead of aborting
+    auto nan = MakeLambdaFunction<double>(1, [](const double *x) { return std::sqrt(x[0] - 1.); });
+    check(throws([&] { qag.integrate(nan, 0., 3.); }), "quadrature: adaptive failure");
+    // a batch gives the serial integrals, and the exception of one integrand
+    auto power = [](double k)
+    {
+        return MakeLambdaFunction<double>(1, [k](const double *x) -> double
+        {
+            if (k < 0.)
+            {
+                throw 42;
+            }
+            return std::pow(x[0], k);
+        });
+    };
+    vector<decltype(power(0.))> family;
+    for (double k : {0., 0.5, 1., 2., 3.5, 5.})
+    {
+        family.push_back(power(k));
+    }
+    vector<const ScalarFunction<double> *> fs;
+    for (auto &fk : family)
+    {
+        fs.push_back(&fk);
+    }
+    bool ok = true;
+    for (Quadrature<double> *q : {&qag, &gl})
+    {
+        auto batch = q->integrateMany(fs, 0., 3.);
+        for (unsigned int i = 0; ok && i < fs.size(); ++i)
+        {
+            ok = batch[i].value() == q->integrate(*fs[i], 0., 3.).value();
+        }
+    }
+    check(ok, "quadrature: batch integrals equal the serial integrals");
+    auto failing = power(-1.);
+    fs[3] = &failing;
+    check(rethrows42([&] { qag.integrateMany(fs, 0., 3.); }) && rethrows42([&] { gl.integrateMany(fs, 0., 3.); }),
+          "quadrature: integrand exception propagated");
+}
+
+static void checkInterpolator()
+{
+    typedef Interpolator<double>::Scheme Scheme;
+    // every scheme reproduces a line, with its derivative
+    vector<double> x = {0., 0.5, 1.5, 2., 3.}, line = {1., 2., 4., 5., 7.};
+    for (Scheme scheme : {Scheme::Linear, Scheme::Cubic, Scheme::Akima, Scheme::Monotone})
+    {
+        Interpolator<double> l(x, line, scheme);
+        check(near(l.value(1.2), 3.4) && near(l.derivative(2.7), 2.),
+              "interpolator: line reproduced by scheme " + utils::strFrom(int(scheme)));
+    }
+    // the natural end conditions only spoil a cubic close to the ends
+    auto cubic = MakeLambdaFunction<double>(1, [](const double *t) { return t[0] * t[0] * t[0] - t[0]; });
+    Interpolator<double> c(cubic, -1., 1., 21);
+    bool ok = near(c.secondDerivative(-1.), 0.) && near(c.secondDerivative(1.), 0.);
+    for (double t = -0.5; t <= 0.5; t += 0.01)
+    {
+        ok = ok && near(c.value(t), t * t * t - t, 1.e-5);
+    }
+    check(ok, "interpolator: natural cubic spline of a cubic");
+    // sorted batches and cursors give the same values as binary searches
+    vector<double> ts(50), ys(50);
+    for (unsigned int i = 0; i < ts.size(); ++i)
+    {
+        ts[i] = -1. + 2. * i / (ts.size() - 1.);
+    }
+    c.evaluate(ts.data(), ts.size(), ys.data());
+    Interpolator<double>::Cursor cursor;
+    ok = true;
+    for (unsigned int i = 0; i < ts.size(); ++i)
+    {
+        ok = ok && ys[i] == c.value(ts[i]) && c.value(ts[i], cursor) == ys[i];
+    }
+    check(ok, "interpolator: batch and cursor lookups");
+    // no overshoot of monotonic data
+    vector<double> step = {0., 0., 0.1, 0.9, 1., 1.};
+    vector<double> xs = {0., 1., 2., 3., 4., 5.};
+    Interpolator<double> m(xs, step, Scheme::Monotone);
+    ok = true;
+    double prev = 0.;
+    for (double t = 0.; t <= 5.; t += 0.01)
+    {
+        double v = m.value(t);
+        ok = ok && v >= prev && v <= 1.;
+        prev = v;
+    }
+    check(ok, "interpolator: monotone data stay monotone");
+    // save/load round trip
+    stringstream ss;
+    c.save(ss);
+    Interpolator<double> l = Interpolator<double>::load(ss);
+    check(l.scheme() == c.scheme() && l.x() == c.x() && l.y() == c.y() && l.value(0.123) == c.value(0.123),
+          "interpolator: save/load round trip");
+    check(throws([&] { c.value(1.5); }), "interpolator: evaluation out of range");
+}
+
+static void checkTabulator()
+{
+    std::atomic<unsigned int> nEval {0};
+    auto f = MakeLambdaFunction<double>(1, [&](const double *x)
+    {
+        nEval++;
+        return std::exp(-x[0]) * std::sin(5. * x[0]);
+    });
+    Tabulator<double> tab;
+    tab.options.abs_tol = 1.e-7;
+    tab.options.rel_tol = 0.;
+    Interpolator<double> t = tab.tabulate(f, 0., 4.);
+    unsigned int nCalls = nEval;
+    double err = 0.;
+    for (double x = 0.; x <= 4.; x += 1.e-3)
+        err = std::max(err, std::abs(t.value(x) - std::exp(-x) * std::sin(5. * x)));
+    check(tab.isConverged() && err < 1.e-6, "tabulator: tolerance reached");
+    // every evaluation is kept as a node
+    check(tab.nEvaluations() == nCalls && t.nPoints() == nCalls, "tabulator: no wasted evaluation");
+    tab.options.max_points = 50;
+    t = tab.tabulate(f, 0., 4.);
+    check(!tab.isConverged() && t.nPoints() <= 50, "tabulator: max_points reached");
+    stringstream bad("garbage\n");
+    check(throws([&] { Interpolator<double>::load(bad); }), "tabulator: corrupted table");
+}
 
 int main()
 {
@@ -152,6 +1173,36 @@ int main()
 
     cout << mat << endl << endl;
     cout << PseudoInverse(mat) << endl;
+
+    checkChi2Concurrency();
+    checkChi2Parallel();
+    checkLinearSolve();
+    checkPriors();
+    checkWarmStart();
+    checkTelemetry();
+    checkLBFGS();
+    checkMultiStart();
+    checkDifferentialEvolution();
+    checkEvaluateMany();
+    checkNumericalDerivatives();
+    checkMinos();
+    checkStaticFit();
+    checkThreadPolicies();
+    checkCallableFunctions();
+    checkVectorModels();
+    checkFormula();
+    checkCache();
+    checkChi2Gradient();
+    checkCorrelatorModels();
+    checkComposition();
+    checkRootFinding();
+    checkMultiRootFinding();
+    checkQuadrature();
+    checkInterpolator();
+    checkTabulator();
+
+    cout << nFailures << " check(s) failed" << endl;
+    return nFailures ? 1 : 0;
 }
 
 
@@ -13,6 +13,7 @@
  #include <memory>
 
  #include "FactoryError.hpp"
+ #include "Policies.hpp"
 
  namespace utils {
 
@@ -21,7 +22,8 @@
  	class Product,
  	typename Identifier,
  	typename Creator = std::function<Product * ()>,
- 	template<typename, class> class FactoryErrorPolicy = DefaultFactoryError
+ 	template<typename, class> class FactoryErrorPolicy = DefaultFactoryError,
+ 	template<class> class ThreadModel = policies::thread::SingleThreaded
  	>
  	class Factory
  	: public FactoryErrorPolicy<Identifier, Product>
@@ -35,6 +37,8 @@
  	private:
  		// Typedefs
  		typedef std::map<Identifier, Creator> factory_map;
+ 		typedef typename ThreadModel<Factory>::Lock lock_type;
+ 		typedef typename ThreadModel<Factory>::ReadLock read_lock_type;
 
  		// Data
  		factory_map _FactoryMap;
@@ -48,10 +52,12 @@
  		// Registration
  		bool registerId(const Identifier& id, Creator c)
  		{
+ 			lock_type guard;
  			return _FactoryMap.insert({id, c}).second;
  		}
  		bool unregisterId(const Identifier& id)
  		{
+ 			lock_type guard;
  			return _FactoryMap.erase(id) == 1;
  		}
 
@@ -59,16 +65,22 @@
  		template<typename... ARGS>
  		std::unique_ptr<Product> create(const Identifier& id, ARGS... args)
  		{
- 			auto i = _FactoryMap.find(id);
- 			if(i != _FactoryMap.end())
- 				return std::unique_ptr<Product>((i->second)(args...));
- 			
- 			return this->onUnknownType(id);
+ 			// the creator is called outside of the lock
+ 			Creator c;
+ 			{
+ 				read_lock_type guard;
+ 				auto i = _FactoryMap.find(id);
+ 				if(i == _FactoryMap.end())
+ 					return this->onUnknownType(id);
+ 				c = i->second;
+ 			}
+ 			return std::unique_ptr<Product>(c(args...));
  		}
 
  	protected:
  		Creator& getCreator(const Identifier& id)
  		{
+ 			read_lock_type guard;
  			auto i = _FactoryMap.find(id);
  			if(i != _FactoryMap.end())
  				return i->second;
@@ -8,6 +8,9 @@
 #ifndef POLICIES_HPP
 #define POLICIES_HPP
 
+ #include <atomic>
+ #include <mutex>
+
  #include "Exceptions.hpp"
 
  namespace utils {
@@ -51,6 +54,13 @@
 
  		namespace thread {
 
+ 			// A thread model provides
+ 			//  - volatile_type, the storage of a shared T, with load() (acquire)
+ 			//    and store() (release) accessors
+ 			//  - Lock, an exclusive lock for writers
+ 			//  - ReadLock, a lock for readers of data written under Lock
+
+ 			// No synchronization
  			template<class T>
  			class SingleThreaded
  			{
@@ -58,9 +68,93 @@
  				// Typedefs
  				typedef T volatile_type;
 
- 				// Lock
- 				class Lock {};
+ 				// Locks, no-ops (the constructor keeps the guards from being
+ 				// reported as unused variables)
+ 				class Lock
+ 				{
+ 				public:
+ 					Lock() {}
+ 				};
+ 				typedef Lock ReadLock;
+
+ 				// Access
+ 				static T load(const volatile_type& v)
+ 				{
+ 					return v;
+ 				}
+ 				static void store(volatile_type& v, T t)
+ 				{
+ 					v = t;
+ 				}
+ 			};
+
+ 			// One mutex per class T, taken by writers and readers
+ 			template<class T>
+ 			class ClassLevelLockable
+ 			{
+ 			public:
+ 				// Typedefs
+ 				typedef std::atomic<T> volatile_type;
+
+ 				// Locks
+ 				class Lock
+ 				{
+ 				private:
+ 					std::lock_guard<std::mutex> _Guard;
+
+ 				public:
+ 					Lock()
+ 					: _Guard(mutex())
+ 					{}
+ 					Lock(const Lock&) = delete;
+ 					Lock& operator=(const Lock&) = delete;
+ 				};
+ 				typedef Lock ReadLock;
+
+ 				// Access
+ 				static T load(const volatile_type& v)
+ 				{
+ 					return v.load();
+ 				}
+ 				static void store(volatile_type& v, T t)
+ 				{
+ 					v.store(t);
+ 				}
+
+ 			private:
+ 				static std::mutex& mutex()
+ 				{
+ 					// initialization of local statics is thread-safe
+ 					static std::mutex m;
+ 					return m;
+ 				}
+ 			};
 
+ 			// Data written once (or rarely) and then only read: writers are
+ 			// serialized by a class-level mutex, readers take no lock and rely on
+ 			// the acquire/release ordering of load() and store(). Writes must not
+ 			// race with reads, e.g. a factory is safe for concurrent lookups once
+ 			// all its types are registered.
+ 			template<class T>
+ 			class LockFreeOnceInit
+ 			{
+ 			public:
+ 				// Typedefs
+ 				typedef std::atomic<T> volatile_type;
+
+ 				// Locks
+ 				typedef typename ClassLevelLockable<T>::Lock Lock;
+ 				typedef typename SingleThreaded<T>::Lock ReadLock;
+
+ 				// Access
+ 				static T load(const volatile_type& v)
+ 				{
+ 					return v.load(std::memory_order_acquire);
+ 				}
+ 				static void store(volatile_type& v, T t)
+ 				{
+ 					v.store(t, std::memory_order_release);
+ 				}
  			};
 
  		}
@@ -78,21 +78,26 @@
  	>
  	T& SingletonHolder<T, CreationPolicy, LifetimePolicy, ThreadModel>::instance()
  	{
- 		if(!_Instance)
+ 		// double-checked locking, the instance is published by a release
+ 		// store once fully constructed
+ 		T* instance = ThreadModel<T*>::load(_Instance);
+ 		if(!instance)
  		{
  			typename ThreadModel<T>::Lock guard;
- 			if(!_Instance)
+ 			instance = ThreadModel<T*>::load(_Instance);
+ 			if(!instance)
  			{
  				if(_Destroyed)
  				{
  					LifetimePolicy<T>::onDeadReference();
  					_Destroyed = false;
  				}
- 				_Instance = CreationPolicy<T>::create();
+ 				instance = CreationPolicy<T>::create();
+ 				ThreadModel<T*>::store(_Instance, instance);
  				LifetimePolicy<T>::scheduleDestruction(&destroy);
  			}
  		}
- 		return *_Instance;
+ 		return *instance;
  	}
 
  	template
@@ -105,8 +110,9 @@
  	void SingletonHolder<T, CreationPolicy, LifetimePolicy, ThreadModel>::destroy()
  	{
  		ASSERT(!_Destroyed);
- 		CreationPolicy<T>::destroy(_Instance);
- 		_Instance = 0;
+ 		typename ThreadModel<T>::Lock guard;
+ 		CreationPolicy<T>::destroy(ThreadModel<T*>::load(_Instance));
+ 		ThreadModel<T*>::store(_Instance, nullptr);
  		_Destroyed = true;
  	}
 